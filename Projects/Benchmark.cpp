@@ -0,0 +1,438 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <thread>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "MazeGenerator.h"
+#include "ShaderVariants.h"
+#include "Visibility.h"
+
+namespace
+{
+	/// <summary>
+	/// Finds a percentile of a sorted list of values, using the nearest rank.
+	/// </summary>
+	/// <param name="sortedValues">Values sorted in ascending order</param>
+	/// <param name="percentile">Percentile, from 0 to 100</param>
+	/// <returns>Smallest value that is greater than or equal to that percentage of the values</returns>
+	template<typename T>
+	T GetPercentile(const std::vector<T>& sortedValues, double percentile)
+	{
+		if (sortedValues.empty())
+		{
+			return T();
+		}
+
+		std::size_t rank = static_cast<std::size_t>(percentile / 100.0 * sortedValues.size() + 0.999999);
+		rank = std::min(std::max(rank, std::size_t(1)), sortedValues.size());
+		return sortedValues[rank - 1];
+	}
+
+	/// <summary>
+	/// Computes the mean of a list of values.
+	/// </summary>
+	/// <param name="values">Values to average</param>
+	/// <returns>Mean of the values, or 0 if there are none</returns>
+	template<typename T>
+	double GetMean(const std::vector<T>& values)
+	{
+		double sum = 0.0;
+		for (T value : values)
+		{
+			sum += static_cast<double>(value);
+		}
+
+		return values.empty() ? 0.0 : sum / values.size();
+	}
+
+	/// <summary>
+	/// Writes the distribution of a list of values as a JSON object.
+	/// </summary>
+	/// <param name="file">Stream to write to</param>
+	/// <param name="values">Values to summarize</param>
+	template<typename T>
+	void WriteDistribution(std::ostream& file, std::vector<T> values)
+	{
+		std::sort(values.begin(), values.end());
+		file << "{ \"mean\": " << GetMean(values)
+			<< ", \"min\": " << (values.empty() ? T() : values.front())
+			<< ", \"p50\": " << GetPercentile(values, 50.0)
+			<< ", \"p90\": " << GetPercentile(values, 90.0)
+			<< ", \"p95\": " << GetPercentile(values, 95.0)
+			<< ", \"p99\": " << GetPercentile(values, 99.0)
+			<< ", \"max\": " << (values.empty() ? T() : values.back()) << " }";
+	}
+
+	/// <summary>
+	/// Splits a range in two child jobs until it is small enough, then adds up the range.
+	/// Exercises job creation, parent/child completion and stealing rather than raw throughput.
+	/// </summary>
+	/// <param name="jobs">Job system to create the children on</param>
+	/// <param name="parent">Job the children belong to</param>
+	/// <param name="begin">First value of the range</param>
+	/// <param name="end">One past the last value of the range</param>
+	/// <param name="sums">One sum per leaf, indexed by the first value of the leaf divided by the leaf size</param>
+	void SumRange(JobSystem& jobs, Job* parent, std::size_t begin, std::size_t end, std::vector<double>& sums)
+	{
+		const std::size_t leafSize = 4096;
+		if (end - begin > leafSize)
+		{
+			std::size_t middle = begin + (end - begin) / 2 / leafSize * leafSize;
+			jobs.Run(jobs.CreateJob([&jobs, parent, begin, middle, &sums]() { SumRange(jobs, parent, begin, middle, sums); }, parent));
+			jobs.Run(jobs.CreateJob([&jobs, parent, middle, end, &sums]() { SumRange(jobs, parent, middle, end, sums); }, parent));
+			return;
+		}
+
+		double sum = 0.0;
+		for (std::size_t i = begin; i < end; i++)
+		{
+			sum += std::sqrt(static_cast<double>(i));
+		}
+		sums[begin / leafSize] = sum;
+	}
+
+	/// <summary>
+	/// Runs a workload several times and keeps the fastest run, which is the least disturbed by other processes.
+	/// </summary>
+	/// <param name="workload">Work to time</param>
+	/// <param name="runCount">Number of runs</param>
+	/// <returns>Time taken by the fastest run, in milliseconds</returns>
+	double TimeBestOf(const std::function<void()>& workload, int runCount = 5)
+	{
+		double best = 0.0;
+		for (int run = 0; run < runCount; run++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			workload();
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (run == 0 || milliseconds < best)
+			{
+				best = milliseconds;
+			}
+		}
+		return best;
+	}
+}
+
+/// <summary>
+/// Creates a path that approaches the maze, crosses it at eye level from one corner to the
+/// other, then climbs above it for an overview. The waypoints are placed relative to the
+/// bounds of the grid, so the path fits any maze.
+/// </summary>
+/// <param name="maze">Maze to fly through</param>
+/// <returns>Path through the maze</returns>
+CameraPath CameraPath::CreateMazeFlythrough(const MazeSource& maze)
+{
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	maze.GetBounds(0, 0, maze.GetWidth(), maze.GetDepth(), boundsMin, boundsMax);
+
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 size = boundsMax - boundsMin;
+
+	// Eye level is the middle of the walls, and the overview is as high as the maze is wide
+	auto at = [&](float x, float z, float height)
+	{
+		return glm::vec3(boundsMin.x + x * size.x, height, boundsMin.z + z * size.z);
+	};
+	float eyeLevel = center.y;
+	float overview = boundsMax.y + glm::max(size.x, size.z);
+
+	// Walk in looking ahead along the way, then look down at the middle of the maze from above
+	CameraPath path;
+	path.positions = {
+		at(1.3f, 1.3f, eyeLevel),
+		at(0.9f, 0.9f, eyeLevel),
+		at(0.7f, 0.6f, eyeLevel),
+		at(0.5f, 0.55f, eyeLevel),
+		at(0.35f, 0.3f, eyeLevel),
+		at(0.1f, 0.1f, eyeLevel),
+		at(0.3f, -0.2f, overview * 0.5f),
+		at(0.9f, 0.0f, overview),
+		at(1.2f, 0.8f, overview * 0.6f),
+		at(1.3f, 1.3f, eyeLevel),
+	};
+	path.targets = {
+		at(0.9f, 0.9f, eyeLevel),
+		at(0.7f, 0.6f, eyeLevel),
+		at(0.5f, 0.55f, eyeLevel),
+		at(0.35f, 0.3f, eyeLevel),
+		at(0.1f, 0.1f, eyeLevel),
+		at(-0.2f, -0.2f, eyeLevel),
+		center,
+		center,
+		center,
+		at(0.5f, 0.5f, eyeLevel),
+	};
+
+	return path;
+}
+
+/// <summary>
+/// Finds the pose of the camera part of the way along the path.
+/// </summary>
+/// <param name="t">Progress along the path, from 0 to 1</param>
+/// <returns>Pose of the camera</returns>
+CameraPose CameraPath::Evaluate(float t) const
+{
+	CameraPose pose;
+	pose.position = Interpolate(positions, t);
+
+	glm::vec3 direction = Interpolate(targets, t) - pose.position;
+	pose.front = glm::length(direction) > 0.0f ? glm::normalize(direction) : glm::vec3(0.0f, 0.0f, -1.0f);
+	return pose;
+}
+
+/// <summary>
+/// Finds the point part of the way along a Catmull-Rom spline through a list of points.
+/// </summary>
+/// <param name="points">Points the spline passes through</param>
+/// <param name="t">Progress along the spline, from 0 to 1</param>
+/// <returns>Point on the spline</returns>
+glm::vec3 CameraPath::Interpolate(const std::vector<glm::vec3>& points, float t)
+{
+	int segmentCount = static_cast<int>(points.size()) - 1;
+	float scaled = glm::clamp(t, 0.0f, 1.0f) * segmentCount;
+	int segment = glm::min(static_cast<int>(scaled), segmentCount - 1);
+	float s = scaled - segment;
+
+	// The first and last points are repeated to give the ends a tangent
+	const glm::vec3& p0 = points[glm::max(segment - 1, 0)];
+	const glm::vec3& p1 = points[segment];
+	const glm::vec3& p2 = points[segment + 1];
+	const glm::vec3& p3 = points[glm::min(segment + 2, segmentCount)];
+
+	return 0.5f * ((2.0f * p1) + (p2 - p0) * s
+		+ (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * s * s
+		+ (3.0f * p1 - p0 - 3.0f * p2 + p3) * s * s * s);
+}
+
+/// <summary>
+/// Discards the frames recorded so far and reserves room for a new run.
+/// </summary>
+/// <param name="frameCount">Number of frames that will be recorded</param>
+void BenchmarkRecorder::Begin(int frameCount)
+{
+	frameTimes.clear();
+	drawCallCounts.clear();
+	triangleCounts.clear();
+	overdraws.clear();
+	frameTimes.reserve(frameCount);
+	drawCallCounts.reserve(frameCount);
+	triangleCounts.reserve(frameCount);
+}
+
+/// <summary>
+/// Records the statistics of one frame.
+/// </summary>
+/// <param name="milliseconds">Time taken by the frame, until the GPU finished it</param>
+/// <param name="drawCalls">Number of draw calls issued for the scene</param>
+/// <param name="triangles">Number of triangles submitted for the scene</param>
+void BenchmarkRecorder::AddFrame(double milliseconds, int drawCalls, long long triangles)
+{
+	frameTimes.push_back(milliseconds);
+	drawCallCounts.push_back(drawCalls);
+	triangleCounts.push_back(triangles);
+}
+
+/// <summary>
+/// Records the overdraw of one frame. The GPU reports it a few frames late, so it is
+/// recorded separately from the other statistics of the frame.
+/// </summary>
+/// <param name="fragmentsPerPixel">Fragments shaded per pixel of the framebuffer</param>
+void BenchmarkRecorder::AddOverdraw(double fragmentsPerPixel)
+{
+	overdraws.push_back(fragmentsPerPixel);
+}
+
+/// <summary>
+/// Writes the frame time percentiles, the draw call and triangle counts and the overdraw,
+/// if any was recorded, to a file.
+/// </summary>
+/// <param name="filePath">Path of the JSON file</param>
+/// <param name="settings">Name and JSON value of each setting the benchmark ran with</param>
+/// <returns>True if the file was written</returns>
+bool BenchmarkRecorder::WriteJson(const std::string& filePath, const std::vector<std::pair<std::string, std::string>>& settings) const
+{
+	std::ofstream file(filePath);
+	if (file.fail())
+	{
+		return false;
+	}
+
+	file << std::fixed << std::setprecision(4);
+	file << "{\n";
+	file << "\t\"frames\": " << frameTimes.size() << ",\n";
+	for (const std::pair<std::string, std::string>& setting : settings)
+	{
+		file << "\t\"" << setting.first << "\": " << setting.second << ",\n";
+	}
+
+	file << "\t\"frameTimeMs\": ";
+	WriteDistribution(file, frameTimes);
+	file << ",\n\t\"drawCalls\": ";
+	WriteDistribution(file, drawCallCounts);
+	file << ",\n\t\"triangles\": ";
+	WriteDistribution(file, triangleCounts);
+	if (!overdraws.empty())
+	{
+		file << ",\n\t\"overdraw\": ";
+		WriteDistribution(file, overdraws);
+	}
+	file << "\n}\n";
+
+	return static_cast<bool>(file);
+}
+
+/// <summary>
+/// Measures how the engine's parallel workloads scale with the number of job system workers.
+/// Each workload runs with 1, 2, ... maxWorkers workers, keeping the best of several runs,
+/// and the times are written to a JSON file along with the speedup over a single worker.
+/// </summary>
+/// <param name="grid">Grid of the maze whose potentially visible sets are computed</param>
+/// <param name="maxWorkers">Largest number of workers, or 0 for one per hardware thread</param>
+/// <param name="filePath">Path of the JSON file</param>
+/// <returns>True if the file was written</returns>
+bool RunJobScalingBenchmark(const CellGrid& grid, unsigned maxWorkers, const std::string& filePath)
+{
+	if (maxWorkers == 0)
+	{
+		maxWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	// Far more tiles than the maze has, rotated so that every one needs a normal matrix
+	const std::size_t tileCount = 1 << 18;
+	std::vector<glm::mat4> models(tileCount);
+	std::vector<glm::mat4> normals(tileCount);
+	const std::size_t sumCount = 1 << 22;
+	std::vector<double> sums(sumCount / 4096 + 1);
+
+	struct Workload
+	{
+		const char* name;
+		std::function<void(JobSystem&)> run;
+		std::vector<double> milliseconds = {};
+	};
+
+	std::vector<Workload> workloads;
+	workloads.push_back({ "potentiallyVisibleSet", [&](JobSystem& jobs)
+	{
+		PotentiallyVisibleSet set;
+		set.Compute(grid, jobs);
+	} });
+	workloads.push_back({ "tileMatrices", [&](JobSystem& jobs)
+	{
+		jobs.ParallelFor(tileCount, 1024, [&](std::size_t begin, std::size_t end)
+		{
+			for (std::size_t i = begin; i < end; i++)
+			{
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(i % 512, 0.0f, i / 512));
+				models[i] = glm::rotate(model, static_cast<float>(i) * 0.001f, glm::vec3(0.0f, 1.0f, 0.0f));
+				normals[i] = ComputeNormalMatrix(models[i]);
+			}
+		});
+	} });
+	workloads.push_back({ "jobTree", [&](JobSystem& jobs)
+	{
+		Job* root = jobs.CreateJob(nullptr);
+		SumRange(jobs, root, 0, sumCount, sums);
+		jobs.Run(root);
+		jobs.Wait(root);
+	} });
+
+	for (unsigned workerCount = 1; workerCount <= maxWorkers; workerCount++)
+	{
+		JobSystem jobs;
+		jobs.Create(workerCount);
+		for (Workload& workload : workloads)
+		{
+			workload.milliseconds.push_back(TimeBestOf([&]() { workload.run(jobs); }));
+		}
+		jobs.Destroy();
+	}
+
+	std::ofstream file(filePath);
+	if (file.fail())
+	{
+		return false;
+	}
+
+	file << std::fixed << std::setprecision(4);
+	file << "{\n";
+	file << "\t\"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n";
+	file << "\t\"cells\": " << grid.GetCellCount() << ",\n";
+	for (std::size_t i = 0; i < workloads.size(); i++)
+	{
+		const Workload& workload = workloads[i];
+		file << "\t\"" << workload.name << "\": [";
+		for (std::size_t worker = 0; worker < workload.milliseconds.size(); worker++)
+		{
+			file << (worker == 0 ? "\n" : ",\n") << "\t\t{ \"workers\": " << worker + 1
+				<< ", \"ms\": " << workload.milliseconds[worker]
+				<< ", \"speedup\": " << workload.milliseconds[0] / workload.milliseconds[worker] << " }";
+		}
+		file << "\n\t]" << (i + 1 < workloads.size() ? ",\n" : "\n");
+	}
+	file << "}\n";
+
+	return static_cast<bool>(file);
+}
+
+/// <summary>
+/// Measures how fast each maze generator produces a square maze, on this thread and then on
+/// every hardware thread, and writes the times and the cells generated per second to a JSON file.
+/// </summary>
+/// <param name="mazeSize">Number of cells along each side of the maze</param>
+/// <param name="seed">Seed of the mazes</param>
+/// <param name="filePath">Path of the JSON file</param>
+/// <returns>True if the file was written</returns>
+bool RunMazeGenerationBenchmark(int mazeSize, std::uint32_t seed, const std::string& filePath)
+{
+	const MazeAlgorithm algorithms[] = { MazeAlgorithm::Kruskal, MazeAlgorithm::Backtracker, MazeAlgorithm::Wilson };
+	double cellCount = static_cast<double>(mazeSize) * mazeSize;
+
+	JobSystem jobs;
+	jobs.Create();
+
+	// Large mazes take seconds to generate, so fewer runs are enough to settle
+	WallGrid maze;
+	double serialMilliseconds[3];
+	double parallelMilliseconds[3];
+	for (int i = 0; i < 3; i++)
+	{
+		serialMilliseconds[i] = TimeBestOf([&]() { GenerateMaze(maze, mazeSize, mazeSize, algorithms[i], seed); }, 3);
+		parallelMilliseconds[i] = TimeBestOf([&]() { GenerateMaze(maze, mazeSize, mazeSize, algorithms[i], seed, &jobs); }, 3);
+	}
+	unsigned workerCount = jobs.GetWorkerCount();
+	jobs.Destroy();
+
+	std::ofstream file(filePath);
+	if (file.fail())
+	{
+		return false;
+	}
+
+	file << std::fixed << std::setprecision(4);
+	file << "{\n";
+	file << "\t\"workers\": " << workerCount << ",\n";
+	file << "\t\"mazeSize\": " << mazeSize << ",\n";
+	file << "\t\"regionSize\": " << DefaultMazeRegionSize << ",\n";
+	file << "\t\"seed\": " << seed << ",\n";
+	for (int i = 0; i < 3; i++)
+	{
+		file << "\t\"" << GetMazeAlgorithmName(algorithms[i]) << "\": { \"serialMs\": " << serialMilliseconds[i]
+			<< ", \"serialCellsPerSecond\": " << std::setprecision(0) << cellCount / serialMilliseconds[i] * 1000.0 << std::setprecision(4)
+			<< ", \"parallelMs\": " << parallelMilliseconds[i]
+			<< ", \"parallelCellsPerSecond\": " << std::setprecision(0) << cellCount / parallelMilliseconds[i] * 1000.0 << std::setprecision(4)
+			<< ", \"speedup\": " << serialMilliseconds[i] / parallelMilliseconds[i] << " }" << (i + 1 < 3 ? ",\n" : "\n");
+	}
+	file << "}\n";
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CellGrid.h"
+#include "JobSystem.h"
+#include "MazeSource.h"
+
+/// <summary>
+/// Position and viewing direction of the camera
+/// </summary>
+struct CameraPose
+{
+	glm::vec3 position;
+	glm::vec3 front;
+};
+
+/// <summary>
+/// Scripted camera path used by the benchmark, so every run renders exactly the same frames.
+/// The camera follows a smooth curve through a list of waypoints, while the point it looks
+/// at follows a second curve.
+/// </summary>
+class CameraPath
+{
+public:
+	/// <summary>
+	/// Creates a path that approaches the maze, crosses it at eye level from one corner to the
+	/// other, then climbs above it for an overview. The waypoints are placed relative to the
+	/// bounds of the grid, so the path fits any maze.
+	/// </summary>
+	/// <param name="maze">Maze to fly through</param>
+	/// <returns>Path through the maze</returns>
+	static CameraPath CreateMazeFlythrough(const MazeSource& maze);
+
+	/// <summary>
+	/// Finds the pose of the camera part of the way along the path.
+	/// </summary>
+	/// <param name="t">Progress along the path, from 0 to 1</param>
+	/// <returns>Pose of the camera</returns>
+	CameraPose Evaluate(float t) const;
+
+private:
+	/// <summary>
+	/// Finds the point part of the way along a Catmull-Rom spline through a list of points.
+	/// </summary>
+	/// <param name="points">Points the spline passes through</param>
+	/// <param name="t">Progress along the spline, from 0 to 1</param>
+	/// <returns>Point on the spline</returns>
+	static glm::vec3 Interpolate(const std::vector<glm::vec3>& points, float t);
+
+	std::vector<glm::vec3> positions;	// Waypoints of the camera
+	std::vector<glm::vec3> targets;		// Point the camera looks at from each waypoint
+};
+
+/// <summary>
+/// Collects the statistics of every benchmark frame and writes a summary as JSON.
+/// </summary>
+class BenchmarkRecorder
+{
+public:
+	/// <summary>
+	/// Discards the frames recorded so far and reserves room for a new run.
+	/// </summary>
+	/// <param name="frameCount">Number of frames that will be recorded</param>
+	void Begin(int frameCount);
+
+	/// <summary>
+	/// Records the statistics of one frame.
+	/// </summary>
+	/// <param name="milliseconds">Time taken by the frame, until the GPU finished it</param>
+	/// <param name="drawCalls">Number of draw calls issued for the scene</param>
+	/// <param name="triangles">Number of triangles submitted for the scene</param>
+	void AddFrame(double milliseconds, int drawCalls, long long triangles);
+
+	/// <summary>
+	/// Records the overdraw of one frame. The GPU reports it a few frames late, so it is
+	/// recorded separately from the other statistics of the frame.
+	/// </summary>
+	/// <param name="fragmentsPerPixel">Fragments shaded per pixel of the framebuffer</param>
+	void AddOverdraw(double fragmentsPerPixel);
+
+	/// <summary>
+	/// Writes the frame time percentiles, the draw call and triangle counts and the overdraw,
+	/// if any was recorded, to a file.
+	/// </summary>
+	/// <param name="filePath">Path of the JSON file</param>
+	/// <param name="settings">Name and JSON value of each setting the benchmark ran with</param>
+	/// <returns>True if the file was written</returns>
+	bool WriteJson(const std::string& filePath, const std::vector<std::pair<std::string, std::string>>& settings) const;
+
+private:
+	std::vector<double> frameTimes;
+	std::vector<int> drawCallCounts;
+	std::vector<long long> triangleCounts;
+	std::vector<double> overdraws;
+};
+
+/// <summary>
+/// Measures how the engine's parallel workloads scale with the number of job system workers.
+/// Each workload runs with 1, 2, ... maxWorkers workers, keeping the best of several runs,
+/// and the times are written to a JSON file along with the speedup over a single worker.
+/// </summary>
+/// <param name="grid">Grid of the maze whose potentially visible sets are computed</param>
+/// <param name="maxWorkers">Largest number of workers, or 0 for one per hardware thread</param>
+/// <param name="filePath">Path of the JSON file</param>
+/// <returns>True if the file was written</returns>
+bool RunJobScalingBenchmark(const CellGrid& grid, unsigned maxWorkers, const std::string& filePath);
+
+/// <summary>
+/// Measures how fast each maze generator produces a square maze, on this thread and then on
+/// every hardware thread, and writes the times and the cells generated per second to a JSON file.
+/// </summary>
+/// <param name="mazeSize">Number of cells along each side of the maze</param>
+/// <param name="seed">Seed of the mazes</param>
+/// <param name="filePath">Path of the JSON file</param>
+/// <returns>True if the file was written</returns>
+bool RunMazeGenerationBenchmark(int mazeSize, std::uint32_t seed, const std::string& filePath);
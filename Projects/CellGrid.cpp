@@ -0,0 +1,250 @@
+#include "CellGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// <summary>
+/// Sorts the tiles into the cells that contain them. Every tile is a face of a cube
+/// centered on the position of the tile, so it belongs to the cell of that position.
+/// </summary>
+/// <param name="mazeTiles">Tiles of the maze</param>
+void CellGrid::Build(const std::vector<Tile>& mazeTiles)
+{
+	tiles.clear();
+	cellStart.assign(1, 0);
+	xWalls.clear();
+	zWalls.clear();
+	width = depth = 0;
+	if (mazeTiles.empty())
+	{
+		return;
+	}
+
+	// The cubes are 2 units wide and centered on the tile positions
+	glm::vec3 lowest = mazeTiles[0].position;
+	glm::vec3 highest = mazeTiles[0].position;
+	for (const Tile& tile : mazeTiles)
+	{
+		lowest = glm::min(lowest, tile.position);
+		highest = glm::max(highest, tile.position);
+	}
+
+	float halfCell = CellSize * 0.5f;
+	origin = lowest - glm::vec3(halfCell);
+	minY = lowest.y - halfCell;
+	maxY = highest.y + halfCell;
+	width = static_cast<int>(std::round((highest.x - lowest.x) / CellSize)) + 1;
+	depth = static_cast<int>(std::round((highest.z - lowest.z) / CellSize)) + 1;
+
+	// Counting sort of the tiles by cell
+	std::vector<int> tileCells(mazeTiles.size());
+	cellStart.assign(GetCellCount() + 1, 0);
+	for (std::size_t i = 0; i < mazeTiles.size(); i++)
+	{
+		tileCells[i] = GetCellIndex(mazeTiles[i].position);
+		cellStart[tileCells[i] + 1]++;
+	}
+
+	for (int cell = 0; cell < GetCellCount(); cell++)
+	{
+		cellStart[cell + 1] += cellStart[cell];
+	}
+
+	std::vector<int> next(cellStart.begin(), cellStart.end() - 1);
+	tiles.resize(mazeTiles.size());
+	for (std::size_t i = 0; i < mazeTiles.size(); i++)
+	{
+		tiles[next[tileCells[i]]++] = mazeTiles[i];
+	}
+
+	// Every wall tile blocks the side of its cell that its face lies on
+	xWalls.assign((width + 1) * depth, false);
+	zWalls.assign(width * (depth + 1), false);
+	for (std::size_t i = 0; i < mazeTiles.size(); i++)
+	{
+		int x = tileCells[i] % width;
+		int z = tileCells[i] / width;
+		switch (mazeTiles[i].face)
+		{
+		case TileFace::Left:	xWalls[z * (width + 1) + x] = true;		break;
+		case TileFace::Right:	xWalls[z * (width + 1) + x + 1] = true;	break;
+		case TileFace::Back:	zWalls[z * width + x] = true;			break;
+		case TileFace::Front:	zWalls[(z + 1) * width + x] = true;		break;
+		default:														break;
+		}
+	}
+}
+
+/// <summary>
+/// Checks whether a side of a cell is blocked by a wall or by the edge of the grid.
+/// </summary>
+/// <param name="x">Column of the cell</param>
+/// <param name="z">Row of the cell</param>
+/// <param name="side">Side of the cell</param>
+/// <returns>True if nothing can be seen or walked through that side</returns>
+bool CellGrid::IsBlocked(int x, int z, CellSide side) const
+{
+	switch (side)
+	{
+	case CellSide::NegativeX:	return x == 0 || xWalls[z * (width + 1) + x];
+	case CellSide::PositiveX:	return x == width - 1 || xWalls[z * (width + 1) + x + 1];
+	case CellSide::NegativeZ:	return z == 0 || zWalls[z * width + x];
+	case CellSide::PositiveZ:	return z == depth - 1 || zWalls[(z + 1) * width + x];
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Finds the cell containing a position.
+/// </summary>
+/// <param name="position">World-space position</param>
+/// <returns>Index of the cell, or -1 if the position is outside of the grid</returns>
+int CellGrid::GetCellIndex(const glm::vec3& position) const
+{
+	int x = static_cast<int>(std::floor((position.x - origin.x) / CellSize));
+	int z = static_cast<int>(std::floor((position.z - origin.z) / CellSize));
+	if (x < 0 || z < 0 || x >= width || z >= depth)
+	{
+		return -1;
+	}
+
+	return z * width + x;
+}
+
+/// <summary>
+/// Computes the world-space bounding box of a rectangle of cells.
+/// </summary>
+/// <param name="x0">First column</param>
+/// <param name="z0">First row</param>
+/// <param name="x1">One past the last column</param>
+/// <param name="z1">One past the last row</param>
+/// <param name="boxMin">Receives the minimum corner</param>
+/// <param name="boxMax">Receives the maximum corner</param>
+void CellGrid::GetBounds(int x0, int z0, int x1, int z1, glm::vec3& boxMin, glm::vec3& boxMax) const
+{
+	boxMin = glm::vec3(origin.x + x0 * CellSize, minY, origin.z + z0 * CellSize);
+	boxMax = glm::vec3(origin.x + x1 * CellSize, maxY, origin.z + z1 * CellSize);
+}
+
+/// <summary>
+/// Finds every non-empty cell that is at least partially inside the frustum. Rectangles
+/// of cells are tested recursively, so whole regions are accepted or rejected at once.
+/// </summary>
+/// <param name="frustum">View frustum</param>
+/// <param name="visibleCells">Receives the visible cells, sorted by index</param>
+void CellGrid::CullFrustum(const Frustum& frustum, std::vector<int>& visibleCells) const
+{
+	visibleCells.clear();
+	if (GetCellCount() == 0)
+	{
+		return;
+	}
+
+	CullRegion(frustum, 0, 0, width, depth, false, visibleCells);
+	std::sort(visibleCells.begin(), visibleCells.end());
+}
+
+/// <summary>
+/// Tests a rectangle of cells against the frustum. Rectangles that straddle a plane
+/// are split into quadrants until single cells are reached.
+/// </summary>
+/// <param name="frustum">View frustum</param>
+/// <param name="x0">First column</param>
+/// <param name="z0">First row</param>
+/// <param name="x1">One past the last column</param>
+/// <param name="z1">One past the last row</param>
+/// <param name="inside">True if a parent rectangle was already completely inside</param>
+/// <param name="visibleCells">Receives the visible cells</param>
+void CellGrid::CullRegion(const Frustum& frustum, int x0, int z0, int x1, int z1, bool inside, std::vector<int>& visibleCells) const
+{
+	if (!inside)
+	{
+		glm::vec3 boxMin, boxMax;
+		GetBounds(x0, z0, x1, z1, boxMin, boxMax);
+
+		FrustumTest test = frustum.TestBox(boxMin, boxMax);
+		if (test == FrustumTest::Outside)
+		{
+			return;
+		}
+
+		inside = test == FrustumTest::Inside;
+	}
+
+	bool singleCell = x1 - x0 == 1 && z1 - z0 == 1;
+	if (inside || singleCell)
+	{
+		for (int z = z0; z < z1; z++)
+		{
+			for (int x = x0; x < x1; x++)
+			{
+				int cell = z * width + x;
+				if (GetTileCount(cell) > 0)
+				{
+					visibleCells.push_back(cell);
+				}
+			}
+		}
+
+		return;
+	}
+
+	int xMid = (x0 + x1 + 1) / 2;
+	int zMid = (z0 + z1 + 1) / 2;
+
+	CullRegion(frustum, x0, z0, xMid, zMid, false, visibleCells);
+	if (xMid < x1)
+	{
+		CullRegion(frustum, xMid, z0, x1, zMid, false, visibleCells);
+	}
+	if (zMid < z1)
+	{
+		CullRegion(frustum, x0, zMid, xMid, z1, false, visibleCells);
+	}
+	if (xMid < x1 && zMid < z1)
+	{
+		CullRegion(frustum, xMid, zMid, x1, z1, false, visibleCells);
+	}
+}
+
+/// <summary>
+/// Sorts cells from the nearest to the farthest from a position, measured between the
+/// position and the center of each cell in the plane of the grid. Drawing opaque cells in
+/// this order lets the depth test reject hidden pixels before they are shaded.
+/// </summary>
+/// <param name="position">World-space position of the viewer</param>
+/// <param name="cells">Cells to sort</param>
+void CellGrid::SortFrontToBack(const glm::vec3& position, std::vector<int>& cells) const
+{
+	// Position of the viewer in cell units, relative to the center of the first cell
+	float gridX = (position.x - origin.x) / CellSize - 0.5f;
+	float gridZ = (position.z - origin.z) / CellSize - 0.5f;
+	auto distanceSquared = [&](int cell)
+	{
+		float dx = cell % width - gridX;
+		float dz = cell / width - gridZ;
+		return dx * dx + dz * dz;
+	};
+
+	// Cells at the same distance keep their index order, so the result does not depend on the sort
+	std::sort(cells.begin(), cells.end(), [&](int a, int b)
+	{
+		float distanceA = distanceSquared(a);
+		float distanceB = distanceSquared(b);
+		return distanceA < distanceB || (distanceA == distanceB && a < b);
+	});
+}
+
+/// <summary>
+/// Appends the tiles of the provided cells to a list.
+/// </summary>
+/// <param name="cells">Cells whose tiles are wanted</param>
+/// <param name="result">List the tiles are appended to</param>
+void CellGrid::GatherTiles(const std::vector<int>& cells, std::vector<Tile>& result) const
+{
+	for (int cell : cells)
+	{
+		result.insert(result.end(), tiles.begin() + cellStart[cell], tiles.begin() + cellStart[cell + 1]);
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Frustum.h"
+#include "Scene.h"
+
+/// <summary>
+/// Sides of a maze cell, in grid space
+/// </summary>
+enum class CellSide
+{
+	NegativeX,
+	PositiveX,
+	NegativeZ,
+	PositiveZ,
+};
+
+/// <summary>
+/// Uniform grid over the 2-unit cells of the maze. The tiles are sorted by the cell
+/// they belong to, so the tiles of any cell form one contiguous range. The grid also
+/// records which cell edges are blocked by a wall.
+/// </summary>
+class CellGrid
+{
+public:
+	/// <summary>
+	/// Size of a maze cell in world units
+	/// </summary>
+	static constexpr float CellSize = 2.0f;
+
+	/// <summary>
+	/// Sorts the tiles into the cells that contain them. Every tile is a face of a cube
+	/// centered on the position of the tile, so it belongs to the cell of that position.
+	/// </summary>
+	/// <param name="mazeTiles">Tiles of the maze</param>
+	void Build(const std::vector<Tile>& mazeTiles);
+
+	/// <summary>
+	/// Tiles of the maze, sorted by cell
+	/// </summary>
+	const std::vector<Tile>& GetTiles() const { return tiles; }
+
+	/// <summary>
+	/// Number of cells along the x-axis
+	/// </summary>
+	int GetWidth() const { return width; }
+
+	/// <summary>
+	/// Number of cells along the z-axis
+	/// </summary>
+	int GetDepth() const { return depth; }
+
+	/// <summary>
+	/// Total number of cells
+	/// </summary>
+	int GetCellCount() const { return width * depth; }
+
+	/// <summary>
+	/// Index of the first tile of a cell in GetTiles()
+	/// </summary>
+	int GetFirstTile(int cell) const { return cellStart[cell]; }
+
+	/// <summary>
+	/// Number of tiles in a cell
+	/// </summary>
+	int GetTileCount(int cell) const { return cellStart[cell + 1] - cellStart[cell]; }
+
+	/// <summary>
+	/// Checks whether a side of a cell is blocked by a wall or by the edge of the grid.
+	/// </summary>
+	/// <param name="x">Column of the cell</param>
+	/// <param name="z">Row of the cell</param>
+	/// <param name="side">Side of the cell</param>
+	/// <returns>True if nothing can be seen or walked through that side</returns>
+	bool IsBlocked(int x, int z, CellSide side) const;
+
+	/// <summary>
+	/// Checks whether a position is between the floor and the top of the walls,
+	/// where the walls of the maze block the view.
+	/// </summary>
+	/// <param name="position">World-space position</param>
+	/// <returns>True if the position is below the top of the walls</returns>
+	bool IsBetweenFloorAndWallTops(const glm::vec3& position) const { return position.y > minY && position.y < maxY; }
+
+	/// <summary>
+	/// Finds the cell containing a position.
+	/// </summary>
+	/// <param name="position">World-space position</param>
+	/// <returns>Index of the cell, or -1 if the position is outside of the grid</returns>
+	int GetCellIndex(const glm::vec3& position) const;
+
+	/// <summary>
+	/// Computes the world-space bounding box of a rectangle of cells.
+	/// </summary>
+	/// <param name="x0">First column</param>
+	/// <param name="z0">First row</param>
+	/// <param name="x1">One past the last column</param>
+	/// <param name="z1">One past the last row</param>
+	/// <param name="boxMin">Receives the minimum corner</param>
+	/// <param name="boxMax">Receives the maximum corner</param>
+	void GetBounds(int x0, int z0, int x1, int z1, glm::vec3& boxMin, glm::vec3& boxMax) const;
+
+	/// <summary>
+	/// Finds every non-empty cell that is at least partially inside the frustum. Rectangles
+	/// of cells are tested recursively, so whole regions are accepted or rejected at once.
+	/// </summary>
+	/// <param name="frustum">View frustum</param>
+	/// <param name="visibleCells">Receives the visible cells, sorted by index</param>
+	void CullFrustum(const Frustum& frustum, std::vector<int>& visibleCells) const;
+
+	/// <summary>
+	/// Sorts cells from the nearest to the farthest from a position, measured between the
+	/// position and the center of each cell in the plane of the grid. Drawing opaque cells in
+	/// this order lets the depth test reject hidden pixels before they are shaded.
+	/// </summary>
+	/// <param name="position">World-space position of the viewer</param>
+	/// <param name="cells">Cells to sort</param>
+	void SortFrontToBack(const glm::vec3& position, std::vector<int>& cells) const;
+
+	/// <summary>
+	/// Appends the tiles of the provided cells to a list.
+	/// </summary>
+	/// <param name="cells">Cells whose tiles are wanted</param>
+	/// <param name="result">List the tiles are appended to</param>
+	void GatherTiles(const std::vector<int>& cells, std::vector<Tile>& result) const;
+
+private:
+	void CullRegion(const Frustum& frustum, int x0, int z0, int x1, int z1, bool inside, std::vector<int>& visibleCells) const;
+
+	std::vector<Tile> tiles;
+	std::vector<int> cellStart;	// First tile of each cell, plus one final entry for the end
+	std::vector<bool> xWalls;	// Walls on the edges of constant x, (width + 1) per row
+	std::vector<bool> zWalls;	// Walls on the edges of constant z, width per row, (depth + 1) rows
+	glm::vec3 origin = glm::vec3(0.0f);	// Minimum corner of the grid
+	float minY = 0.0f, maxY = 0.0f;		// Vertical extent of every cell
+	int width = 0, depth = 0;
+};
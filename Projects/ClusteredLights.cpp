@@ -0,0 +1,362 @@
+#include "ClusteredLights.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "CellGrid.h"
+
+/// <summary>
+/// Creates the texture buffers.
+/// </summary>
+/// <param name="jobSystem">Job system the lights are binned on</param>
+/// <param name="viewportWidth">Width of the viewport in pixels</param>
+/// <param name="viewportHeight">Height of the viewport in pixels</param>
+/// <param name="nearPlane">Distance of the near plane of the projection</param>
+/// <param name="farPlane">Distance of the far plane of the projection</param>
+void ClusteredLights::Create(JobSystem& jobSystem, int viewportWidth, int viewportHeight, float nearPlane, float farPlane)
+{
+	jobs = &jobSystem;
+	nearDistance = nearPlane;
+	farDistance = farPlane;
+	clusterSize = glm::vec2(static_cast<float>(viewportWidth) / ClusterColumns, static_cast<float>(viewportHeight) / ClusterRows);
+	clusterRanges.assign(ClusterCount * 2, 0);
+	sliceIndices.resize(ClusterSlices);
+
+	// Each buffer is read through a texture, which only needs to be attached once
+	GLuint* buffers[3] = { &lightBuffer, &rangeBuffer, &indexBuffer };
+	GLuint* textures[3] = { &lightTexture, &rangeTexture, &indexTexture };
+	GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R16UI };
+	for (int i = 0; i < 3; i++)
+	{
+		glGenBuffers(1, buffers[i]);
+		glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+
+		glGenTextures(1, textures[i]);
+		glBindTexture(GL_TEXTURE_BUFFER, *textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], *buffers[i]);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/// <summary>
+/// Preprocessor symbols that enable the clustered lighting in main.vsh and main.fsh, with
+/// the dimensions of the cluster grid.
+/// </summary>
+/// <returns>Symbols to pass to ShaderProgram::Create()</returns>
+std::vector<std::string> ClusteredLights::GetShaderDefines()
+{
+	return {
+		"CLUSTERED_LIGHTING",
+		"CLUSTER_COLUMNS " + std::to_string(ClusterColumns),
+		"CLUSTER_ROWS " + std::to_string(ClusterRows),
+		"CLUSTER_SLICES " + std::to_string(ClusterSlices),
+	};
+}
+
+/// <summary>
+/// Points the samplers of a program compiled with GetShaderDefines() to the texture units of
+/// the buffers, and gives it the dimensions of the clusters.
+/// </summary>
+/// <param name="program">Program to set up</param>
+void ClusteredLights::ConnectProgram(ShaderProgram& program) const
+{
+	program.Use();
+	program.Set(program.GetUniform<GLint>("lightData"), LightDataTextureUnit);
+	program.Set(program.GetUniform<GLint>("clusterRanges"), ClusterRangesTextureUnit);
+	program.Set(program.GetUniform<GLint>("lightIndices"), LightIndicesTextureUnit);
+	program.Set(program.GetUniform<glm::vec2>("clusterSize"), clusterSize);
+	program.Set(program.GetUniform<glm::vec2>("clusterDepthRange"), glm::vec2(nearDistance, farDistance));
+}
+
+/// <summary>
+/// Bins the lights into the clusters of a view, then uploads the lights and the lists.
+/// </summary>
+/// <param name="lights">Lights of the scene. Lights beyond MaxLights are ignored.</param>
+/// <param name="view">View matrix</param>
+/// <param name="projection">Projection matrix, with the near and far planes given to Create()</param>
+void ClusteredLights::Update(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection)
+{
+	lightCount = static_cast<int>(std::min<std::size_t>(lights.size(), MaxLights));
+	viewX.resize(lightCount);
+	viewY.resize(lightCount);
+	viewZ.resize(lightCount);
+	radii.resize(lightCount);
+	bounds.resize(lightCount);
+	lightData.resize(static_cast<std::size_t>(lightCount) * 2);
+
+	// Move the lights to view space. Each loop works on plain arrays of floats, so the
+	// compiler turns it into SIMD instructions.
+	for (int i = 0; i < lightCount; i++)
+	{
+		viewX[i] = lights[i].position.x;
+		viewY[i] = lights[i].position.y;
+		viewZ[i] = lights[i].position.z;
+		radii[i] = lights[i].radius;
+		lightData[i * 2] = glm::vec4(lights[i].position, lights[i].radius);
+		lightData[i * 2 + 1] = glm::vec4(lights[i].color, 0.0f);
+	}
+	for (int i = 0; i < lightCount; i++)
+	{
+		float x = view[0][0] * viewX[i] + view[1][0] * viewY[i] + view[2][0] * viewZ[i] + view[3][0];
+		float y = view[0][1] * viewX[i] + view[1][1] * viewY[i] + view[2][1] * viewZ[i] + view[3][1];
+		float z = view[0][2] * viewX[i] + view[1][2] * viewY[i] + view[2][2] * viewZ[i] + view[3][2];
+		viewX[i] = x;
+		viewY[i] = y;
+		viewZ[i] = z;
+	}
+
+	// Find the range of clusters of each light. Its sphere is boxed in view space, and the
+	// corners of the box are projected, which bounds the sphere on the screen.
+	jobs->ParallelFor(static_cast<std::size_t>(lightCount), 256, [&](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; i++)
+		{
+			LightBounds& light = bounds[i];
+			light.x0 = light.y0 = light.s0 = 1;
+			light.x1 = light.y1 = light.s1 = 0;
+
+			float depth = -viewZ[i];
+			float nearest = depth - radii[i];
+			float farthest = depth + radii[i];
+			if (farthest < nearDistance || nearest > farDistance)
+			{
+				continue;
+			}
+
+			int x0 = 0, y0 = 0, x1 = ClusterColumns - 1, y1 = ClusterRows - 1;
+			if (nearest > nearDistance)
+			{
+				glm::vec2 screenMin(1.0f), screenMax(-1.0f);
+				for (int corner = 0; corner < 8; corner++)
+				{
+					glm::vec4 position(viewX[i] + (corner & 1 ? radii[i] : -radii[i]), viewY[i] + (corner & 2 ? radii[i] : -radii[i]),
+						viewZ[i] + (corner & 4 ? radii[i] : -radii[i]), 1.0f);
+					glm::vec4 clip = projection * position;
+					glm::vec2 ndc = glm::vec2(clip) / clip.w;
+					screenMin = corner == 0 ? ndc : glm::min(screenMin, ndc);
+					screenMax = corner == 0 ? ndc : glm::max(screenMax, ndc);
+				}
+				if (screenMax.x < -1.0f || screenMax.y < -1.0f || screenMin.x > 1.0f || screenMin.y > 1.0f)
+				{
+					continue;
+				}
+
+				x0 = std::max(static_cast<int>((screenMin.x * 0.5f + 0.5f) * ClusterColumns), 0);
+				y0 = std::max(static_cast<int>((screenMin.y * 0.5f + 0.5f) * ClusterRows), 0);
+				x1 = std::min(static_cast<int>((screenMax.x * 0.5f + 0.5f) * ClusterColumns), ClusterColumns - 1);
+				y1 = std::min(static_cast<int>((screenMax.y * 0.5f + 0.5f) * ClusterRows), ClusterRows - 1);
+			}
+
+			light.x0 = static_cast<std::int16_t>(x0);
+			light.x1 = static_cast<std::int16_t>(x1);
+			light.y0 = static_cast<std::int16_t>(y0);
+			light.y1 = static_cast<std::int16_t>(y1);
+			light.s0 = static_cast<std::int16_t>(GetSlice(std::max(nearest, nearDistance)));
+			light.s1 = static_cast<std::int16_t>(GetSlice(std::min(farthest, farDistance)));
+		}
+	});
+
+	// Every slice lists its lights on its own, so the slices can be binned in parallel
+	jobs->ParallelFor(ClusterSlices, 1, [this](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t slice = begin; slice < end; slice++)
+		{
+			BinSlice(static_cast<int>(slice));
+		}
+	});
+
+	// Join the lists of the slices, and move their ranges to where their slice lands
+	lightIndices.clear();
+	occupiedClusterCount = 0;
+	maxClusterLightCount = 0;
+	for (int slice = 0; slice < ClusterSlices; slice++)
+	{
+		std::uint32_t sliceStart = static_cast<std::uint32_t>(lightIndices.size());
+		lightIndices.insert(lightIndices.end(), sliceIndices[slice].begin(), sliceIndices[slice].end());
+		for (int cluster = slice * ClusterColumns * ClusterRows; cluster < (slice + 1) * ClusterColumns * ClusterRows; cluster++)
+		{
+			clusterRanges[cluster * 2] += sliceStart;
+			occupiedClusterCount += clusterRanges[cluster * 2 + 1] > 0;
+			maxClusterLightCount = std::max(maxClusterLightCount, static_cast<int>(clusterRanges[cluster * 2 + 1]));
+		}
+	}
+
+	// Orphan the buffers, so the upload does not wait for the draws of the previous frame
+	glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max<std::size_t>(lightData.size() * sizeof(glm::vec4), 16), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, lightData.size() * sizeof(glm::vec4), lightData.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, rangeBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, clusterRanges.size() * sizeof(std::uint32_t), clusterRanges.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max<std::size_t>(lightIndices.size() * sizeof(std::uint16_t), 16), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, lightIndices.size() * sizeof(std::uint16_t), lightIndices.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/// <summary>
+/// Binds the texture buffers to their texture units.
+/// </summary>
+void ClusteredLights::Bind() const
+{
+	glActiveTexture(GL_TEXTURE0 + LightDataTextureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, lightTexture);
+	glActiveTexture(GL_TEXTURE0 + ClusterRangesTextureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, rangeTexture);
+	glActiveTexture(GL_TEXTURE0 + LightIndicesTextureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/// <summary>
+/// Deletes the texture buffers.
+/// </summary>
+void ClusteredLights::Destroy()
+{
+	GLuint textures[3] = { lightTexture, rangeTexture, indexTexture };
+	GLuint buffers[3] = { lightBuffer, rangeBuffer, indexBuffer };
+	glDeleteTextures(3, textures);
+	glDeleteBuffers(3, buffers);
+	lightTexture = rangeTexture = indexTexture = 0;
+	lightBuffer = rangeBuffer = indexBuffer = 0;
+}
+
+/// <summary>
+/// Formats the number of lights and how many touch each cluster, for the title bar.
+/// </summary>
+/// <returns>Readout of the last update</returns>
+std::string ClusteredLights::FormatReadout() const
+{
+	char text[128];
+	std::snprintf(text, sizeof(text), "%d lights, %.1f per lit cluster, %d at most", lightCount,
+		occupiedClusterCount > 0 ? static_cast<double>(lightIndices.size()) / occupiedClusterCount : 0.0, maxClusterLightCount);
+	return text;
+}
+
+/// <summary>
+/// Lists the lights of every cluster of one slice, in the slice's own part of the lists.
+/// </summary>
+/// <param name="slice">Index of the slice</param>
+void ClusteredLights::BinSlice(int slice)
+{
+	// Count the lights of each cluster, then place the lists of the clusters one after the
+	// other and fill them in a second pass over the lights
+	const int sliceClusterCount = ClusterColumns * ClusterRows;
+	std::uint32_t* ranges = clusterRanges.data() + slice * sliceClusterCount * 2;
+	for (int cluster = 0; cluster < sliceClusterCount; cluster++)
+	{
+		ranges[cluster * 2] = 0;
+		ranges[cluster * 2 + 1] = 0;
+	}
+
+	for (int i = 0; i < lightCount; i++)
+	{
+		const LightBounds& light = bounds[i];
+		if (slice < light.s0 || slice > light.s1)
+		{
+			continue;
+		}
+		for (int y = light.y0; y <= light.y1; y++)
+		{
+			for (int x = light.x0; x <= light.x1; x++)
+			{
+				std::uint32_t& count = ranges[(y * ClusterColumns + x) * 2 + 1];
+				count = std::min<std::uint32_t>(count + 1, MaxLightsPerCluster);
+			}
+		}
+	}
+
+	std::uint32_t offset = 0;
+	for (int cluster = 0; cluster < sliceClusterCount; cluster++)
+	{
+		ranges[cluster * 2] = offset;
+		offset += ranges[cluster * 2 + 1];
+		ranges[cluster * 2 + 1] = 0;
+	}
+
+	std::vector<std::uint16_t>& indices = sliceIndices[slice];
+	indices.resize(offset);
+	for (int i = 0; i < lightCount; i++)
+	{
+		const LightBounds& light = bounds[i];
+		if (slice < light.s0 || slice > light.s1)
+		{
+			continue;
+		}
+		for (int y = light.y0; y <= light.y1; y++)
+		{
+			for (int x = light.x0; x <= light.x1; x++)
+			{
+				std::uint32_t* range = ranges + (y * ClusterColumns + x) * 2;
+				if (range[1] < MaxLightsPerCluster)
+				{
+					indices[range[0] + range[1]] = static_cast<std::uint16_t>(i);
+					range[1]++;
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Finds the slice containing a view-space depth.
+/// </summary>
+/// <param name="depth">Distance in front of the camera, between the near and far planes</param>
+/// <returns>Index of the slice</returns>
+int ClusteredLights::GetSlice(float depth) const
+{
+	// Slices are thin near the camera and thick far away, so clusters stay roughly cube-shaped
+	int slice = static_cast<int>(std::log(depth / nearDistance) * (ClusterSlices / std::log(farDistance / nearDistance)));
+	return std::min(std::max(slice, 0), ClusterSlices - 1);
+}
+
+/// <summary>
+/// Places a torch in every few cells of a maze around a position, high up in the middle of
+/// the cell, flickering with time. Only the cells within the given distance are visited, so
+/// this also works for mazes too large to light completely.
+/// </summary>
+/// <param name="maze">Maze to light</param>
+/// <param name="center">World-space position the torches are gathered around</param>
+/// <param name="distance">Largest distance of a torch from the center</param>
+/// <param name="spacing">Number of cells between two torches along each axis</param>
+/// <param name="time">Time in seconds, which makes the torches flicker</param>
+/// <param name="lights">Receives the torches</param>
+void GatherTorches(const MazeSource& maze, const glm::vec3& center, float distance, int spacing, float time, std::vector<PointLight>& lights)
+{
+	const float torchRadius = 3.0f * CellGrid::CellSize;
+	const glm::vec3 torchColor(1.0f, 0.55f, 0.2f);
+
+	lights.clear();
+	spacing = std::max(spacing, 1);
+	glm::vec2 centerCell = maze.GetCellCoordinates(center);
+	float reach = distance / CellGrid::CellSize;
+	int x0 = std::max(static_cast<int>(std::floor(centerCell.x - reach)), 0);
+	int z0 = std::max(static_cast<int>(std::floor(centerCell.y - reach)), 0);
+	int x1 = std::min(static_cast<int>(std::ceil(centerCell.x + reach)), maze.GetWidth());
+	int z1 = std::min(static_cast<int>(std::ceil(centerCell.y + reach)), maze.GetDepth());
+
+	// Start on a multiple of the spacing, so the torches stay put as the center moves
+	for (int z = (z0 + spacing - 1) / spacing * spacing; z < z1; z += spacing)
+	{
+		for (int x = (x0 + spacing - 1) / spacing * spacing; x < x1; x += spacing)
+		{
+			glm::vec3 boxMin, boxMax;
+			maze.GetBounds(x, z, x + 1, z + 1, boxMin, boxMax);
+			PointLight torch;
+			torch.position = glm::vec3((boxMin.x + boxMax.x) * 0.5f, boxMin.y + (boxMax.y - boxMin.y) * 0.8f, (boxMin.z + boxMax.z) * 0.5f);
+			if (glm::distance(torch.position, center) > distance)
+			{
+				continue;
+			}
+
+			// Every torch flickers at its own pace
+			float phase = static_cast<float>((x * 73856093u) ^ (z * 19349663u)) * 1e-4f;
+			float flicker = 0.85f + 0.1f * std::sin(time * 11.0f + phase) + 0.05f * std::sin(time * 23.0f + phase * 1.7f);
+			torch.radius = torchRadius;
+			torch.color = torchColor * flicker;
+			lights.push_back(torch);
+		}
+	}
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "MazeSource.h"
+#include "ShaderProgram.h"
+
+/// <summary>
+/// Point light whose influence ends at a given distance
+/// </summary>
+struct PointLight
+{
+	glm::vec3 position;	// World-space position
+	float radius;		// Distance at which the light has faded out completely
+	glm::vec3 color;	// Color, scaled by the intensity
+};
+
+/// <summary>
+/// Texture units the clustered lighting reads its buffers from. Unit 0 holds the texture of the maze.
+/// </summary>
+const GLint LightDataTextureUnit = 1;
+const GLint ClusterRangesTextureUnit = 2;
+const GLint LightIndicesTextureUnit = 3;
+
+/// <summary>
+/// Clustered forward lighting. The view frustum is divided into a grid of clusters: tiles of
+/// the screen, each cut into slices whose depth grows exponentially with the distance. Every
+/// frame, each light is binned on the CPU into the clusters its sphere of influence touches,
+/// and the lists are uploaded through texture buffers. The fragment shader then only loops
+/// over the lights of its own cluster, so its cost depends on how many lights are nearby
+/// rather than on how many there are in total.
+/// </summary>
+class ClusteredLights
+{
+public:
+	static const int ClusterColumns = 16;
+	static const int ClusterRows = 16;
+	static const int ClusterSlices = 24;
+	static const int ClusterCount = ClusterColumns * ClusterRows * ClusterSlices;
+
+	/// <summary>
+	/// Largest number of lights, so that a light index fits in 16 bits
+	/// </summary>
+	static const int MaxLights = 65535;
+
+	/// <summary>
+	/// Largest number of lights per cluster. Further lights touching a full cluster are
+	/// ignored there, which bounds the work of the fragment shader.
+	/// </summary>
+	static const int MaxLightsPerCluster = 128;
+
+	/// <summary>
+	/// Creates the texture buffers.
+	/// </summary>
+	/// <param name="jobSystem">Job system the lights are binned on</param>
+	/// <param name="viewportWidth">Width of the viewport in pixels</param>
+	/// <param name="viewportHeight">Height of the viewport in pixels</param>
+	/// <param name="nearPlane">Distance of the near plane of the projection</param>
+	/// <param name="farPlane">Distance of the far plane of the projection</param>
+	void Create(JobSystem& jobSystem, int viewportWidth, int viewportHeight, float nearPlane, float farPlane);
+
+	/// <summary>
+	/// Preprocessor symbols that enable the clustered lighting in main.vsh and main.fsh, with
+	/// the dimensions of the cluster grid.
+	/// </summary>
+	/// <returns>Symbols to pass to ShaderProgram::Create()</returns>
+	static std::vector<std::string> GetShaderDefines();
+
+	/// <summary>
+	/// Points the samplers of a program compiled with GetShaderDefines() to the texture units of
+	/// the buffers, and gives it the dimensions of the clusters.
+	/// </summary>
+	/// <param name="program">Program to set up</param>
+	void ConnectProgram(ShaderProgram& program) const;
+
+	/// <summary>
+	/// Bins the lights into the clusters of a view, then uploads the lights and the lists.
+	/// </summary>
+	/// <param name="lights">Lights of the scene. Lights beyond MaxLights are ignored.</param>
+	/// <param name="view">View matrix</param>
+	/// <param name="projection">Projection matrix, with the near and far planes given to Create()</param>
+	void Update(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection);
+
+	/// <summary>
+	/// Binds the texture buffers to their texture units.
+	/// </summary>
+	void Bind() const;
+
+	/// <summary>
+	/// Deletes the texture buffers.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Formats the number of lights and how many touch each cluster, for the title bar.
+	/// </summary>
+	/// <returns>Readout of the last update</returns>
+	std::string FormatReadout() const;
+
+private:
+	/// <summary>
+	/// Range of clusters touched by a light, empty if first > last along any axis
+	/// </summary>
+	struct LightBounds
+	{
+		std::int16_t x0, x1;
+		std::int16_t y0, y1;
+		std::int16_t s0, s1;
+	};
+
+	/// <summary>
+	/// Lists the lights of every cluster of one slice, in the slice's own part of the lists.
+	/// </summary>
+	/// <param name="slice">Index of the slice</param>
+	void BinSlice(int slice);
+
+	/// <summary>
+	/// Finds the slice containing a view-space depth.
+	/// </summary>
+	/// <param name="depth">Distance in front of the camera, between the near and far planes</param>
+	/// <returns>Index of the slice</returns>
+	int GetSlice(float depth) const;
+
+	JobSystem* jobs = nullptr;
+	float nearDistance = 0.1f;
+	float farDistance = 100.0f;
+	glm::vec2 clusterSize = glm::vec2(1.0f);	// Size of a tile of clusters, in pixels
+
+	GLuint lightBuffer = 0;
+	GLuint rangeBuffer = 0;
+	GLuint indexBuffer = 0;
+	GLuint lightTexture = 0;
+	GLuint rangeTexture = 0;
+	GLuint indexTexture = 0;
+
+	// Light positions in view space, one array per component, so the transform loop vectorizes
+	std::vector<float> viewX, viewY, viewZ, radii;
+	std::vector<LightBounds> bounds;
+	std::vector<glm::vec4> lightData;			// Position and radius, then color, of every light
+	std::vector<std::uint32_t> clusterRanges;	// First index and number of lights of every cluster
+	std::vector<std::vector<std::uint16_t>> sliceIndices;	// Light lists of each slice, cluster after cluster
+	std::vector<std::uint16_t> lightIndices;
+
+	int lightCount = 0;
+	int occupiedClusterCount = 0;
+	int maxClusterLightCount = 0;
+};
+
+/// <summary>
+/// Places a torch in every few cells of a maze around a position, high up in the middle of
+/// the cell, flickering with time. Only the cells within the given distance are visited, so
+/// this also works for mazes too large to light completely.
+/// </summary>
+/// <param name="maze">Maze to light</param>
+/// <param name="center">World-space position the torches are gathered around</param>
+/// <param name="distance">Largest distance of a torch from the center</param>
+/// <param name="spacing">Number of cells between two torches along each axis</param>
+/// <param name="time">Time in seconds, which makes the torches flicker</param>
+/// <param name="lights">Receives the torches</param>
+void GatherTorches(const MazeSource& maze, const glm::vec3& center, float distance, int spacing, float time, std::vector<PointLight>& lights);
@@ -0,0 +1,150 @@
+#include "DeferredRenderer.h"
+
+#include <iostream>
+
+/// <summary>
+/// Creates the G-buffer and compiles the lighting pass.
+/// </summary>
+/// <param name="gbufferWidth">Width of the G-buffer in pixels</param>
+/// <param name="gbufferHeight">Height of the G-buffer in pixels</param>
+/// <param name="lightingDefines">Preprocessor symbols of the lighting pass, such as those enabling the clustered lights</param>
+/// <returns>True if the G-buffer is complete and the lighting pass linked successfully</returns>
+bool DeferredRenderer::Create(int gbufferWidth, int gbufferHeight, const std::vector<std::string>& lightingDefines)
+{
+	glGenFramebuffers(1, &framebuffer);
+	glGenVertexArrays(1, &emptyVao);
+	bool complete = CreateTargets(gbufferWidth, gbufferHeight);
+
+	bool linked = lightingProgram.Create("deferred.vsh", "deferred.fsh", lightingDefines);
+	lightingProgram.SetUniformBlockBinding("FrameUniforms", FrameUniformsBinding);
+	inverseViewProjectionUniform = lightingProgram.GetUniform<glm::mat4>("inverseViewProjection");
+	gbufferSizeUniform = lightingProgram.GetUniform<glm::vec2>("gbufferSize");
+
+	lightingProgram.Use();
+	lightingProgram.Set(lightingProgram.GetUniform<GLint>("gbufferAlbedo"), GBufferAlbedoTextureUnit);
+	lightingProgram.Set(lightingProgram.GetUniform<GLint>("gbufferNormal"), GBufferNormalTextureUnit);
+	lightingProgram.Set(lightingProgram.GetUniform<GLint>("gbufferDepth"), GBufferDepthTextureUnit);
+
+	return complete && linked;
+}
+
+/// <summary>
+/// Binds and clears the G-buffer, resizing it first if the framebuffer changed size.
+/// </summary>
+/// <param name="framebufferWidth">Width of the framebuffer in pixels</param>
+/// <param name="framebufferHeight">Height of the framebuffer in pixels</param>
+void DeferredRenderer::BeginGeometryPass(int framebufferWidth, int framebufferHeight)
+{
+	if ((framebufferWidth != width || framebufferHeight != height) && framebufferWidth > 0 && framebufferHeight > 0)
+	{
+		DestroyTargets();
+		CreateTargets(framebufferWidth, framebufferHeight);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	// A depth of 1 marks the pixels the lighting pass leaves to the background
+	const GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, clearColor);
+	glClearBufferfv(GL_COLOR, 1, clearColor);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+/// <summary>
+/// Shades every covered pixel of the G-buffer into the default framebuffer, leaving
+/// the background it was cleared to wherever nothing was drawn.
+/// </summary>
+/// <param name="viewProjection">View-projection matrix of the geometry pass</param>
+void DeferredRenderer::DrawLighting(const glm::mat4& viewProjection)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glActiveTexture(GL_TEXTURE0 + GBufferAlbedoTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, albedoTexture);
+	glActiveTexture(GL_TEXTURE0 + GBufferNormalTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, normalTexture);
+	glActiveTexture(GL_TEXTURE0 + GBufferDepthTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	lightingProgram.Use();
+	lightingProgram.Set(inverseViewProjectionUniform, glm::inverse(viewProjection));
+	lightingProgram.Set(gbufferSizeUniform, glm::vec2(static_cast<float>(width), static_cast<float>(height)));
+
+	// Every pixel is shaded exactly once, so the triangle neither tests nor writes depth
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+	glBindVertexArray(emptyVao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glDepthMask(GL_TRUE);
+	glEnable(GL_DEPTH_TEST);
+}
+
+/// <summary>
+/// Deletes the G-buffer and the lighting pass.
+/// </summary>
+void DeferredRenderer::Destroy()
+{
+	DestroyTargets();
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteVertexArrays(1, &emptyVao);
+	framebuffer = 0;
+	emptyVao = 0;
+	lightingProgram.Destroy();
+}
+
+/// <summary>
+/// Creates the textures of the G-buffer and attaches them to the framebuffer.
+/// </summary>
+/// <param name="targetWidth">Width of the targets in pixels</param>
+/// <param name="targetHeight">Height of the targets in pixels</param>
+/// <returns>True if the framebuffer is complete</returns>
+bool DeferredRenderer::CreateTargets(int targetWidth, int targetHeight)
+{
+	width = targetWidth;
+	height = targetHeight;
+
+	// The lighting pass reads one texel per pixel, so the targets need no filtering
+	GLuint* textures[3] = { &albedoTexture, &normalTexture, &depthTexture };
+	const GLenum internalFormats[3] = { GL_RGBA8, GL_RG16, GL_DEPTH_COMPONENT24 };
+	const GLenum formats[3] = { GL_RGBA, GL_RG, GL_DEPTH_COMPONENT };
+	const GLenum types[3] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_UNSIGNED_INT };
+	for (int i = 0; i < 3; i++)
+	{
+		glGenTextures(1, textures[i]);
+		glBindTexture(GL_TEXTURE_2D, *textures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], width, height, 0, formats[i], types[i], nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	if (!complete)
+	{
+		std::cerr << "G-buffer of " << width << " by " << height << " pixels is incomplete" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return complete;
+}
+
+/// <summary>
+/// Deletes the textures of the G-buffer.
+/// </summary>
+void DeferredRenderer::DestroyTargets()
+{
+	GLuint textures[3] = { albedoTexture, normalTexture, depthTexture };
+	glDeleteTextures(3, textures);
+	albedoTexture = normalTexture = depthTexture = 0;
+}
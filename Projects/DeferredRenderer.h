@@ -0,0 +1,101 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "FrameUniforms.h"
+#include "ShaderProgram.h"
+
+/// <summary>
+/// Texture units the lighting pass reads the G-buffer from. Units 1 to 3 hold the buffers of
+/// the clustered lights.
+/// </summary>
+const GLint GBufferAlbedoTextureUnit = 4;
+const GLint GBufferNormalTextureUnit = 5;
+const GLint GBufferDepthTextureUnit = 6;
+
+/// <summary>
+/// Deferred shading. The geometry pass draws the scene with main.fsh compiled for
+/// GBUFFER_PASS, which writes a compact G-buffer instead of shading:
+///   - albedo from tex in an RGBA8 target, with the light of lightLoc in alpha, since that
+///     light depends on per-vertex inputs that the G-buffer does not keep,
+///   - the normal in an RG16 target, octahedral-encoded (see gbuffer.glsl),
+///   - 24-bit depth, from which the lighting pass rebuilds the world-space position.
+/// The lighting pass then draws one triangle over the screen and shades each pixel once,
+/// adding up the point lights of its cluster (see ClusteredLights.h) instead of shading
+/// every fragment the depth test let through.
+/// </summary>
+class DeferredRenderer
+{
+public:
+	/// <summary>
+	/// Creates the G-buffer and compiles the lighting pass.
+	/// </summary>
+	/// <param name="gbufferWidth">Width of the G-buffer in pixels</param>
+	/// <param name="gbufferHeight">Height of the G-buffer in pixels</param>
+	/// <param name="lightingDefines">Preprocessor symbols of the lighting pass, such as those enabling the clustered lights</param>
+	/// <returns>True if the G-buffer is complete and the lighting pass linked successfully</returns>
+	bool Create(int gbufferWidth, int gbufferHeight, const std::vector<std::string>& lightingDefines);
+
+	/// <summary>
+	/// Preprocessor symbols that turn main.fsh into the geometry pass.
+	/// </summary>
+	/// <returns>Symbols to pass to ShaderVariants::Create()</returns>
+	static std::vector<std::string> GetGeometryDefines() { return { "GBUFFER_PASS" }; }
+
+	/// <summary>
+	/// Binds and clears the G-buffer, resizing it first if the framebuffer changed size.
+	/// </summary>
+	/// <param name="framebufferWidth">Width of the framebuffer in pixels</param>
+	/// <param name="framebufferHeight">Height of the framebuffer in pixels</param>
+	void BeginGeometryPass(int framebufferWidth, int framebufferHeight);
+
+	/// <summary>
+	/// Shades every covered pixel of the G-buffer into the default framebuffer, leaving
+	/// the background it was cleared to wherever nothing was drawn.
+	/// </summary>
+	/// <param name="viewProjection">View-projection matrix of the geometry pass</param>
+	void DrawLighting(const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Deletes the G-buffer and the lighting pass.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Program of the lighting pass, for uniforms set by other subsystems
+	/// </summary>
+	ShaderProgram& GetLightingProgram() { return lightingProgram; }
+
+	/// <summary>
+	/// Bytes of GPU memory taken by each pixel of the G-buffer
+	/// </summary>
+	static const int BytesPerPixel = 4 + 4 + 4;
+
+private:
+	/// <summary>
+	/// Creates the textures of the G-buffer and attaches them to the framebuffer.
+	/// </summary>
+	/// <param name="targetWidth">Width of the targets in pixels</param>
+	/// <param name="targetHeight">Height of the targets in pixels</param>
+	/// <returns>True if the framebuffer is complete</returns>
+	bool CreateTargets(int targetWidth, int targetHeight);
+
+	/// <summary>
+	/// Deletes the textures of the G-buffer.
+	/// </summary>
+	void DestroyTargets();
+
+	GLuint framebuffer = 0;
+	GLuint albedoTexture = 0;
+	GLuint normalTexture = 0;
+	GLuint depthTexture = 0;
+	GLuint emptyVao = 0;	// The screen triangle has no vertex attributes, but core profiles need a bound VAO
+	int width = 0, height = 0;
+
+	ShaderProgram lightingProgram;
+	UniformHandle<glm::mat4> inverseViewProjectionUniform;
+	UniformHandle<glm::vec2> gbufferSizeUniform;
+};
@@ -0,0 +1,187 @@
+#include "FramePacer.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/// <summary>
+/// Applies a pacing mode to the current OpenGL context.
+/// </summary>
+/// <param name="pacingMode">Mode to use</param>
+/// <param name="targetFramesPerSecond">Frame rate of the capped mode</param>
+void FramePacer::Create(PacingMode pacingMode, double targetFramesPerSecond)
+{
+	mode = pacingMode;
+	hasLastFrame = false;
+	intervalsMs.clear();
+	nextInterval = 0;
+
+	// Adaptive v-sync needs an extension; without it, fall back to regular v-sync
+	if (mode == PacingMode::AdaptiveVSync && !glfwExtensionSupported("WGL_EXT_swap_control_tear")
+		&& !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+	{
+		std::cerr << "Adaptive v-sync is not supported, using v-sync instead" << std::endl;
+		mode = PacingMode::VSync;
+	}
+
+	switch (mode)
+	{
+	case PacingMode::VSync:			glfwSwapInterval(1);	break;
+	case PacingMode::AdaptiveVSync:	glfwSwapInterval(-1);	break;
+	default:						glfwSwapInterval(0);	break;
+	}
+
+	if (mode == PacingMode::Capped)
+	{
+		period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFramesPerSecond));
+		nextFrame = Clock::now() + period;
+
+#ifdef _WIN32
+		// By default, Windows only wakes sleeping threads every 15.6 ms
+		timerResolutionRaised = timeBeginPeriod(1) == TIMERR_NOERROR;
+#endif
+	}
+}
+
+/// <summary>
+/// Waits until the next frame is due. Call right before presenting. Only the capped mode waits.
+/// </summary>
+void FramePacer::Wait()
+{
+	if (mode != PacingMode::Capped)
+	{
+		return;
+	}
+
+	SleepUntil(nextFrame);
+
+	// Keep the deadlines on a fixed grid, so a late frame does not push back every frame
+	// after it, unless the frame was so late that catching up would mean several frames
+	// back to back
+	nextFrame += period;
+	Clock::time_point now = Clock::now();
+	if (now > nextFrame)
+	{
+		nextFrame = now + period;
+	}
+}
+
+/// <summary>
+/// Records the time since the previous frame. Call right after presenting.
+/// </summary>
+void FramePacer::EndFrame()
+{
+	Clock::time_point now = Clock::now();
+	if (hasLastFrame)
+	{
+		double intervalMs = std::chrono::duration<double, std::milli>(now - lastFrame).count();
+		if (intervalsMs.size() < static_cast<std::size_t>(IntervalWindow))
+		{
+			intervalsMs.push_back(intervalMs);
+		}
+		else
+		{
+			intervalsMs[nextInterval] = intervalMs;
+		}
+		nextInterval = (nextInterval + 1) % IntervalWindow;
+		UpdateStatistics();
+	}
+
+	lastFrame = now;
+	hasLastFrame = true;
+}
+
+/// <summary>
+/// Restores the timer resolution of the system.
+/// </summary>
+void FramePacer::Destroy()
+{
+#ifdef _WIN32
+	if (timerResolutionRaised)
+	{
+		timeEndPeriod(1);
+	}
+#endif
+	timerResolutionRaised = false;
+	mode = PacingMode::Uncapped;
+}
+
+/// <summary>
+/// Formats the pacing statistics of the recent frames.
+/// </summary>
+/// <returns>One line of text, such as "capped 60.0 fps, 16.67 ms +/- 0.05 ms"</returns>
+std::string FramePacer::FormatReadout() const
+{
+	const char* modeNames[] = { "uncapped", "vsync", "adaptive vsync", "capped" };
+	char text[128];
+	std::snprintf(text, sizeof(text), "%s %.1f fps, %.2f ms +/- %.2f ms (worst %.2f ms)", modeNames[static_cast<int>(mode)],
+		meanIntervalMs > 0.0 ? 1000.0 / meanIntervalMs : 0.0, meanIntervalMs, jitterMs, worstDeviationMs);
+	return text;
+}
+
+/// <summary>
+/// Sleeps in short slices until the remaining time is shorter than a slice is likely to
+/// take, then spins until the deadline.
+/// </summary>
+/// <param name="deadline">Time to return at</param>
+void FramePacer::SleepUntil(Clock::time_point deadline)
+{
+	// A slice is assumed to take its average length plus one standard deviation, which
+	// leaves the spin with a fraction of a millisecond on most systems
+	for (;;)
+	{
+		double remainingMs = std::chrono::duration<double, std::milli>(deadline - Clock::now()).count();
+		double sliceEstimateMs = sleepMean + std::sqrt(sleepM2 / sleepCount);
+		if (remainingMs <= sliceEstimateMs)
+		{
+			break;
+		}
+
+		Clock::time_point start = Clock::now();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		double observedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		sleepCount++;
+		double delta = observedMs - sleepMean;
+		sleepMean += delta / sleepCount;
+		sleepM2 += delta * (observedMs - sleepMean);
+	}
+
+	while (Clock::now() < deadline)
+	{
+		std::this_thread::yield();
+	}
+}
+
+/// <summary>
+/// Updates the statistics from the recorded intervals.
+/// </summary>
+void FramePacer::UpdateStatistics()
+{
+	double sum = 0.0;
+	for (double interval : intervalsMs)
+	{
+		sum += interval;
+	}
+	meanIntervalMs = sum / intervalsMs.size();
+
+	double squaredDeviations = 0.0;
+	worstDeviationMs = 0.0;
+	for (double interval : intervalsMs)
+	{
+		double deviation = std::abs(interval - meanIntervalMs);
+		squaredDeviations += deviation * deviation;
+		if (deviation > worstDeviationMs)
+		{
+			worstDeviationMs = deviation;
+		}
+	}
+	jitterMs = std::sqrt(squaredDeviations / intervalsMs.size());
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// How the frame rate is limited
+/// </summary>
+enum class PacingMode
+{
+	Uncapped,		// Present as fast as possible
+	VSync,			// Wait for the vertical blank of the display
+	AdaptiveVSync,	// Wait for the vertical blank, but present late frames immediately instead of waiting for the next one
+	Capped,			// Limit the frame rate with a timer on the CPU
+};
+
+/// <summary>
+/// Limits and measures the frame rate. V-sync modes set the swap interval, while the capped
+/// mode waits on the CPU until the next frame is due. That wait sleeps while the deadline is
+/// far enough away for the scheduler to wake the thread up in time, then spins for the last
+/// fraction of a millisecond, so frames are evenly spaced without keeping a core busy.
+/// </summary>
+class FramePacer
+{
+public:
+	/// <summary>
+	/// Applies a pacing mode to the current OpenGL context.
+	/// </summary>
+	/// <param name="pacingMode">Mode to use</param>
+	/// <param name="targetFramesPerSecond">Frame rate of the capped mode</param>
+	void Create(PacingMode pacingMode, double targetFramesPerSecond = 60.0);
+
+	/// <summary>
+	/// Waits until the next frame is due. Call right before presenting. Only the capped mode waits.
+	/// </summary>
+	void Wait();
+
+	/// <summary>
+	/// Records the time since the previous frame. Call right after presenting.
+	/// </summary>
+	void EndFrame();
+
+	/// <summary>
+	/// Restores the timer resolution of the system.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Formats the pacing statistics of the recent frames.
+	/// </summary>
+	/// <returns>One line of text, such as "capped 60.0 fps, 16.67 ms +/- 0.05 ms"</returns>
+	std::string FormatReadout() const;
+
+	/// <summary>
+	/// Average time between two recent frames, in milliseconds
+	/// </summary>
+	double GetMeanIntervalMs() const { return meanIntervalMs; }
+
+	/// <summary>
+	/// Standard deviation of the time between two recent frames, in milliseconds
+	/// </summary>
+	double GetJitterMs() const { return jitterMs; }
+
+	/// <summary>
+	/// Largest difference between the time between two recent frames and the average, in milliseconds
+	/// </summary>
+	double GetWorstDeviationMs() const { return worstDeviationMs; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	/// <summary>
+	/// Sleeps in short slices until the remaining time is shorter than a slice is likely to
+	/// take, then spins until the deadline.
+	/// </summary>
+	/// <param name="deadline">Time to return at</param>
+	void SleepUntil(Clock::time_point deadline);
+
+	/// <summary>
+	/// Updates the statistics from the recorded intervals.
+	/// </summary>
+	void UpdateStatistics();
+
+	static const int IntervalWindow = 120;	// Number of recent frames the statistics cover
+
+	PacingMode mode = PacingMode::Uncapped;
+	bool timerResolutionRaised = false;
+	Clock::duration period = Clock::duration::zero();
+	Clock::time_point nextFrame;
+	Clock::time_point lastFrame;
+	bool hasLastFrame = false;
+
+	// Running estimate of how long a 1 ms sleep really takes (Welford's algorithm)
+	double sleepMean = 1.0;
+	double sleepM2 = 0.0;
+	long long sleepCount = 1;
+
+	std::vector<double> intervalsMs;	// Ring of the recent intervals
+	int nextInterval = 0;
+	double meanIntervalMs = 0.0;
+	double jitterMs = 0.0;
+	double worstDeviationMs = 0.0;
+};
@@ -0,0 +1,36 @@
+#include "FrameUniforms.h"
+
+/// <summary>
+/// Prepares the uniforms to be written to the provided stream buffer.
+/// </summary>
+/// <param name="streamBuffer">Buffer the values are allocated from every frame</param>
+void FrameUniforms::Create(StreamBuffer& streamBuffer)
+{
+	stream = &streamBuffer;
+
+	// glBindBufferRange only accepts offsets that are a multiple of this alignment
+	GLint offsetAlignment = 1;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+	alignment = offsetAlignment;
+}
+
+/// <summary>
+/// Writes the values to the stream buffer and binds them to FrameUniformsBinding.
+/// </summary>
+/// <param name="data">Values for this frame</param>
+void FrameUniforms::Upload(const FrameUniformData& data)
+{
+	GLintptr offset = stream->Write(&data, sizeof(FrameUniformData), alignment);
+	if (offset >= 0)
+	{
+		glBindBufferRange(GL_UNIFORM_BUFFER, FrameUniformsBinding, stream->GetBuffer(), offset, sizeof(FrameUniformData));
+	}
+}
+
+/// <summary>
+/// Releases the stream buffer.
+/// </summary>
+void FrameUniforms::Destroy()
+{
+	stream = nullptr;
+}
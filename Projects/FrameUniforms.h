@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "StreamBuffer.h"
+
+/// <summary>
+/// Uniform buffer binding point that the FrameUniforms block of every program reads from
+/// </summary>
+const GLuint FrameUniformsBinding = 0;
+
+/// <summary>
+/// CPU-side copy of the FrameUniforms block declared in frame.glsl. The members follow
+/// the std140 layout: each vec3 takes 16 bytes, so a float is packed after every one.
+/// </summary>
+struct FrameUniformData
+{
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+
+	glm::vec3 ambientLightColor = glm::vec3(0.0f);
+	GLfloat shiny = 0.0f;
+
+	glm::vec3 diffuseLightColor = glm::vec3(0.0f);
+	GLfloat time = 0.0f;
+
+	glm::vec3 specularLightColor = glm::vec3(0.0f);
+	GLfloat padding0 = 0.0f;
+
+	glm::vec3 objectSpecularColor = glm::vec3(0.0f);
+	GLfloat padding1 = 0.0f;
+
+	glm::vec3 lightLoc = glm::vec3(0.0f);
+	GLfloat padding2 = 0.0f;
+
+	glm::vec3 camLoc = glm::vec3(0.0f);
+	GLfloat padding3 = 0.0f;
+};
+
+static_assert(sizeof(FrameUniformData) == 160, "FrameUniformData must match the std140 layout of the FrameUniforms block");
+
+/// <summary>
+/// Uploads the per-frame uniform values once for every program that uses them. The values
+/// are written to the stream buffer, so each frame gets its own copy and writing this
+/// frame's values never has to wait for the GPU to finish reading those of earlier frames.
+/// </summary>
+class FrameUniforms
+{
+public:
+	/// <summary>
+	/// Prepares the uniforms to be written to the provided stream buffer.
+	/// </summary>
+	/// <param name="streamBuffer">Buffer the values are allocated from every frame</param>
+	void Create(StreamBuffer& streamBuffer);
+
+	/// <summary>
+	/// Writes the values to the stream buffer and binds them to FrameUniformsBinding.
+	/// </summary>
+	/// <param name="data">Values for this frame</param>
+	void Upload(const FrameUniformData& data);
+
+	/// <summary>
+	/// Releases the stream buffer.
+	/// </summary>
+	void Destroy();
+
+private:
+	StreamBuffer* stream = nullptr;
+	GLsizeiptr alignment = 1;
+};
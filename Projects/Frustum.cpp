@@ -0,0 +1,64 @@
+#include "Frustum.h"
+
+/// <summary>
+/// Extracts the frustum planes from a view-projection matrix.
+/// </summary>
+/// <param name="viewProjection">Projection matrix multiplied by the view matrix</param>
+/// <returns>The frustum seen through the matrix</returns>
+Frustum Frustum::FromMatrix(const glm::mat4& viewProjection)
+{
+	// glm matrices are column-major, so gather the rows first
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	// A point is inside the frustum when -w <= x, y, z <= w in clip space
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];	// Left
+	frustum.planes[1] = rows[3] - rows[0];	// Right
+	frustum.planes[2] = rows[3] + rows[1];	// Bottom
+	frustum.planes[3] = rows[3] - rows[1];	// Top
+	frustum.planes[4] = rows[3] + rows[2];	// Near
+	frustum.planes[5] = rows[3] - rows[2];	// Far
+
+	for (glm::vec4& plane : frustum.planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return frustum;
+}
+
+/// <summary>
+/// Tests an axis-aligned box against the frustum.
+/// </summary>
+/// <param name="boxMin">Minimum corner of the box</param>
+/// <param name="boxMax">Maximum corner of the box</param>
+/// <returns>Whether the box is outside, partially inside, or completely inside</returns>
+FrustumTest Frustum::TestBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	FrustumTest result = FrustumTest::Inside;
+
+	for (const glm::vec4& plane : planes)
+	{
+		glm::vec3 normal = glm::vec3(plane);
+
+		// The corner furthest along the plane normal, and the one furthest against it
+		glm::vec3 positive = glm::mix(boxMin, boxMax, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+		glm::vec3 negative = glm::mix(boxMax, boxMin, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+
+		if (glm::dot(normal, positive) + plane.w < 0.0f)
+		{
+			return FrustumTest::Outside;
+		}
+
+		if (glm::dot(normal, negative) + plane.w < 0.0f)
+		{
+			result = FrustumTest::Intersecting;
+		}
+	}
+
+	return result;
+}
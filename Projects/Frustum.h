@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/// <summary>
+/// Result of testing a box against a frustum
+/// </summary>
+enum class FrustumTest
+{
+	Outside,		// The box is completely outside of the frustum
+	Intersecting,	// The box is partially inside of the frustum
+	Inside,			// The box is completely inside of the frustum
+};
+
+/// <summary>
+/// The six planes of a view frustum, in world space
+/// </summary>
+struct Frustum
+{
+	// Each plane is stored as (normal, distance), with the normal pointing into the frustum
+	glm::vec4 planes[6];
+
+	/// <summary>
+	/// Extracts the frustum planes from a view-projection matrix.
+	/// </summary>
+	/// <param name="viewProjection">Projection matrix multiplied by the view matrix</param>
+	/// <returns>The frustum seen through the matrix</returns>
+	static Frustum FromMatrix(const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Tests an axis-aligned box against the frustum.
+	/// </summary>
+	/// <param name="boxMin">Minimum corner of the box</param>
+	/// <param name="boxMax">Maximum corner of the box</param>
+	/// <returns>Whether the box is outside, partially inside, or completely inside</returns>
+	FrustumTest TestBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+};
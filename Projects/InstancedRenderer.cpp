@@ -0,0 +1,214 @@
+#include "InstancedRenderer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+	/// <summary>
+	/// Builds the model matrix of a tile.
+	/// </summary>
+	/// <param name="tile">Tile of the maze</param>
+	/// <returns>Matrix moving the cube face to the position of the tile</returns>
+	glm::mat4 GetTileModel(const Tile& tile)
+	{
+		return glm::translate(glm::mat4(1.0f), tile.position);
+	}
+}
+
+/// <summary>
+/// Creates one vertex array object per cube face. Each of them reads the cube
+/// vertices from the provided mesh, and the model matrices of the tiles with
+/// that face from the stream buffer. The tiles never move, so the shader variant
+/// of each face is found here, from the most expensive transform among its tiles.
+/// </summary>
+/// <param name="cubeMesh">Cube mesh, with one submesh per face in TileFace order</param>
+/// <param name="streamBuffer">Buffer the model matrices are written to every frame</param>
+/// <param name="jobSystem">Job system that writes the matrices of large tile lists in parallel</param>
+/// <param name="sourceTiles">Every tile that SetTiles() can be given, classified once here</param>
+void InstancedRenderer::Create(const Mesh& cubeMesh, StreamBuffer& streamBuffer, JobSystem& jobSystem, const std::vector<Tile>& sourceTiles)
+{
+	mesh = &cubeMesh;
+	stream = &streamBuffer;
+	jobs = &jobSystem;
+
+	// A face batch drawn with a subset of its tiles still uses the variant of the whole
+	// face, which at worst writes normal matrices a cheaper variant would not read
+	for (Batch& batch : batches)
+	{
+		batch.transformClass = TransformClass::Translation;
+	}
+	for (const Tile& tile : sourceTiles)
+	{
+		Batch& batch = batches[static_cast<int>(tile.face)];
+		batch.transformClass = std::max(batch.transformClass, ClassifyTransform(GetTileModel(tile)));
+	}
+
+	for (Batch& batch : batches)
+	{
+		glGenVertexArrays(1, &batch.vao);
+		glBindVertexArray(batch.vao);
+
+		// Vertex attributes 0, 2 and 12 - Position, UV coordinate and normal, along with the index buffer
+		cubeMesh.SetAttributes();
+
+		// Vertex attributes 3 to 6 - Model matrix, and 8 to 11 - Normal matrix, one column
+		// per attribute. The pointers themselves are set in SetTiles(), once the batch
+		// offsets are known, and the normal matrix is only enabled for the general variant.
+		for (int column = 0; column < 4; column++)
+		{
+			glEnableVertexAttribArray(3 + column);
+			glVertexAttribDivisor(3 + column, 1);
+			glVertexAttribDivisor(8 + column, 1);
+		}
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/// <summary>
+/// Groups the tiles by face and writes their model matrices to the stream buffer,
+/// along with their normal matrices for faces that need the general shader variant.
+/// Can be called several times per frame, since every call gets its own range.
+/// </summary>
+/// <param name="tiles">Tiles to draw</param>
+void InstancedRenderer::SetTiles(const std::vector<Tile>& tiles)
+{
+	// Count the tiles of each face so that every batch gets a contiguous range
+	GLsizei counts[TileFaceCount] = {};
+	for (const Tile& tile : tiles)
+	{
+		counts[static_cast<int>(tile.face)]++;
+	}
+
+	// Normal matrices follow the model matrices, but only the general batches need them
+	GLsizei offset = 0;
+	bool needsNormals = false;
+	for (int face = 0; face < TileFaceCount; face++)
+	{
+		batches[face].firstInstance = offset;
+		batches[face].instanceCount = 0;
+		offset += counts[face];
+		needsNormals = needsNormals || (counts[face] > 0 && batches[face].transformClass == TransformClass::General);
+	}
+
+	if (tiles.empty())
+	{
+		return;
+	}
+
+	// The matrices are written straight into the mapped range, without a copy on the CPU
+	GLintptr baseOffset = 0;
+	std::size_t matrixCount = needsNormals ? tiles.size() * 2 : tiles.size();
+	glm::mat4* models = static_cast<glm::mat4*>(stream->Map(matrixCount * sizeof(glm::mat4), sizeof(glm::vec4), baseOffset));
+	if (models == nullptr)
+	{
+		return;
+	}
+
+	// Hand out the instances in order first, so the matrices can then be written in any
+	// order. Small lists are not worth splitting, so they are written on this thread.
+	instanceSlots.resize(tiles.size());
+	for (std::size_t i = 0; i < tiles.size(); i++)
+	{
+		Batch& batch = batches[static_cast<int>(tiles[i].face)];
+		instanceSlots[i] = batch.firstInstance + batch.instanceCount;
+		batch.instanceCount++;
+	}
+
+	glm::mat4* normals = models + tiles.size();
+	jobs->ParallelFor(tiles.size(), 1024, [&](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; i++)
+		{
+			GLsizei instance = instanceSlots[i];
+			models[instance] = GetTileModel(tiles[i]);
+			if (batches[static_cast<int>(tiles[i].face)].transformClass == TransformClass::General)
+			{
+				normals[instance] = ComputeNormalMatrix(models[instance]);
+			}
+		}
+	});
+
+	stream->Unmap();
+
+	// GL 3.3 has no base instance, so each batch points its matrix attributes at its own range
+	glBindBuffer(GL_ARRAY_BUFFER, stream->GetBuffer());
+	for (Batch& batch : batches)
+	{
+		glBindVertexArray(batch.vao);
+		bool general = batch.transformClass == TransformClass::General;
+		for (int column = 0; column < 4; column++)
+		{
+			std::size_t columnOffset = baseOffset + batch.firstInstance * sizeof(glm::mat4) + column * sizeof(glm::vec4);
+			glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)columnOffset);
+
+			if (general)
+			{
+				std::size_t normalOffset = columnOffset + tiles.size() * sizeof(glm::mat4);
+				glVertexAttribPointer(8 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)normalOffset);
+				glEnableVertexAttribArray(8 + column);
+			}
+			else
+			{
+				glDisableVertexAttribArray(8 + column);
+			}
+		}
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/// <summary>
+/// Issues one instanced draw call for each face that has at least one tile,
+/// using the cheapest shader variant that can handle the model matrices of the face.
+/// </summary>
+/// <param name="shaders">Variants of the scene program</param>
+void InstancedRenderer::Draw(ShaderVariants& shaders)
+{
+	drawCount = 0;
+	drawnTriangleCount = 0;
+
+	// The cube is not baked to world space, so its tile origin decodes to zero
+	const PositionQuantization& quantization = mesh->GetQuantization();
+	glm::vec3 tileOrigin = -quantization.offset / quantization.GetScale();
+	SetPackedVertexConstants(quantization);
+	glVertexAttrib3f(TileOriginAttribute, tileOrigin.x, tileOrigin.y, tileOrigin.z);
+
+	for (int face = 0; face < TileFaceCount; face++)
+	{
+		const Batch& batch = batches[face];
+		if (batch.instanceCount == 0)
+		{
+			continue;
+		}
+
+		shaders.Use(batch.transformClass);
+		glBindVertexArray(batch.vao);
+		glDrawElementsInstanced(GL_TRIANGLES, mesh->GetIndexCount(face), mesh->GetIndexType(), mesh->GetIndexOffset(face), batch.instanceCount);
+		drawCount++;
+		drawnTriangleCount += batch.instanceCount * (mesh->GetIndexCount(face) / 3);
+	}
+
+	glBindVertexArray(0);
+}
+
+/// <summary>
+/// Deletes the buffers and vertex array objects owned by the renderer.
+/// </summary>
+void InstancedRenderer::Destroy()
+{
+	for (Batch& batch : batches)
+	{
+		glDeleteVertexArrays(1, &batch.vao);
+		batch.vao = 0;
+	}
+
+	mesh = nullptr;
+	stream = nullptr;
+	jobs = nullptr;
+}
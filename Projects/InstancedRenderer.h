@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "Scene.h"
+#include "ShaderVariants.h"
+#include "StreamBuffer.h"
+
+/// <summary>
+/// Draws every tile that shares a cube face with a single glDrawElementsInstanced() call.
+/// The model matrix of each tile is stored in a per-instance vertex attribute
+/// (locations 3 to 6), so no uniforms need to be uploaded per tile.
+/// </summary>
+class InstancedRenderer
+{
+public:
+	/// <summary>
+	/// Creates one vertex array object per cube face. Each of them reads the cube
+	/// vertices from the provided mesh, and the model matrices of the tiles with
+	/// that face from the stream buffer. The tiles never move, so the shader variant
+	/// of each face is found here, from the most expensive transform among its tiles.
+	/// </summary>
+	/// <param name="cubeMesh">Cube mesh, with one submesh per face in TileFace order</param>
+	/// <param name="streamBuffer">Buffer the model matrices are written to every frame</param>
+	/// <param name="jobSystem">Job system that writes the matrices of large tile lists in parallel</param>
+	/// <param name="sourceTiles">Every tile that SetTiles() can be given, classified once here</param>
+	void Create(const Mesh& cubeMesh, StreamBuffer& streamBuffer, JobSystem& jobSystem, const std::vector<Tile>& sourceTiles);
+
+	/// <summary>
+	/// Groups the tiles by face and writes their model matrices to the stream buffer,
+	/// along with their normal matrices for faces that need the general shader variant.
+	/// Can be called several times per frame, since every call gets its own range.
+	/// </summary>
+	/// <param name="tiles">Tiles to draw</param>
+	void SetTiles(const std::vector<Tile>& tiles);
+
+	/// <summary>
+	/// Issues one instanced draw call for each face that has at least one tile,
+	/// using the cheapest shader variant that can handle the model matrices of the face.
+	/// </summary>
+	/// <param name="shaders">Variants of the scene program</param>
+	void Draw(ShaderVariants& shaders);
+
+	/// <summary>
+	/// Deletes the buffers and vertex array objects owned by the renderer.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Number of draw calls issued by the last call to Draw()
+	/// </summary>
+	int GetDrawCount() const { return drawCount; }
+
+	/// <summary>
+	/// Number of triangles drawn by the last call to Draw()
+	/// </summary>
+	GLsizei GetTriangleCount() const { return drawnTriangleCount; }
+
+private:
+	/// <summary>
+	/// Instances of a single cube face, stored contiguously in the stream buffer
+	/// </summary>
+	struct Batch
+	{
+		GLuint vao = 0;				// Vertex array object pointing at this batch's instances
+		GLsizei firstInstance = 0;	// Index of the first instance in the range of the last SetTiles()
+		GLsizei instanceCount = 0;	// Number of instances in this batch
+		TransformClass transformClass = TransformClass::Translation;	// Most expensive class of the face's tiles
+	};
+
+	const Mesh* mesh = nullptr;
+	StreamBuffer* stream = nullptr;
+	JobSystem* jobs = nullptr;
+	std::vector<GLsizei> instanceSlots;	// Instance written for each tile of the last SetTiles()
+	Batch batches[TileFaceCount];
+	int drawCount = 0;
+	GLsizei drawnTriangleCount = 0;
+};
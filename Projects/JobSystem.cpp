@@ -0,0 +1,306 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Job system and queue the current thread works for. Threads that were not started by a
+	// job system, such as the main thread, use the first queue of any job system.
+	thread_local const JobSystem* currentSystem = nullptr;
+	thread_local unsigned currentWorker = 0;
+}
+
+/// <summary>
+/// Starts the worker threads.
+/// </summary>
+/// <param name="workerCount">Number of threads running jobs, counting the main thread,
+/// or 0 to use one per hardware thread</param>
+void JobSystem::Create(unsigned workerCount)
+{
+	if (workerCount == 0)
+	{
+		workerCount = std::thread::hardware_concurrency();
+	}
+	if (workerCount == 0)
+	{
+		workerCount = 1;
+	}
+
+	stopping = false;
+	queuedJobCount = 0;
+	for (unsigned i = 0; i < workerCount; i++)
+	{
+		queues.emplace_back(new WorkerQueue());
+		queues.back()->pool = std::vector<Job>(MaxJobsPerThread);
+	}
+
+	// The calling thread is the first worker, and only runs jobs while it waits for them
+	for (unsigned i = 1; i < workerCount; i++)
+	{
+		threads.emplace_back(&JobSystem::WorkerMain, this, i);
+	}
+}
+
+/// <summary>
+/// Stops the worker threads once they finish their current job. Jobs that were never
+/// started are dropped.
+/// </summary>
+void JobSystem::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	threads.clear();
+	queues.clear();
+}
+
+/// <summary>
+/// Creates a job without starting it. Jobs can be created by the thread that called
+/// Create() and by running jobs. When every job the calling thread created is still
+/// pending, the thread runs queued jobs until one of them finishes.
+/// </summary>
+/// <param name="function">Work to do</param>
+/// <param name="parent">Job that is not finished until this one is, or nullptr</param>
+/// <returns>The job, owned by the job system and valid until it is finished or until the
+/// next call to Destroy()</returns>
+Job* JobSystem::CreateJob(std::function<void()> function, Job* parent)
+{
+	// The pool belongs to the calling thread, so taking a job from it needs no lock
+	WorkerQueue& queue = GetCurrentQueue();
+	Job* job = nullptr;
+	while (job == nullptr)
+	{
+		// Jobs usually finish in the order they were created, so the oldest slot is almost
+		// always free. A job that is still queued or running keeps its slot, and the ring is
+		// searched past it.
+		for (std::size_t i = 0; i < MaxJobsPerThread; i++)
+		{
+			Job* candidate = &queue.pool[(queue.nextJob + i) % MaxJobsPerThread];
+			if (candidate->unfinishedJobs.load(std::memory_order_acquire) == 0)
+			{
+				job = candidate;
+				queue.nextJob = (queue.nextJob + i + 1) % MaxJobsPerThread;
+				break;
+			}
+		}
+
+		// Every job of the thread is pending, so help running them until one finishes
+		if (job == nullptr && !RunPendingJob())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	job->function = std::move(function);
+	job->parent = parent;
+	job->unfinishedJobs = 1;
+	if (parent != nullptr)
+	{
+		parent->unfinishedJobs++;
+	}
+
+	return job;
+}
+
+/// <summary>
+/// Queues a job on the deque of the calling thread.
+/// </summary>
+/// <param name="job">Job returned by CreateJob()</param>
+void JobSystem::Run(Job* job)
+{
+	WorkerQueue& queue = GetCurrentQueue();
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+
+	// Taking the wake mutex makes sure a worker that just found nothing to do is either
+	// already waiting, and gets woken up, or has not checked the count yet
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		queuedJobCount++;
+	}
+	wakeCondition.notify_one();
+}
+
+/// <summary>
+/// Runs other jobs until a job and all of its children are finished.
+/// </summary>
+/// <param name="job">Job to wait for</param>
+void JobSystem::Wait(const Job* job)
+{
+	while (job->unfinishedJobs.load(std::memory_order_acquire) > 0)
+	{
+		Job* next = FindJob();
+		if (next != nullptr)
+		{
+			Execute(next);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/// <summary>
+/// Runs one queued job on the calling thread, if there is any. Lets a thread that has
+/// nothing to wait for help with background work, which is the only way background jobs
+/// run when the main thread is the only worker.
+/// </summary>
+/// <returns>True if a job was run</returns>
+bool JobSystem::RunPendingJob()
+{
+	Job* job = FindJob();
+	if (job == nullptr)
+	{
+		return false;
+	}
+
+	Execute(job);
+	return true;
+}
+
+/// <summary>
+/// Calls a function on consecutive ranges of [0, count) in parallel, and returns once
+/// every range is done. Ranges hold at least minBatchSize items, so small loops run
+/// inline without any scheduling cost.
+/// </summary>
+/// <param name="count">Number of items</param>
+/// <param name="minBatchSize">Smallest number of items worth sending to another thread</param>
+/// <param name="function">Called with the first item and one past the last item of each range</param>
+void JobSystem::ParallelFor(std::size_t count, std::size_t minBatchSize, const std::function<void(std::size_t, std::size_t)>& function)
+{
+	minBatchSize = std::max<std::size_t>(minBatchSize, 1);
+	if (count == 0)
+	{
+		return;
+	}
+	if (queues.size() <= 1 || count < minBatchSize * 2)
+	{
+		function(0, count);
+		return;
+	}
+
+	// A few batches per worker, so that stealing can even out batches that take longer
+	std::size_t batchCount = std::min(count / minBatchSize, queues.size() * 4);
+
+	Job* root = CreateJob(nullptr);
+	for (std::size_t batch = 0; batch < batchCount; batch++)
+	{
+		std::size_t begin = count * batch / batchCount;
+		std::size_t end = count * (batch + 1) / batchCount;
+		Run(CreateJob([&function, begin, end]() { function(begin, end); }, root));
+	}
+
+	// The root has no work of its own, so it finishes as soon as its children do
+	Finish(root);
+	Wait(root);
+}
+
+/// <summary>
+/// Main loop of a worker thread.
+/// </summary>
+/// <param name="index">Index of the worker's queue</param>
+void JobSystem::WorkerMain(unsigned index)
+{
+	currentSystem = this;
+	currentWorker = index;
+
+	while (!stopping)
+	{
+		Job* job = FindJob();
+		if (job != nullptr)
+		{
+			Execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wakeCondition.wait(lock, [this]() { return stopping || queuedJobCount > 0; });
+	}
+}
+
+/// <summary>
+/// Takes a job from the back of the calling thread's deque, or steals one from the front of another.
+/// </summary>
+/// <returns>A job, or nullptr if every deque was empty</returns>
+Job* JobSystem::FindJob()
+{
+	if (queuedJobCount.load(std::memory_order_relaxed) <= 0)
+	{
+		return nullptr;
+	}
+
+	unsigned self = currentSystem == this ? currentWorker : 0;
+	for (std::size_t i = 0; i < queues.size(); i++)
+	{
+		// Start with the thread's own deque, then go around the others
+		WorkerQueue& queue = *queues[(self + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+		{
+			continue;
+		}
+
+		Job* job;
+		if (i == 0)
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+		}
+		else
+		{
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+		}
+
+		queuedJobCount--;
+		return job;
+	}
+
+	return nullptr;
+}
+
+/// <summary>
+/// Runs a job and marks it finished.
+/// </summary>
+/// <param name="job">Job to run</param>
+void JobSystem::Execute(Job* job)
+{
+	if (job->function)
+	{
+		job->function();
+	}
+	Finish(job);
+}
+
+/// <summary>
+/// Marks one unfinished part of a job as done, passing completion on to its parent.
+/// </summary>
+/// <param name="job">Job that finished its own work or lost a child</param>
+void JobSystem::Finish(Job* job)
+{
+	// The job can be reused by the thread that created it as soon as it is finished, so its
+	// parent is read before
+	Job* parent = job->parent;
+	if (job->unfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) == 1 && parent != nullptr)
+	{
+		Finish(parent);
+	}
+}
+
+/// <summary>
+/// Queue of the calling thread; the main thread uses the first one.
+/// </summary>
+JobSystem::WorkerQueue& JobSystem::GetCurrentQueue()
+{
+	return *queues[currentSystem == this ? currentWorker : 0];
+}
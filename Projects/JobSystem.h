@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// A unit of work. A job is finished once its function has run and every child job created
+/// with it as their parent has finished, so waiting on a parent waits for the whole tree.
+/// </summary>
+struct Job
+{
+	std::function<void()> function;
+	Job* parent = nullptr;
+	std::atomic<int> unfinishedJobs{ 0 };	// This job plus its unfinished children
+};
+
+/// <summary>
+/// Work-stealing task scheduler. Every thread taking part, the main thread included, has
+/// its own deque of jobs. A thread pushes the jobs it creates to the back of its own deque
+/// and takes its next job from the back too, which keeps related work on the same core.
+/// Threads that run out of work steal from the front of another thread's deque, where the
+/// oldest, and usually largest, jobs are.
+/// </summary>
+class JobSystem
+{
+public:
+	/// <summary>
+	/// Starts the worker threads.
+	/// </summary>
+	/// <param name="workerCount">Number of threads running jobs, counting the main thread,
+	/// or 0 to use one per hardware thread</param>
+	void Create(unsigned workerCount = 0);
+
+	/// <summary>
+	/// Stops the worker threads once they finish their current job. Jobs that were never
+	/// started are dropped.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Creates a job without starting it. Jobs can be created by the thread that called
+	/// Create() and by running jobs. When every job the calling thread created is still
+	/// pending, the thread runs queued jobs until one of them finishes.
+	/// </summary>
+	/// <param name="function">Work to do</param>
+	/// <param name="parent">Job that is not finished until this one is, or nullptr</param>
+	/// <returns>The job, owned by the job system and valid until it is finished or until the
+	/// next call to Destroy()</returns>
+	Job* CreateJob(std::function<void()> function, Job* parent = nullptr);
+
+	/// <summary>
+	/// Queues a job on the deque of the calling thread.
+	/// </summary>
+	/// <param name="job">Job returned by CreateJob()</param>
+	void Run(Job* job);
+
+	/// <summary>
+	/// Runs other jobs until a job and all of its children are finished.
+	/// </summary>
+	/// <param name="job">Job to wait for</param>
+	void Wait(const Job* job);
+
+	/// <summary>
+	/// Runs one queued job on the calling thread, if there is any. Lets a thread that has
+	/// nothing to wait for help with background work, which is the only way background jobs
+	/// run when the main thread is the only worker.
+	/// </summary>
+	/// <returns>True if a job was run</returns>
+	bool RunPendingJob();
+
+	/// <summary>
+	/// Calls a function on consecutive ranges of [0, count) in parallel, and returns once
+	/// every range is done. Ranges hold at least minBatchSize items, so small loops run
+	/// inline without any scheduling cost.
+	/// </summary>
+	/// <param name="count">Number of items</param>
+	/// <param name="minBatchSize">Smallest number of items worth sending to another thread</param>
+	/// <param name="function">Called with the first item and one past the last item of each range</param>
+	void ParallelFor(std::size_t count, std::size_t minBatchSize, const std::function<void(std::size_t, std::size_t)>& function);
+
+	/// <summary>
+	/// Number of threads running jobs, counting the main thread
+	/// </summary>
+	unsigned GetWorkerCount() const { return static_cast<unsigned>(queues.size()); }
+
+	/// <summary>
+	/// Largest number of unfinished jobs a thread can have created at once
+	/// </summary>
+	static const std::size_t MaxJobsPerThread = 4096;
+
+private:
+	/// <summary>
+	/// Deque of jobs owned by one thread, along with the jobs that thread created
+	/// </summary>
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<Job*> jobs;
+		std::vector<Job> pool;	// Ring of job objects created by the owning thread, reused once finished
+		std::size_t nextJob = 0;
+	};
+
+	/// <summary>
+	/// Main loop of a worker thread.
+	/// </summary>
+	/// <param name="index">Index of the worker's queue</param>
+	void WorkerMain(unsigned index);
+
+	/// <summary>
+	/// Takes a job from the back of the calling thread's deque, or steals one from the front of another.
+	/// </summary>
+	/// <returns>A job, or nullptr if every deque was empty</returns>
+	Job* FindJob();
+
+	/// <summary>
+	/// Runs a job and marks it finished.
+	/// </summary>
+	/// <param name="job">Job to run</param>
+	void Execute(Job* job);
+
+	/// <summary>
+	/// Marks one unfinished part of a job as done, passing completion on to its parent.
+	/// </summary>
+	/// <param name="job">Job that finished its own work or lost a child</param>
+	void Finish(Job* job);
+
+	/// <summary>
+	/// Queue of the calling thread; the main thread uses the first one.
+	/// </summary>
+	WorkerQueue& GetCurrentQueue();
+
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	std::vector<std::thread> threads;
+	std::atomic<bool> stopping{ false };
+	std::atomic<int> queuedJobCount{ 0 };
+
+	// Idle workers sleep here until jobs are queued
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+};
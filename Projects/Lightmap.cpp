@@ -0,0 +1,476 @@
+#include "Lightmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/intersect.hpp>
+
+#include "Scene.h"
+
+namespace
+{
+	/// <summary>
+	/// Header at the start of a lightmap file, followed by the texels
+	/// </summary>
+	struct LightmapFileHeader
+	{
+		char magic[4];				// "LMP1"
+		std::int32_t width;			// Number of cells along the x-axis
+		std::int32_t depth;			// Number of cells along the z-axis
+		std::int32_t texelsPerSide;	// Texels along each side of a surface
+		std::uint64_t hash;			// Hash of the walls and settings the texels were baked for
+	};
+
+	/// <summary>
+	/// Triangle of a tile, in world space
+	/// </summary>
+	struct Triangle
+	{
+		glm::vec3 v0, v1, v2;
+	};
+
+	/// <summary>
+	/// Triangles of the maze sorted by cell, so a ray only tests the triangles of the cells
+	/// it passes through
+	/// </summary>
+	struct BakeScene
+	{
+		std::vector<Triangle> triangles;
+		std::vector<int> cellStart;	// First triangle of each cell, plus one final entry for the end
+		glm::vec3 origin;			// Minimum corner of the grid, at the floor
+		float wallTop;
+		int width, depth;
+	};
+
+	/// <summary>
+	/// Checks whether a ray hits any triangle closer than a distance. The ray walks through
+	/// the cells it crosses in the plane of the grid (Amanatides and Woo), and stops once it
+	/// leaves the grid, rises above the walls or goes past the distance.
+	/// </summary>
+	/// <param name="scene">Triangles of the maze</param>
+	/// <param name="origin">Start of the ray, inside the grid</param>
+	/// <param name="direction">Direction of the ray, normalized</param>
+	/// <param name="maxDistance">Distance beyond which hits are ignored</param>
+	/// <returns>True if something blocks the ray</returns>
+	bool IsOccluded(const BakeScene& scene, const glm::vec3& origin, const glm::vec3& direction, float maxDistance)
+	{
+		glm::vec2 start = glm::vec2(origin.x - scene.origin.x, origin.z - scene.origin.z) / CellGrid::CellSize;
+		glm::vec2 step2(direction.x, direction.z);
+		int x = std::min(std::max(static_cast<int>(std::floor(start.x)), 0), scene.width - 1);
+		int z = std::min(std::max(static_cast<int>(std::floor(start.y)), 0), scene.depth - 1);
+		int stepX = step2.x > 0.0f ? 1 : -1;
+		int stepZ = step2.y > 0.0f ? 1 : -1;
+
+		// Distance along the ray to the next cell edge on each axis, and between two edges
+		const float infinity = 1e30f;
+		float deltaX = step2.x != 0.0f ? CellGrid::CellSize / std::abs(step2.x) : infinity;
+		float deltaZ = step2.y != 0.0f ? CellGrid::CellSize / std::abs(step2.y) : infinity;
+		float nextX = step2.x != 0.0f ? ((stepX > 0 ? x + 1 - start.x : start.x - x) * deltaX) : infinity;
+		float nextZ = step2.y != 0.0f ? ((stepZ > 0 ? z + 1 - start.y : start.y - z) * deltaZ) : infinity;
+
+		float cellEnter = 0.0f;
+		while (cellEnter <= maxDistance)
+		{
+			// Nothing stands above the walls, so a rising ray that got there is free
+			if (direction.y > 0.0f && origin.y + direction.y * cellEnter > scene.wallTop)
+			{
+				return false;
+			}
+
+			int cell = z * scene.width + x;
+			for (int i = scene.cellStart[cell]; i < scene.cellStart[cell + 1]; i++)
+			{
+				const Triangle& triangle = scene.triangles[i];
+				glm::vec2 barycentric;
+				float distance;
+				if (glm::intersectRayTriangle(origin, direction, triangle.v0, triangle.v1, triangle.v2, barycentric, distance)
+					&& distance > 0.0f && distance <= maxDistance)
+				{
+					return true;
+				}
+			}
+
+			if (nextX < nextZ)
+			{
+				cellEnter = nextX;
+				nextX += deltaX;
+				x += stepX;
+			}
+			else
+			{
+				cellEnter = nextZ;
+				nextZ += deltaZ;
+				z += stepZ;
+			}
+			if (x < 0 || x >= scene.width || z < 0 || z >= scene.depth)
+			{
+				return false;
+			}
+		}
+
+		return false;
+	}
+
+	/// <summary>
+	/// Reverses the bits of a number, giving the second coordinate of the Hammersley points.
+	/// </summary>
+	/// <param name="bits">Number</param>
+	/// <returns>Number mirrored around the binary point, from 0 to 1</returns>
+	float RadicalInverse(std::uint32_t bits)
+	{
+		bits = (bits << 16) | (bits >> 16);
+		bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+		bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+		bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+		bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+		return static_cast<float>(bits) * 2.3283064365386963e-10f;
+	}
+
+	/// <summary>
+	/// Hashes a texel into a number from 0 to 1, used to rotate its sample pattern so that
+	/// neighbouring texels do not share the same pattern.
+	/// </summary>
+	float HashTexel(std::uint32_t index)
+	{
+		index = (index ^ 61u) ^ (index >> 16);
+		index *= 9u;
+		index ^= index >> 4;
+		index *= 0x27D4EB2Du;
+		index ^= index >> 15;
+		return static_cast<float>(index) * 2.3283064365386963e-10f;
+	}
+
+	/// <summary>
+	/// Bakes the light of one texel.
+	/// </summary>
+	/// <param name="scene">Triangles of the maze</param>
+	/// <param name="settings">Light to bake</param>
+	/// <param name="position">World-space position of the center of the texel</param>
+	/// <param name="normal">Direction the surface faces</param>
+	/// <param name="tangent">Direction along the surface from one texel to the next</param>
+	/// <param name="bitangent">Direction along the surface from one row of texels to the next</param>
+	/// <param name="texelSize">Size of the texel in world units</param>
+	/// <param name="seed">Random value of the texel, from 0 to 1</param>
+	/// <returns>Light reaching the texel</returns>
+	float BakeTexel(const BakeScene& scene, const LightmapSettings& settings, const glm::vec3& position, const glm::vec3& normal,
+		const glm::vec3& tangent, const glm::vec3& bitangent, const glm::vec2& texelSize, float seed)
+	{
+		// Start the rays slightly off the surface, so they do not hit the tile they start on
+		glm::vec3 origin = position + normal * 1e-3f;
+
+		// Cosine-weighted Hammersley points over the hemisphere, so the fraction of rays that
+		// escape is the fraction of the sky light that reaches the surface
+		int openCount = 0;
+		for (int i = 0; i < settings.skySampleCount; i++)
+		{
+			float u = std::fmod((i + 0.5f) / settings.skySampleCount + seed, 1.0f);
+			float v = RadicalInverse(static_cast<std::uint32_t>(i));
+			float radius = std::sqrt(u);
+			float angle = 6.2831853f * v;
+			glm::vec3 direction = tangent * (radius * std::cos(angle)) + bitangent * (radius * std::sin(angle))
+				+ normal * std::sqrt(std::max(1.0f - u, 0.0f));
+			if (!IsOccluded(scene, origin, glm::normalize(direction), settings.skyDistance))
+			{
+				openCount++;
+			}
+		}
+		float light = settings.skyIntensity * openCount / std::max(settings.skySampleCount, 1);
+
+		// Shadow rays from four points of the texel, which soften the edges of the shadows
+		float cosAngle = glm::dot(normal, settings.sunDirection);
+		if (cosAngle > 0.0f)
+		{
+			int litCount = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				glm::vec2 offset = (glm::vec2(i % 2, i / 2) - 0.5f) * 0.5f * texelSize;
+				glm::vec3 sample = origin + tangent * offset.x + bitangent * offset.y;
+				if (!IsOccluded(scene, sample, settings.sunDirection, 1e30f))
+				{
+					litCount++;
+				}
+			}
+			light += settings.sunIntensity * cosAngle * litCount / 4.0f;
+		}
+
+		return light;
+	}
+}
+
+/// <summary>
+/// Finds how many texels along each side of a tile fit the lightmap of a grid into a
+/// texture, which is the requested number unless the maze is too large for it.
+/// </summary>
+/// <param name="grid">Grid containing the tiles of the maze</param>
+/// <param name="texelsPerSide">Requested number of texels along each side of a tile</param>
+/// <param name="maxTextureSize">Largest width and height of the texture</param>
+/// <returns>Texels along each side of a tile, or 0 if the maze does not fit even with one</returns>
+int Lightmap::FitTexelsPerSide(const CellGrid& grid, int texelsPerSide, int maxTextureSize)
+{
+	int cells = std::max(std::max(grid.GetWidth(), grid.GetDepth()), 1);
+	return std::min(std::max(texelsPerSide, 1), maxTextureSize / cells);
+}
+
+/// <summary>
+/// Bakes the light of every texel, splitting the rows of cells between the workers of
+/// the job system.
+/// </summary>
+/// <param name="grid">Grid containing the tiles of the maze</param>
+/// <param name="settings">Light to bake</param>
+/// <param name="jobs">Job system running the rays</param>
+void Lightmap::Bake(const CellGrid& grid, const LightmapSettings& settings, JobSystem& jobs)
+{
+	width = grid.GetWidth();
+	depth = grid.GetDepth();
+	texelsPerSide = std::max(settings.texelsPerSide, 1);
+	glm::vec3 boxMax;
+	grid.GetBounds(0, 0, width, depth, origin, boxMax);
+	wallHeight = boxMax.y - origin.y;
+
+	// Move the faces of the cube onto the tiles of each cell
+	std::vector<MeshVertex> cubeVertices;
+	std::vector<GLuint> cubeIndices;
+	BuildCubeGeometry(cubeVertices, cubeIndices);
+	BakeScene scene;
+	scene.origin = origin;
+	scene.wallTop = boxMax.y;
+	scene.width = width;
+	scene.depth = depth;
+	scene.cellStart.resize(grid.GetCellCount() + 1);
+	for (int cell = 0; cell < grid.GetCellCount(); cell++)
+	{
+		scene.cellStart[cell] = static_cast<int>(scene.triangles.size());
+		for (int i = grid.GetFirstTile(cell); i < grid.GetFirstTile(cell) + grid.GetTileCount(cell); i++)
+		{
+			const Tile& tile = grid.GetTiles()[i];
+			const GLuint* face = cubeIndices.data() + static_cast<int>(tile.face) * 6;
+			for (int corner = 0; corner < 6; corner += 3)
+			{
+				scene.triangles.push_back({ tile.position + cubeVertices[face[corner]].position,
+					tile.position + cubeVertices[face[corner + 1]].position, tile.position + cubeVertices[face[corner + 2]].position });
+			}
+		}
+	}
+	scene.cellStart.back() = static_cast<int>(scene.triangles.size());
+
+	// Position of the first texel, normal and axes of each surface, as seen from inside the cell
+	const glm::vec3 surfaceCorners[SurfaceCount] = {
+		glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+	};
+	const glm::vec3 surfaceNormals[SurfaceCount] = {
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+	};
+	const glm::vec3 surfaceTangents[SurfaceCount] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+	};
+	const CellSide surfaceSides[SurfaceCount] = {
+		CellSide::NegativeX, CellSide::NegativeX, CellSide::PositiveX, CellSide::NegativeZ, CellSide::PositiveZ,
+	};
+
+	int rowLength = width * texelsPerSide;
+	std::size_t layerSize = static_cast<std::size_t>(rowLength) * depth * texelsPerSide;
+	texels.assign(layerSize * SurfaceCount, 0);
+	jobs.ParallelFor(static_cast<std::size_t>(depth), 1, [&](std::size_t begin, std::size_t end)
+	{
+		for (int z = static_cast<int>(begin); z < static_cast<int>(end); z++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				glm::vec3 cellMin = origin + glm::vec3(x * CellGrid::CellSize, 0.0f, z * CellGrid::CellSize);
+				for (int surface = 0; surface < SurfaceCount; surface++)
+				{
+					// Walls that are not there are never seen, so their texels stay black
+					if (surface > 0 && !grid.IsBlocked(x, z, surfaceSides[surface]))
+					{
+						continue;
+					}
+
+					// Floors span the cell along z, walls span the height of the walls
+					glm::vec3 tangent = surfaceTangents[surface];
+					glm::vec3 bitangent = surface == 0 ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+					glm::vec2 surfaceSize(CellGrid::CellSize, surface == 0 ? CellGrid::CellSize : wallHeight);
+					glm::vec2 texelSize = surfaceSize / static_cast<float>(texelsPerSide);
+					glm::vec3 corner = cellMin + surfaceCorners[surface] * CellGrid::CellSize;
+					for (int v = 0; v < texelsPerSide; v++)
+					{
+						for (int u = 0; u < texelsPerSide; u++)
+						{
+							std::size_t index = surface * layerSize + static_cast<std::size_t>(z * texelsPerSide + v) * rowLength
+								+ x * texelsPerSide + u;
+							glm::vec3 position = corner + tangent * ((u + 0.5f) * texelSize.x) + bitangent * ((v + 0.5f) * texelSize.y);
+							float light = BakeTexel(scene, settings, position, surfaceNormals[surface], tangent, bitangent, texelSize,
+								HashTexel(static_cast<std::uint32_t>(index)));
+							texels[index] = static_cast<std::uint8_t>(std::min(std::max(light, 0.0f), 1.0f) * 255.0f + 0.5f);
+						}
+					}
+				}
+			}
+		}
+	});
+}
+
+/// <summary>
+/// Loads the texels from a file written by Save(). The file is rejected if it was baked
+/// for a different maze or with different settings.
+/// </summary>
+/// <param name="filePath">Path of the file</param>
+/// <param name="grid">Grid the lightmap must belong to</param>
+/// <param name="settings">Settings the lightmap must have been baked with</param>
+/// <returns>True if the file was loaded</returns>
+bool Lightmap::Load(const std::string& filePath, const CellGrid& grid, const LightmapSettings& settings)
+{
+	std::ifstream file(filePath, std::ios::binary);
+	if (file.fail())
+	{
+		return false;
+	}
+
+	LightmapFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || std::memcmp(header.magic, "LMP1", 4) != 0 || header.width != grid.GetWidth()
+		|| header.depth != grid.GetDepth() || header.texelsPerSide != std::max(settings.texelsPerSide, 1)
+		|| header.hash != HashSettings(grid, settings))
+	{
+		return false;
+	}
+
+	std::vector<std::uint8_t> loadedTexels(static_cast<std::size_t>(header.width) * header.texelsPerSide
+		* header.depth * header.texelsPerSide * SurfaceCount);
+	file.read(reinterpret_cast<char*>(loadedTexels.data()), loadedTexels.size());
+	if (!file)
+	{
+		return false;
+	}
+
+	width = header.width;
+	depth = header.depth;
+	texelsPerSide = header.texelsPerSide;
+	glm::vec3 boxMax;
+	grid.GetBounds(0, 0, width, depth, origin, boxMax);
+	wallHeight = boxMax.y - origin.y;
+	texels.swap(loadedTexels);
+	return true;
+}
+
+/// <summary>
+/// Saves the texels to a file, so they do not need to be baked on the next launch.
+/// </summary>
+/// <param name="filePath">Path of the file</param>
+/// <param name="grid">Grid the lightmap was baked for</param>
+/// <param name="settings">Settings the lightmap was baked with</param>
+/// <returns>True if the file was written</returns>
+bool Lightmap::Save(const std::string& filePath, const CellGrid& grid, const LightmapSettings& settings) const
+{
+	std::ofstream file(filePath, std::ios::binary);
+	if (file.fail())
+	{
+		return false;
+	}
+
+	LightmapFileHeader header;
+	std::memcpy(header.magic, "LMP1", 4);
+	header.width = width;
+	header.depth = depth;
+	header.texelsPerSide = texelsPerSide;
+	header.hash = HashSettings(grid, settings);
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(texels.data()), texels.size());
+	return static_cast<bool>(file);
+}
+
+/// <summary>
+/// Uploads the texels to a texture. The texels stay on the CPU, so they can still be saved.
+/// </summary>
+void Lightmap::CreateTexture()
+{
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+	// Rows of single-byte texels are not always a multiple of 4 bytes long
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, width * texelsPerSide, depth * texelsPerSide, SurfaceCount, 0,
+		GL_RED, GL_UNSIGNED_BYTE, texels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+/// <summary>
+/// Points the sampler of a program compiled with GetShaderDefines() to the texture unit
+/// of the lightmap, and gives it the layout of the texels.
+/// </summary>
+/// <param name="program">Program to set up</param>
+void Lightmap::ConnectProgram(ShaderProgram& program) const
+{
+	program.Use();
+	program.Set(program.GetUniform<GLint>("lightmap"), LightmapTextureUnit);
+	program.Set(program.GetUniform<glm::vec3>("lightmapOrigin"), origin);
+	program.Set(program.GetUniform<glm::vec2>("lightmapCellCount"), glm::vec2(static_cast<float>(width), static_cast<float>(depth)));
+	program.Set(program.GetUniform<glm::vec2>("lightmapCellSize"), glm::vec2(CellGrid::CellSize, wallHeight));
+	program.Set(program.GetUniform<GLfloat>("lightmapTexelsPerSide"), static_cast<GLfloat>(texelsPerSide));
+}
+
+/// <summary>
+/// Binds the texture to its texture unit.
+/// </summary>
+void Lightmap::Bind() const
+{
+	glActiveTexture(GL_TEXTURE0 + LightmapTextureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/// <summary>
+/// Deletes the texture and the texels.
+/// </summary>
+void Lightmap::Destroy()
+{
+	glDeleteTextures(1, &texture);
+	texture = 0;
+	texels.clear();
+	texels.shrink_to_fit();
+}
+
+/// <summary>
+/// Hashes the walls of a grid and the settings of the light (FNV-1a), to detect files baked
+/// for another maze or another light.
+/// </summary>
+/// <param name="grid">Grid containing the walls</param>
+/// <param name="settings">Light to bake</param>
+/// <returns>Hash of the walls and the settings</returns>
+std::uint64_t Lightmap::HashSettings(const CellGrid& grid, const LightmapSettings& settings)
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	auto hashBytes = [&hash](const void* data, std::size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+
+	for (const Tile& tile : grid.GetTiles())
+	{
+		hashBytes(&tile.position, sizeof(tile.position));
+		hashBytes(&tile.face, sizeof(tile.face));
+	}
+	hashBytes(&settings.texelsPerSide, sizeof(settings.texelsPerSide));
+	hashBytes(&settings.skySampleCount, sizeof(settings.skySampleCount));
+	hashBytes(&settings.skyDistance, sizeof(settings.skyDistance));
+	hashBytes(&settings.skyIntensity, sizeof(settings.skyIntensity));
+	hashBytes(&settings.sunDirection, sizeof(settings.sunDirection));
+	hashBytes(&settings.sunIntensity, sizeof(settings.sunIntensity));
+	return hash;
+}
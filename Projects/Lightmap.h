@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "CellGrid.h"
+#include "JobSystem.h"
+#include "ShaderProgram.h"
+
+/// <summary>
+/// Texture unit the scene reads the lightmap from. Units 1 to 6 hold the clustered lights
+/// and the G-buffer.
+/// </summary>
+const GLint LightmapTextureUnit = 7;
+
+/// <summary>
+/// Largest width and height of the lightmap texture. The lightmap is baked before there is
+/// a context to ask for GL_MAX_TEXTURE_SIZE, and 4096 is supported by every GPU that runs
+/// OpenGL 3.3 in practice, while keeping the texels of the five layers under 80 MB.
+/// </summary>
+const int MaxLightmapTextureSize = 4096;
+
+/// <summary>
+/// Light baked into a lightmap
+/// </summary>
+struct LightmapSettings
+{
+	int texelsPerSide = 8;			// Texels along each side of a floor or wall tile
+	int skySampleCount = 64;		// Rays cast from every texel to find how much of the sky it sees
+	float skyDistance = 4.0f * CellGrid::CellSize;	// Rays going farther than this without a hit reach the sky
+	float skyIntensity = 0.35f;		// Light reaching a texel that sees the whole sky
+	glm::vec3 sunDirection = glm::normalize(glm::vec3(-0.4f, 1.0f, 0.25f));	// Direction towards the sun
+	float sunIntensity = 0.45f;		// Light of the sun on a texel facing it
+};
+
+/// <summary>
+/// Static lighting of a maze, baked on the CPU. Every cell has five surfaces: its floor,
+/// and the sides of the four walls around it that face into the cell, each covered by a
+/// square of texels. Each texel casts rays against the tiles of the maze: shadow rays
+/// towards the sun for the direct light, and a hemisphere of rays for the ambient occlusion
+/// of the sky. The result is a gray level per texel, stored in a 2D array texture with one
+/// layer per kind of surface, so the scene shader finds its texel from its world-space
+/// position and normal (see lightmap.glsl) and needs no extra vertex attribute.
+/// </summary>
+class Lightmap
+{
+public:
+	/// <summary>
+	/// Number of surfaces of each cell, which is also the number of layers of the texture
+	/// </summary>
+	static const int SurfaceCount = 5;
+
+	/// <summary>
+	/// Finds how many texels along each side of a tile fit the lightmap of a grid into a
+	/// texture, which is the requested number unless the maze is too large for it.
+	/// </summary>
+	/// <param name="grid">Grid containing the tiles of the maze</param>
+	/// <param name="texelsPerSide">Requested number of texels along each side of a tile</param>
+	/// <param name="maxTextureSize">Largest width and height of the texture</param>
+	/// <returns>Texels along each side of a tile, or 0 if the maze does not fit even with one</returns>
+	static int FitTexelsPerSide(const CellGrid& grid, int texelsPerSide, int maxTextureSize);
+
+	/// <summary>
+	/// Bakes the light of every texel, splitting the rows of cells between the workers of
+	/// the job system.
+	/// </summary>
+	/// <param name="grid">Grid containing the tiles of the maze</param>
+	/// <param name="settings">Light to bake</param>
+	/// <param name="jobs">Job system running the rays</param>
+	void Bake(const CellGrid& grid, const LightmapSettings& settings, JobSystem& jobs);
+
+	/// <summary>
+	/// Loads the texels from a file written by Save(). The file is rejected if it was baked
+	/// for a different maze or with different settings.
+	/// </summary>
+	/// <param name="filePath">Path of the file</param>
+	/// <param name="grid">Grid the lightmap must belong to</param>
+	/// <param name="settings">Settings the lightmap must have been baked with</param>
+	/// <returns>True if the file was loaded</returns>
+	bool Load(const std::string& filePath, const CellGrid& grid, const LightmapSettings& settings);
+
+	/// <summary>
+	/// Saves the texels to a file, so they do not need to be baked on the next launch.
+	/// </summary>
+	/// <param name="filePath">Path of the file</param>
+	/// <param name="grid">Grid the lightmap was baked for</param>
+	/// <param name="settings">Settings the lightmap was baked with</param>
+	/// <returns>True if the file was written</returns>
+	bool Save(const std::string& filePath, const CellGrid& grid, const LightmapSettings& settings) const;
+
+	/// <summary>
+	/// Uploads the texels to a texture. The texels stay on the CPU, so they can still be saved.
+	/// </summary>
+	void CreateTexture();
+
+	/// <summary>
+	/// Preprocessor symbols that make main.fsh take its static lighting from the lightmap.
+	/// </summary>
+	/// <returns>Symbols to pass to ShaderVariants::Create()</returns>
+	static std::vector<std::string> GetShaderDefines() { return { "BAKED_LIGHTING" }; }
+
+	/// <summary>
+	/// Points the sampler of a program compiled with GetShaderDefines() to the texture unit
+	/// of the lightmap, and gives it the layout of the texels.
+	/// </summary>
+	/// <param name="program">Program to set up</param>
+	void ConnectProgram(ShaderProgram& program) const;
+
+	/// <summary>
+	/// Binds the texture to its texture unit.
+	/// </summary>
+	void Bind() const;
+
+	/// <summary>
+	/// Deletes the texture and the texels.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// True once the texels have been baked or loaded
+	/// </summary>
+	bool IsValid() const { return !texels.empty(); }
+
+private:
+	static std::uint64_t HashSettings(const CellGrid& grid, const LightmapSettings& settings);
+
+	std::vector<std::uint8_t> texels;	// Layer by layer, row of texels by row of texels
+	int width = 0, depth = 0;			// Number of cells
+	int texelsPerSide = 0;
+	glm::vec3 origin = glm::vec3(0.0f);	// Minimum corner of the grid, at the floor
+	float wallHeight = 0.0f;
+	GLuint texture = 0;
+};
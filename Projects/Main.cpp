@@ -3,7 +3,13 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <windows.h>
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -15,34 +21,38 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include "Benchmark.h"
+#include "CellGrid.h"
+#include "ClusteredLights.h"
+#include "DeferredRenderer.h"
+#include "FrameUniforms.h"
+#include "FramePacer.h"
+#include "Frustum.h"
+#include "InstancedRenderer.h"
+#include "JobSystem.h"
+#include "Lightmap.h"
+#include "MazeFile.h"
+#include "MazeGenerator.h"
+#include "MazeSource.h"
+#include "Mesh.h"
+#include "OcclusionCuller.h"
+#include "OverdrawCounter.h"
+#include "ProgramBinaryCache.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "ShaderProgram.h"
+#include "ShaderVariants.h"
+#include "ShadowMap.h"
+#include "Simulation.h"
+#include "StaticWorld.h"
+#include "StreamBuffer.h"
+#include "Visibility.h"
+#include "WorldStreamer.h"
+
 // ---------------
 // Function declarations
 // ---------------
 
-/// <summary>
-/// Creates a shader program based on the provided file paths for the vertex and fragment shaders.
-/// </summary>
-/// <param name="vertexShaderFilePath">Vertex shader file path</param>
-/// <param name="fragmentShaderFilePath">Fragment shader file path</param>
-/// <returns>OpenGL handle to the created shader program</returns>
-GLuint CreateShaderProgram(const std::string& vertexShaderFilePath, const std::string& fragmentShaderFilePath);
-
-/// <summary>
-/// Creates a shader based on the provided shader type and the path to the file containing the shader source.
-/// </summary>
-/// <param name="shaderType">Shader type</param>
-/// <param name="shaderFilePath">Path to the file containing the shader source</param>
-/// <returns>OpenGL handle to the created shader</returns>
-GLuint CreateShaderFromFile(const GLuint& shaderType, const std::string& shaderFilePath);
-
-/// <summary>
-/// Creates a shader based on the provided shader type and the string containing the shader source.
-/// </summary>
-/// <param name="shaderType">Shader type</param>
-/// <param name="shaderSource">Shader source string</param>
-/// <returns>OpenGL handle to the created shader</returns>
-GLuint CreateShaderFromSource(const GLuint& shaderType, const std::string& shaderSource);
-
 /// <summary>
 /// Function for handling the event when the size of the framebuffer changed.
 /// </summary>
@@ -51,16 +61,6 @@ GLuint CreateShaderFromSource(const GLuint& shaderType, const std::string& shade
 /// <param name="height">New height</param>
 void FramebufferSizeChangedCallback(GLFWwindow* window, int width, int height);
 
-/// <summary>
-/// Struct containing data about a vertex
-/// </summary>
-struct Vertex
-{
-	GLfloat x, y, z;	// Position
-	GLubyte r, g, b;	// Color
-	GLfloat u, v;		// UV coordinates
-};
-
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
@@ -71,35 +71,484 @@ glm::vec3 cameraPos   = glm::vec3(0.0f, 0.0f, 0.0f);
 glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, 0.0f);
 glm::vec3 cameraUp    = glm::vec3(0.0f, 1.0f, 0.0f);
 
-bool firstMouse = true;
-float yaw   = -90.0f;	// yaw is initialized to -90.0 degrees since a yaw of 0.0 results in a direction vector pointing to the right so we initially rotate a bit to the left.
-float pitch =  0.0f;
-float lastX =  800.0f / 2.0;
-float lastY =  800.0f / 2.0;
 float fov   =  45.0f;
 
-// timing
-float deltaTime = 0.0f;	// time between current frame and last frame
-float lastFrame = 0.0f;
+// The camera is moved by the simulation thread. The main thread only samples the input
+// devices, and takes the interpolated camera at the start of every frame.
+InputState inputState;
+Simulation simulation;
 
 int windowWidth = 800;
 int windowHeight = 800;
 
 float globalSpeed = 10.0f;
 
+/// <summary>
+/// Ways of submitting the maze geometry to the GPU
+/// </summary>
+enum class RenderPath
+{
+	Baked,		// Static world pre-transformed into one merged vertex/index buffer
+	Instanced,	// One instanced draw call per cube face
+	Streamed,	// Chunks of baked cells loaded and evicted around the camera
+};
+
+RenderPath renderPath = RenderPath::Baked;
+
+bool frustumCulling = true;	// Only draw the cells that are inside the view frustum
+bool portalCulling = true;	// Only draw the cells that can be seen through the corridors
+bool occlusionCulling = false;	// Skip clusters of cells whose bounding box was hidden on the previous frame
+
+bool frontToBack = true;	// Draw the nearest cells first, so the depth test rejects the pixels they hide
+bool depthPrepass = false;	// Fill the depth buffer first, so each pixel is shaded at most once
+bool overdrawStats = false;	// Count the fragments shaded per pixel
+bool mergeTiles = false;	// Merge neighbouring tiles of the baked and streamed worlds into larger quads
+
+bool torches = false;	// Light the corridors with point lights, shaded through clustered lighting
+int torchSpacing = 2;	// Number of cells between two torches along each axis
+bool lightStats = false;	// Show the number of lights and how many touch each cluster
+bool deferredShading = false;	// Write a G-buffer, then shade each pixel once, instead of shading every fragment
+bool bakedLighting = false;	// Take the static lighting from a lightmap, baked if it was not saved yet
+bool bakeLightmapOnly = false;	// Bake the lightmap, save it and exit
+bool shadows = false;	// Shadow the light of the scene with a cube map, drawn again only when the light or the chunks around it change
+bool movingLight = false;	// Circle the light around its position, which draws the shadow map every frame
+bool shadowStats = false;	// Show how often the shadow map was drawn
+glm::vec3 sceneLightPosition = glm::vec3(-20.0f, -20.0f, 0.0f);	// Position of the light of the scene
+bool programCache = true;	// Load the linked shader programs saved by the previous launch instead of compiling them
+
+int benchmarkFrames = 0;	// Number of frames to measure in benchmark mode, or 0 to run interactively
+std::string benchmarkOutputPath = "benchmark.json";
+
+int jobBenchmarkWorkers = -1;	// Largest worker count of the job scaling benchmark (0 for one per hardware thread), or -1 to run normally
+std::string jobBenchmarkOutputPath = "job_scaling.json";
+
+std::string mazeFilePath = "default.maze";
+int generatedMazeSize = 0;	// Number of cells along each side of a generated maze, or 0 for the hand-made maze
+bool generateMaze = false;	// Generate a perfect maze with mazeAlgorithm instead of loading one
+MazeAlgorithm mazeAlgorithm = MazeAlgorithm::Kruskal;
+std::uint32_t mazeSeed = 1;	// Seed of generated mazes
+std::string savedMazePath;	// File the generated maze is saved to, or empty
+int mazeBenchmarkSize = 0;	// Number of cells along each side of the mazes of the generator benchmark, or 0 to run normally
+std::string mazeBenchmarkOutputPath = "maze_generation.json";
+std::size_t streamingBudgetMegabytes = 64;	// GPU memory the streamed chunks may use
+bool streamingStats = false;	// Show the resident chunks and their memory
+
+PacingMode pacingMode = PacingMode::VSync;	// How the frame rate is limited outside of benchmark mode
+double frameRateCap = 60.0;	// Frame rate of PacingMode::Capped
+bool pacingStats = false;	// Show the frame rate and the variation of the frame times
+
+bool profiling = false;	// Measure the CPU and GPU time of each pass of the frame
+std::string profileOutputPath = "profile.csv";
+
 /// <summary>
 /// Main function.
 /// </summary>
+/// <param name="argc">Number of command line arguments</param>
+/// <param name="argv">Command line arguments. Pass --instanced to draw the maze with
+/// the instanced renderer instead of the baked static world, --no-cull to draw
+/// every cell instead of only the ones inside the view frustum, --no-pvs to
+/// also draw the cells hidden behind the walls of the maze, and --occlusion to
+/// skip hidden clusters of cells with hardware occlusion queries. Pass --no-sort to draw
+/// the cells in index order instead of front to back, --depth-prepass to draw the depth
+/// of the scene before shading it, and --overdraw to show the fragments shaded per pixel
+/// in the title bar. Pass --merge-tiles to merge the floor and wall tiles of the baked and
+/// streamed worlds into the largest quads that cover them. Pass --torches to light the corridors with
+/// a torch every 2 cells (or every N cells with --torch-spacing N) through clustered forward lighting,
+/// and --light-stats to show the lights per cluster in the title bar. Pass --deferred to shade through
+/// a G-buffer instead of shading every fragment of the scene. Pass --lightmap to take the static lighting
+/// from a lightmap saved next to the maze, baking it first if needed, or --bake-lightmap to bake it,
+/// save it and exit. Pass --shadows to shadow the light of the scene with a cube map that is only drawn
+/// again when the light moves or the chunks around it change, --light X Y Z to place the light,
+/// --moving-light to circle it around that place, and --shadow-stats to show how often the shadow map
+/// was drawn in the title bar. Pass --no-program-cache to compile every shader program from source
+/// instead of loading the binaries saved by the previous launch. Pass --pacing off, vsync, adaptive
+/// or capped to choose how the frame rate is limited (v-sync by default), --fps N to cap it at N frames per second, and
+/// --pacing-stats to show the frame rate and frame time jitter in the title bar. Pass --benchmark N to
+/// render N frames along a scripted camera path in an invisible window, then write the
+/// frame times, draw calls, triangle counts and overdraw to benchmark.json (or to the file given
+/// with --benchmark-output) and exit. Pass --profile to show the CPU/GPU time of each
+/// pass in the title bar and write every sample to profile.csv (or to the file given
+/// with --profile-output). Pass --job-benchmark N to time the parallel workloads of the
+/// job system with 1 to N workers (one per hardware thread if N is 0), write the times to
+/// job_scaling.json (or to the file given with --job-benchmark-output) and exit. Pass --maze FILE
+/// to load another maze file instead of default.maze, or --generate kruskal, backtracker or wilson to
+/// generate a perfect maze (64 by 64 cells unless --maze-size is given) with the seed given with --seed,
+/// and --save-maze FILE to save it. Pass --maze-benchmark N to time the generators on an N by N maze,
+/// write the cells generated per second to maze_generation.json (or to the file given with
+/// --maze-benchmark-output) and exit. Pass --streaming
+/// to load the maze in chunks around the camera, --maze-size N to stream a generated maze of
+/// N by N cells instead of the hand-made one, --stream-budget MB to set the GPU memory the chunks
+/// may use (64 MB by default), and --stream-stats to show the resident chunks in the title bar.</param>
 /// <returns>An integer indicating whether the program ended successfully or not.
 /// A value of 0 indicates the program ended succesfully, while a non-zero value indicates
 /// something wrong happened during execution.</returns>
-int main()
+int main(int argc, char* argv[])
 {
+	// The benchmark reports how long it took to get to the first frame
+	std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now();
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--instanced") == 0)
+		{
+			renderPath = RenderPath::Instanced;
+		}
+		else if (std::strcmp(argv[i], "--streaming") == 0)
+		{
+			renderPath = RenderPath::Streamed;
+		}
+		else if (std::strcmp(argv[i], "--maze") == 0 && i + 1 < argc)
+		{
+			mazeFilePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--maze-size") == 0 && i + 1 < argc)
+		{
+			generatedMazeSize = std::max(std::atoi(argv[++i]), 1);
+			renderPath = RenderPath::Streamed;
+		}
+		else if (std::strcmp(argv[i], "--generate") == 0 && i + 1 < argc)
+		{
+			const char* name = argv[++i];
+			generateMaze = false;
+			for (MazeAlgorithm algorithm : { MazeAlgorithm::Kruskal, MazeAlgorithm::Backtracker, MazeAlgorithm::Wilson })
+			{
+				if (std::strcmp(name, GetMazeAlgorithmName(algorithm)) == 0)
+				{
+					generateMaze = true;
+					mazeAlgorithm = algorithm;
+				}
+			}
+			if (!generateMaze)
+			{
+				std::cerr << "Unknown maze algorithm " << name << std::endl;
+			}
+		}
+		else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			mazeSeed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--save-maze") == 0 && i + 1 < argc)
+		{
+			savedMazePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--maze-benchmark") == 0 && i + 1 < argc)
+		{
+			mazeBenchmarkSize = std::max(std::atoi(argv[++i]), 1);
+		}
+		else if (std::strcmp(argv[i], "--maze-benchmark-output") == 0 && i + 1 < argc)
+		{
+			mazeBenchmarkOutputPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--stream-budget") == 0 && i + 1 < argc)
+		{
+			streamingBudgetMegabytes = static_cast<std::size_t>(std::max(std::atoi(argv[++i]), 1));
+		}
+		else if (std::strcmp(argv[i], "--stream-stats") == 0)
+		{
+			streamingStats = true;
+		}
+		else if (std::strcmp(argv[i], "--no-cull") == 0)
+		{
+			frustumCulling = false;
+		}
+		else if (std::strcmp(argv[i], "--no-pvs") == 0)
+		{
+			portalCulling = false;
+		}
+		else if (std::strcmp(argv[i], "--occlusion") == 0)
+		{
+			occlusionCulling = true;
+		}
+		else if (std::strcmp(argv[i], "--no-sort") == 0)
+		{
+			frontToBack = false;
+		}
+		else if (std::strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			depthPrepass = true;
+		}
+		else if (std::strcmp(argv[i], "--merge-tiles") == 0)
+		{
+			mergeTiles = true;
+		}
+		else if (std::strcmp(argv[i], "--torches") == 0)
+		{
+			torches = true;
+		}
+		else if (std::strcmp(argv[i], "--torch-spacing") == 0 && i + 1 < argc)
+		{
+			torchSpacing = std::max(std::atoi(argv[++i]), 1);
+		}
+		else if (std::strcmp(argv[i], "--light-stats") == 0)
+		{
+			lightStats = true;
+		}
+		else if (std::strcmp(argv[i], "--deferred") == 0)
+		{
+			deferredShading = true;
+		}
+		else if (std::strcmp(argv[i], "--lightmap") == 0)
+		{
+			bakedLighting = true;
+		}
+		else if (std::strcmp(argv[i], "--bake-lightmap") == 0)
+		{
+			bakedLighting = true;
+			bakeLightmapOnly = true;
+		}
+		else if (std::strcmp(argv[i], "--shadows") == 0)
+		{
+			shadows = true;
+		}
+		else if (std::strcmp(argv[i], "--light") == 0 && i + 3 < argc)
+		{
+			sceneLightPosition.x = static_cast<float>(std::atof(argv[++i]));
+			sceneLightPosition.y = static_cast<float>(std::atof(argv[++i]));
+			sceneLightPosition.z = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--moving-light") == 0)
+		{
+			movingLight = true;
+		}
+		else if (std::strcmp(argv[i], "--shadow-stats") == 0)
+		{
+			shadowStats = true;
+		}
+		else if (std::strcmp(argv[i], "--no-program-cache") == 0)
+		{
+			programCache = false;
+		}
+		else if (std::strcmp(argv[i], "--overdraw") == 0)
+		{
+			overdrawStats = true;
+		}
+		else if (std::strcmp(argv[i], "--pacing") == 0 && i + 1 < argc)
+		{
+			const char* mode = argv[++i];
+			if (std::strcmp(mode, "off") == 0)
+			{
+				pacingMode = PacingMode::Uncapped;
+			}
+			else if (std::strcmp(mode, "vsync") == 0)
+			{
+				pacingMode = PacingMode::VSync;
+			}
+			else if (std::strcmp(mode, "adaptive") == 0)
+			{
+				pacingMode = PacingMode::AdaptiveVSync;
+			}
+			else if (std::strcmp(mode, "capped") == 0)
+			{
+				pacingMode = PacingMode::Capped;
+			}
+			else
+			{
+				std::cerr << "Unknown pacing mode " << mode << std::endl;
+			}
+		}
+		else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+		{
+			pacingMode = PacingMode::Capped;
+			frameRateCap = glm::max(std::atof(argv[++i]), 1.0);
+		}
+		else if (std::strcmp(argv[i], "--pacing-stats") == 0)
+		{
+			pacingStats = true;
+		}
+		else if (std::strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc)
+		{
+			benchmarkFrames = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--benchmark-output") == 0 && i + 1 < argc)
+		{
+			benchmarkOutputPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--profile") == 0)
+		{
+			profiling = true;
+		}
+		else if (std::strcmp(argv[i], "--profile-output") == 0 && i + 1 < argc)
+		{
+			profileOutputPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--job-benchmark") == 0 && i + 1 < argc)
+		{
+			jobBenchmarkWorkers = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--job-benchmark-output") == 0 && i + 1 < argc)
+		{
+			jobBenchmarkOutputPath = argv[++i];
+		}
+	}
+
+	// Streamed chunks are baked on their own, without the precomputed visibility of the whole maze
+	if (renderPath == RenderPath::Streamed)
+	{
+		portalCulling = false;
+		occlusionCulling = false;
+	}
+
+	// Lightmaps are baked for the whole maze, which streamed mazes are too large for
+	if (renderPath == RenderPath::Streamed && bakedLighting)
+	{
+		std::cerr << "Lightmaps are not supported with --streaming" << std::endl;
+		bakedLighting = false;
+		bakeLightmapOnly = false;
+	}
+
+	// The lightmap replaces the light of the scene, and already holds the shadows of its own sun
+	if (bakedLighting && shadows)
+	{
+		std::cerr << "Shadows are not supported with --lightmap" << std::endl;
+		shadows = false;
+	}
+
+	// Deferred shading already shades each pixel once, which is what the pre-pass is for
+	if (deferredShading)
+	{
+		depthPrepass = false;
+	}
+
+	// The generator benchmark only exercises the CPU, so it needs neither a window nor a context
+	if (mazeBenchmarkSize > 0)
+	{
+		if (!RunMazeGenerationBenchmark(mazeBenchmarkSize, mazeSeed, mazeBenchmarkOutputPath))
+		{
+			std::cerr << "Failed to write maze benchmark results to " << mazeBenchmarkOutputPath << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	// Worker threads for the parallel parts of loading and of the frame, plus this thread
+	JobSystem jobSystem;
+	jobSystem.Create();
+
+	// Map the maze file, generate a maze, or make up one of the requested size. Mapping the
+	// file only reads its header, so this takes the same time whatever the size of the maze.
+	MappedMaze mappedMaze;
+	WallGrid generatedWalls;
+	BinaryTreeMaze generatedMaze;
+	const MazeSource* mazeSource = &mappedMaze;
+	if (generateMaze)
+	{
+		int size = generatedMazeSize > 0 ? generatedMazeSize : 64;
+		GenerateMaze(generatedWalls, size, size, mazeAlgorithm, mazeSeed, &jobSystem);
+		mazeSource = &generatedWalls;
+		if (!savedMazePath.empty() && !SaveMazeFile(generatedWalls, savedMazePath))
+		{
+			std::cerr << "Failed to save maze " << savedMazePath << std::endl;
+		}
+	}
+	else if (generatedMazeSize > 0)
+	{
+		generatedMaze.Create(generatedMazeSize, generatedMazeSize, mazeSeed);
+		mazeSource = &generatedMaze;
+	}
+	else if (!mappedMaze.Open(mazeFilePath))
+	{
+		std::cerr << "Failed to load maze " << mazeFilePath << std::endl;
+		jobSystem.Destroy();
+		return 1;
+	}
+
+	// The maze never changes, so its tiles only need to be built and sorted into
+	// cells once instead of every frame. Streamed mazes can be far too large for
+	// that, so their tiles are only made for the chunks around the camera.
+	CellGrid cellGrid;
+	if (renderPath != RenderPath::Streamed || jobBenchmarkWorkers >= 0)
+	{
+		std::vector<Tile> mazeTiles;
+		mazeSource->GatherTiles(0, 0, mazeSource->GetWidth(), mazeSource->GetDepth(), mazeTiles);
+		cellGrid.Build(mazeTiles);
+	}
+
+	// Files computed from the maze are saved next to it, so they only need to be computed once
+	// per maze. Generated mazes that are not saved keep them next to the program.
+	std::string mazePath = generateMaze ? savedMazePath : (generatedMazeSize > 0 ? std::string() : mazeFilePath);
+	std::string mazeCachePath = mazePath.empty() ? std::string("maze") : mazePath;
+
+	// Load the lightmap saved next to the maze, or bake it on every core and save it for the
+	// next launch
+	Lightmap lightmap;
+	LightmapSettings lightmapSettings;
+	if (bakedLighting)
+	{
+		// The texels of the whole maze go into one texture, so larger mazes get fewer texels per tile
+		int texelsPerSide = Lightmap::FitTexelsPerSide(cellGrid, lightmapSettings.texelsPerSide, MaxLightmapTextureSize);
+		if (texelsPerSide == 0)
+		{
+			std::cerr << "Lightmaps are not supported for mazes larger than " << MaxLightmapTextureSize << " cells" << std::endl;
+			bakedLighting = false;
+			bakeLightmapOnly = false;
+		}
+		else if (texelsPerSide < lightmapSettings.texelsPerSide)
+		{
+			std::cerr << "Lightmap reduced to " << texelsPerSide << " texels per tile side to fit the maze" << std::endl;
+			lightmapSettings.texelsPerSide = texelsPerSide;
+		}
+	}
+	if (bakedLighting)
+	{
+		std::string lightmapPath = mazeCachePath + ".lightmap";
+		if (bakeLightmapOnly || !lightmap.Load(lightmapPath, cellGrid, lightmapSettings))
+		{
+			lightmap.Bake(cellGrid, lightmapSettings, jobSystem);
+			if (!lightmap.Save(lightmapPath, cellGrid, lightmapSettings))
+			{
+				std::cerr << "Failed to save lightmap " << lightmapPath << std::endl;
+			}
+		}
+
+		if (bakeLightmapOnly)
+		{
+			jobSystem.Destroy();
+			return 0;
+		}
+	}
+
+	// The scaling benchmark only exercises the CPU, so it needs neither a window nor a context
+	if (jobBenchmarkWorkers >= 0)
+	{
+		if (!RunJobScalingBenchmark(cellGrid, static_cast<unsigned>(jobBenchmarkWorkers), jobBenchmarkOutputPath))
+		{
+			std::cerr << "Failed to write job benchmark results to " << jobBenchmarkOutputPath << std::endl;
+			jobSystem.Destroy();
+			return 1;
+		}
+		jobSystem.Destroy();
+		return 0;
+	}
+
+	// --- Load our image using stb_image ---
+
+	// Im image-space (pixels), (0, 0) is the upper-left corner of the image
+	// However, in u-v coordinates, (0, 0) is the lower-left corner of the image
+	// This means that the image will appear upside-down when we use the image data as is
+	// This function tells stbi to flip the image vertically so that it is not upside-down when we use it
+	stbi_set_flip_vertically_on_load(true);
+
+	// 'imageWidth' and imageHeight will contain the width and height of the loaded image respectively
+	int imageWidth, imageHeight, numChannels;
+
+	// Read the image data and store it in an unsigned char array. Decoding does not need
+	// the OpenGL context, so it runs as a job while the window and the scene are set up.
+	unsigned char* imageData = nullptr;
+	Job* imageJob = jobSystem.CreateJob([&]()
+	{
+		imageData = stbi_load("pepehappy.jpg", &imageWidth, &imageHeight, &numChannels, 0);
+		// imageData = stbi_load("pepesad.jpg", &imageWidth, &imageHeight, &numChannels, 0);
+	});
+	jobSystem.Run(imageJob);
+
 	// Initialize GLFW
 	int glfwInitStatus = glfwInit();
 	if (glfwInitStatus == GLFW_FALSE)
 	{
 		std::cerr << "Failed to initialize GLFW!" << std::endl;
+		jobSystem.Wait(imageJob);
+		stbi_image_free(imageData);
+		jobSystem.Destroy();
 		return 1;
 	}
 
@@ -111,12 +560,22 @@ int main()
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+	// The benchmark renders to a window that is never shown, so it can run without a desktop
+	bool benchmarking = benchmarkFrames > 0;
+	if (benchmarking)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
 	// Tell GLFW to create a window
 
 	GLFWwindow* window = glfwCreateWindow(windowWidth, windowHeight, "Textures", nullptr, nullptr);
 	if (window == nullptr)
 	{
 		std::cerr << "Failed to create GLFW window!" << std::endl;
+		jobSystem.Wait(imageJob);
+		stbi_image_free(imageData);
+		jobSystem.Destroy();
 		glfwTerminate();
 		return 1;
 	}
@@ -127,169 +586,202 @@ int main()
 	// Register the callback function that handles when the framebuffer size has changed
 	glfwSetFramebufferSizeCallback(window, FramebufferSizeChangedCallback);
 
-	glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+	// The benchmark camera follows a fixed path instead of the mouse
+	if (!benchmarking)
+	{
+		glfwSetCursorPosCallback(window, mouse_callback);
+		glfwSetScrollCallback(window, scroll_callback);
+	}
 
 	// Tell GLAD to load the OpenGL function pointers
 	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
 	{
 		std::cerr << "Failed to initialize GLAD!" << std::endl;
+		jobSystem.Wait(imageJob);
+		stbi_image_free(imageData);
+		jobSystem.Destroy();
 		return 1;
 	}
 
+	// Every program linked from here on is saved next to the program, and loaded from there on
+	// the next launch. The loader only covers OpenGL 3.3, so the cache looks up its own functions.
+	ProgramBinaryCache programBinaryCache;
+	if (programCache && programBinaryCache.Create(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+	{
+		SetProgramBinaryCache(&programBinaryCache);
+	}
+
 	// tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	if (!benchmarking)
+	{
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
+
+	// Limit the frame rate, except in the benchmark, where the refresh rate of the display
+	// must not limit it
+	FramePacer framePacer;
+	framePacer.Create(benchmarking ? PacingMode::Uncapped : pacingMode, frameRateCap);
 
 	// --- Vertex specification ---
-	
-	// Set up the data for each vertex of the triangle
-	Vertex vertices[24];
-	//______________________________________FACING UP	
-	vertices[0].x = -1.0f;	vertices[0].y = -1.0f;	vertices[0].z = -1.0;
-	vertices[0].r = 255;	vertices[0].g = 255;	vertices[0].b = 255;
-	vertices[0].u = 0.0f;	vertices[0].v = 0.0f;
-
-	vertices[1].x = 1.0f;	vertices[1].y = -1.0f;	vertices[1].z = -1.0f;
-	vertices[1].r = 255;	vertices[1].g = 255;	vertices[1].b = 255;
-	vertices[1].u = 1.0f;	vertices[1].v = 0.0f;
-
-	vertices[2].x = -1.0f;	vertices[2].y = 1.0f;	vertices[2].z = -1.0f;
-	vertices[2].r = 255;	vertices[2].g = 255;	vertices[2].b = 255;
-	vertices[2].u = 0.0f;	vertices[2].v = 1.0f;
-
-	vertices[3].x = 1.0f;	vertices[3].y = 1.0f;	vertices[3].z = -1.0f;
-	vertices[3].r = 255;	vertices[3].g = 255;	vertices[3].b = 255;
-	vertices[3].u = 1.0f;	vertices[3].v = 1.0f;
-	//______________________________________ FRONT FACING FORWARD
-	vertices[4].x = 1.0f;	vertices[4].y = 1.0f;	vertices[4].z = 1.0f;
-	vertices[4].r = 255;	vertices[4].g = 255;		vertices[4].b = 255;
-	vertices[4].u = 0.0f;	vertices[4].v = 1.0f;
-
-	vertices[5].x = 1.0f;	vertices[5].y = -1.0f;	vertices[5].z = 1.0f;
-	vertices[5].r = 255;	vertices[5].g = 255;	vertices[5].b = 255;
-	vertices[5].u = 0.0f;	vertices[5].v = 0.0f;
-
-	vertices[6].x = -1.0f;	vertices[6].y = 1.0f;	vertices[6].z = 1.0f;
-	vertices[6].r = 255;	vertices[6].g = 255;		vertices[6].b = 255;
-	vertices[6].u = 1.0f;	vertices[6].v = 1.0f;
-
-	vertices[7].x = -1.0f;	vertices[7].y = -1.0f;	vertices[7].z = 1.0f;
-	vertices[7].r = 255;	vertices[7].g = 255;	vertices[7].b = 255;
-	vertices[7].u = 1.0f;	vertices[7].v = 0.0f;
-//______________________________________
-	vertices[8].x = -1.0f;	vertices[8].y = 1.0f;	vertices[8].z = -1.0f;
-	vertices[8].r = 255;	vertices[8].g = 255;		vertices[8].b = 255;
-	vertices[8].u = 0.0f;	vertices[8].v = 0.0f;
-
-	vertices[9].x = -1.0f;	vertices[9].y = 1.0f;	vertices[9].z = 1.0f;
-	vertices[9].r = 255;	vertices[9].g = 255;	vertices[9].b = 255;
-	vertices[9].u = 0.0f;	vertices[9].v = 1.0f;
-
-	vertices[10].x = 1.0f;	vertices[10].y = 1.0f;	vertices[10].z = -1.0f;
-	vertices[10].r = 255;	vertices[10].g = 255;		vertices[10].b = 255;
-	vertices[10].u = 1.0f;	vertices[10].v = 0.0f;
-
-	vertices[11].x = 1.0f;	vertices[11].y = 1.0f;	vertices[11].z = 1.0f;
-	vertices[11].r = 255;	vertices[11].g = 255;	vertices[11].b = 255;
-	vertices[11].u = 1.0f;	vertices[11].v = 1.0f;
-//______________________________________
-	vertices[12].x = -1.0f;	vertices[12].y = -1.0f;	vertices[12].z = -1.0f;
-	vertices[12].r = 255;	vertices[12].g = 255;		vertices[12].b = 255;
-	vertices[12].u = 0.0f;	vertices[12].v = 0.0f;
-
-	vertices[13].x = -1.0f;	vertices[13].y = -1.0f;	vertices[13].z = 1.0f;
-	vertices[13].r = 255;	vertices[13].g = 255;	vertices[13].b = 255;
-	vertices[13].u = 0.0f;	vertices[13].v = 1.0f;
-
-	vertices[14].x = 1.0f;	vertices[14].y = -1.0f;	vertices[14].z = -1.0f;
-	vertices[14].r = 255;	vertices[14].g = 255;		vertices[14].b = 255;
-	vertices[14].u = 1.0f;	vertices[14].v = 0.0f;
-
-	vertices[15].x = 1.0f;	vertices[15].y = -1.0f;	vertices[15].z = 1.0f;
-	vertices[15].r = 255;	vertices[15].g = 255;	vertices[15].b = 255;
-	vertices[15].u = 1.0f;	vertices[15].v = 1.0f;
-//______________________________________
-	vertices[16].x = -1.0f;	vertices[16].y = -1.0f;	vertices[16].z = 1.0f;
-	vertices[16].r = 255;	vertices[16].g = 255;	vertices[16].b = 255;
-	vertices[16].u = 0.0f;	vertices[16].v = 0.0f;
-
-	vertices[17].x = -1.0f;	vertices[17].y = 1.0f;	vertices[17].z = 1.0f;
-	vertices[17].r = 255;	vertices[17].g = 255;	vertices[17].b = 255;
-	vertices[17].u = 0.0f;	vertices[17].v = 1.0f;
-
-	vertices[18].x = -1.0f;	vertices[18].y = -1.0f;	vertices[18].z = -1.0f;
-	vertices[18].r = 255;	vertices[18].g = 255;	vertices[18].b = 255;
-	vertices[18].u = 1.0f;	vertices[18].v = 0.0f;
-
-	vertices[19].x = -1.0f;	vertices[19].y = 1.0f;	vertices[19].z = -1.0f;
-	vertices[19].r = 255;	vertices[19].g = 255;	vertices[19].b = 255;
-	vertices[19].u = 1.0f;	vertices[19].v = 1.0f;
-//______________________________________
-	vertices[20].x = 1.0f;	vertices[20].y = -1.0f;	vertices[20].z = -1.0f;
-	vertices[20].r = 255;	vertices[20].g = 255;	vertices[20].b = 255;
-	vertices[20].u = 0.0f;	vertices[20].v = 0.0f;
-
-	vertices[21].x = 1.0f;	vertices[21].y = 1.0f;	vertices[21].z = -1.0f;
-	vertices[21].r = 255;	vertices[21].g = 255;	vertices[21].b = 255;
-	vertices[21].u = 0.0f;	vertices[21].v = 1.0f;
-
-	vertices[22].x = 1.0f;	vertices[22].y = -1.0f;	vertices[22].z = 1.0f;
-	vertices[22].r = 255;	vertices[22].g = 255;	vertices[22].b = 255;
-	vertices[22].u = 1.0f;	vertices[22].v = 0.0f;
-
-	vertices[23].x = 1.0f;	vertices[23].y = 1.0f;	vertices[23].z = 1.0f;
-	vertices[23].r = 255;	vertices[23].g = 255;	vertices[23].b = 255;
-	vertices[23].u = 1.0f;	vertices[23].v = 1.0f;
-//______________________________________
-	vertices[24].x = 1.0f;	vertices[24].y = 1.0f;	vertices[24].z = 0.0f;
-	vertices[24].r = 255;	vertices[24].g = 255;	vertices[24].b = 255;
-	vertices[24].u = 0.0f;	vertices[24].v = 0.0f;
-
-	vertices[25].x = 1.0f;	vertices[25].y = 1.0f;	vertices[25].z = 1.0f;
-	vertices[25].r = 255;	vertices[25].g = 255;	vertices[25].b = 255;
-	vertices[25].u = 0.0f;	vertices[25].v = 1.0f;
-
-	vertices[26].x = 1.0f;	vertices[26].y = 0.0f;	vertices[26].z = 1.0f;
-	vertices[26].r = 255;	vertices[26].g = 255;	vertices[26].b = 255;
-	vertices[26].u = 1.0f;	vertices[26].v = 0.0f;
-
-	vertices[27].x = 1.0f;	vertices[27].y = 0.0f;	vertices[27].z = 0.0f;
-	vertices[27].r = 255;	vertices[27].g = 255;	vertices[27].b = 255;
-	vertices[27].u = 1.0f;	vertices[27].v = 1.0f;
-
-	// Create a vertex buffer object (VBO), and upload our vertices data to the VBO
-	GLuint vbo;
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-
-
-	// Create a vertex array object that contains data on how to map vertex attributes
-	// (e.g., position, color) to vertex shader properties.
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	
-	// Vertex attribute 0 - Position
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
-
-	// Vertex attribute 1 - Color
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)(offsetof(Vertex, r)));
-
-	// Vertex attribute 2 - UV coordinate
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, u)));
-
-	glBindVertexArray(0);
-
-	// Create a shader program
-	GLuint program = CreateShaderProgram("main.vsh", "main.fsh");
+
+	// Every tile is one face of this cube, moved into place
+	std::vector<MeshVertex> cubeVertices;
+	std::vector<GLuint> cubeIndices;
+	BuildCubeGeometry(cubeVertices, cubeIndices);
+
+	// Precompute which cells can be seen from each cell through the corridors of the maze,
+	// and save it next to the maze. The set grows with the square of the number of cells,
+	// so it is skipped for larger mazes.
+	if (portalCulling && cellGrid.GetCellCount() > MaxPotentiallyVisibleSetCells)
+	{
+		std::cerr << "Portal culling is not supported for mazes of more than " << MaxPotentiallyVisibleSetCells
+			<< " cells, use --streaming" << std::endl;
+		portalCulling = false;
+	}
+	PotentiallyVisibleSet potentiallyVisibleSet;
+	std::string potentiallyVisibleSetPath = mazeCachePath + ".pvs";
+	if (portalCulling && !potentiallyVisibleSet.Load(potentiallyVisibleSetPath, cellGrid))
+	{
+		potentiallyVisibleSet.Compute(cellGrid, jobSystem);
+		if (!potentiallyVisibleSet.Save(potentiallyVisibleSetPath, cellGrid))
+		{
+			std::cerr << "Failed to save potentially visible set " << potentiallyVisibleSetPath << std::endl;
+		}
+	}
+
+	// Cells that will be drawn this frame
+	std::vector<int> visibleCells;
+	std::vector<Tile> visibleTiles;
+
+	// Ring buffer for data written every frame, with one region per frame in flight.
+	// The regions grow when the visible tiles of a frame do not fit.
+	StreamBuffer streamBuffer;
+	streamBuffer.Create(1 << 20);
+
+	// Either bake every tile into one world-space vertex/index buffer, bake the chunks
+	// around the camera as it moves, or create one vertex array object per cube face and
+	// stream the model matrices of the tiles every frame
+	StaticWorld staticWorld;
+	WorldStreamer worldStreamer;
+	Mesh cubeMesh;
+	InstancedRenderer instancedRenderer;
+	if (renderPath == RenderPath::Baked)
+	{
+		staticWorld.Build(cellGrid, cubeVertices, cubeIndices, mergeTiles);
+	}
+	else if (renderPath == RenderPath::Streamed)
+	{
+		// Nothing beyond the far plane of the projection can be seen, so there is no need to load it
+		worldStreamer.Create(*mazeSource, cubeVertices, cubeIndices, jobSystem, streamingBudgetMegabytes << 20, 100.0f, mergeTiles);
+	}
+	else
+	{
+		cubeMesh.Create(cubeVertices, cubeIndices, std::vector<GLsizei>(TileFaceCount, 6));
+		instancedRenderer.Create(cubeMesh, streamBuffer, jobSystem, cellGrid.GetTiles());
+	}
+
+	// Group the cells into clusters, each with its own occlusion query. Merged quads span
+	// blocks of cells, so the clusters then match the blocks: each block is drawn by a
+	// single cluster, and the query of that cluster decides alone whether it is drawn.
+	OcclusionCuller occlusionCuller;
+	if (occlusionCulling)
+	{
+		occlusionCuller.Create(cellGrid, renderPath == RenderPath::Baked && mergeTiles ? StaticWorld::MergeBlockCells : 4);
+	}
+
+	// The lightmap was baked before the context could tell how large a texture may be
+	if (bakedLighting)
+	{
+		GLint maxTextureSize = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+		if (Lightmap::FitTexelsPerSide(cellGrid, lightmapSettings.texelsPerSide, maxTextureSize) < lightmapSettings.texelsPerSide)
+		{
+			std::cerr << "Lightmaps larger than " << maxTextureSize << " texels are not supported by this GPU" << std::endl;
+			bakedLighting = false;
+		}
+	}
+
+	// Create one variant of the shader program per kind of model matrix, each connected
+	// to the uniform buffer shared by every program. With deferred shading, they write the
+	// G-buffer and the lights are added by the lighting pass instead. The lightmap replaces
+	// the static lighting in both paths, and the shadow map hides the light of lightLoc
+	// wherever the walls block it.
+	std::vector<std::string> lightingDefines = torches ? ClusteredLights::GetShaderDefines() : std::vector<std::string>();
+	std::vector<std::string> sceneDefines = deferredShading ? DeferredRenderer::GetGeometryDefines() : lightingDefines;
+	if (bakedLighting)
+	{
+		std::vector<std::string> lightmapDefines = Lightmap::GetShaderDefines();
+		sceneDefines.insert(sceneDefines.end(), lightmapDefines.begin(), lightmapDefines.end());
+	}
+	if (shadows)
+	{
+		std::vector<std::string> shadowDefines = ShadowMap::GetShaderDefines();
+		sceneDefines.insert(sceneDefines.end(), shadowDefines.begin(), shadowDefines.end());
+	}
+	ShaderVariants sceneShaders;
+	sceneShaders.Create("main.vsh", "main.fsh", sceneDefines);
+
+	if (bakedLighting)
+	{
+		lightmap.CreateTexture();
+		for (int i = 0; i < TransformClassCount; i++)
+		{
+			lightmap.ConnectProgram(sceneShaders.Get(static_cast<TransformClass>(i)));
+		}
+	}
+
+	// The maze does not move, so the depth around the light is kept from frame to frame.
+	// Its range matches the far plane of the camera.
+	ShadowMap shadowMap;
+	std::vector<int> shadowCells;
+	if (shadows)
+	{
+		if (!shadowMap.Create(1024, 100.0f))
+		{
+			std::cerr << "Failed to create the shadow map" << std::endl;
+		}
+		for (int i = 0; i < TransformClassCount; i++)
+		{
+			shadowMap.ConnectProgram(sceneShaders.Get(static_cast<TransformClass>(i)));
+		}
+	}
+
+	DeferredRenderer deferredRenderer;
+	if (deferredShading && !deferredRenderer.Create(windowWidth, windowHeight, lightingDefines))
+	{
+		std::cerr << "Failed to create the deferred renderer" << std::endl;
+	}
+
+	// Bins the torches into the clusters of the view every frame, with the planes of the projection
+	ClusteredLights clusteredLights;
+	std::vector<PointLight> torchLights;
+	if (torches)
+	{
+		clusteredLights.Create(jobSystem, windowWidth, windowHeight, 0.1f, 100.0f);
+		if (deferredShading)
+		{
+			clusteredLights.ConnectProgram(deferredRenderer.GetLightingProgram());
+		}
+		else
+		{
+			for (int i = 0; i < TransformClassCount; i++)
+			{
+				clusteredLights.ConnectProgram(sceneShaders.Get(static_cast<TransformClass>(i)));
+			}
+		}
+	}
+
+	// Same vertex shaders, without any shading, for the depth pre-pass
+	ShaderVariants depthShaders;
+	if (depthPrepass)
+	{
+		depthShaders.Create("main.vsh", "depth.fsh");
+	}
+
+	// Per-frame values, written to the stream buffer every frame
+	FrameUniforms frameUniforms;
+	frameUniforms.Create(streamBuffer);
+	FrameUniformData frameData;
 
 	// Tell OpenGL the dimensions of the region where stuff will be drawn.
 	// For now, tell OpenGL to use the whole screen
@@ -300,21 +792,8 @@ int main()
 	GLuint tex;
 	glGenTextures(1, &tex);
 
-	// --- Load our image using stb_image ---
-
-	// Im image-space (pixels), (0, 0) is the upper-left corner of the image
-	// However, in u-v coordinates, (0, 0) is the lower-left corner of the image
-	// This means that the image will appear upside-down when we use the image data as is
-	// This function tells stbi to flip the image vertically so that it is not upside-down when we use it
-	stbi_set_flip_vertically_on_load(true);
-
-	// 'imageWidth' and imageHeight will contain the width and height of the loaded image respectively
-	int imageWidth, imageHeight, numChannels;
-
-	// Read the image data and store it in an unsigned char array
-	unsigned char* imageData = stbi_load("pepehappy.jpg", &imageWidth, &imageHeight, &numChannels, 0);
-	// unsigned char* imageData = stbi_load("pepesad.jpg", &imageWidth, &imageHeight, &numChannels, 0);
-
+	// Wait for the image, which was decoded while everything else was set up
+	jobSystem.Wait(imageJob);
 
 	//Make sure that we actually loaded the image before uploading the data to the GPU
 	if (imageData != nullptr)
@@ -353,24 +832,86 @@ int main()
 	glm::vec3 specularColor = glm::vec3(0.3f, 0.3f, 0.3f);
 	glm::vec3 objectSpecular = glm::vec3(0.4f, 0.4f, 0.4f);
 
-	glm::vec3 lightLocation = glm::vec3(-20.0f, -20.0f, 0.0f);
+	glm::vec3 lightLocation = sceneLightPosition;
 
 	float specShine = 0.3;
 
+	double lastTitleUpdate = 0.0;
+
+	// The first frames of the benchmark are not measured, since they include one-time work
+	// such as the driver compiling the shaders for the GPU
+	const int benchmarkWarmupFrames = 10;
+	int benchmarkFrame = -benchmarkWarmupFrames;
+	CameraPath benchmarkPath = CameraPath::CreateMazeFlythrough(*mazeSource);
+	BenchmarkRecorder benchmarkRecorder;
+	benchmarkRecorder.Begin(benchmarkFrames);
+
+	// Measures the passes of each frame, with timestamp queries for the GPU side
+	Profiler profiler;
+	if (profiling && !profiler.Create(profileOutputPath))
+	{
+		std::cerr << "Failed to open " << profileOutputPath << std::endl;
+	}
+
+	// Counts the fragments shaded every frame, to compare the draw orders and the depth pre-pass
+	OverdrawCounter overdrawCounter;
+	if (overdrawStats || benchmarking)
+	{
+		overdrawCounter.Create();
+	}
+
+	// Simulate the camera at a fixed rate on its own thread, so the frame rate does not
+	// change how it moves and heavier simulation work does not hold up the frames
+	if (!benchmarking)
+	{
+		CameraState initialCamera;
+		initialCamera.position = cameraPos;
+		initialCamera.front = cameraFront;
+		initialCamera.fov = fov;
+		simulation.Start(initialCamera, 1.0 / 120.0, globalSpeed);
+	}
+
+	// Everything up to here is only done once, at startup
+	std::chrono::duration<double, std::milli> startupTime = std::chrono::steady_clock::now() - launchTime;
+
 	// Render loop
 	while (!glfwWindowShouldClose(window))
 	{
-		double current_time = glfwGetTime()/2;
+		profiler.BeginFrame();
+
+		// The counts arrive a few frames late, so the benchmark records them as they come
+		if (overdrawCounter.BeginFrame() && benchmarking && benchmarkFrame >= 0)
+		{
+			benchmarkRecorder.AddOverdraw(overdrawCounter.GetOverdraw());
+		}
+
+		std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+
+		// The benchmark advances a fixed time step every frame, so every run draws the same frames
+		double now = benchmarking ? (benchmarkFrame + benchmarkWarmupFrames) / 60.0 : glfwGetTime();
+
+		double current_time = now/2;
 		double sinValue = fabs((float)sin(current_time));
-		// per-frame time logic
-        // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        float currentFrame = static_cast<float>(now);
 
         // input
         // -----
-        processInput(window);
+		if (benchmarking)
+		{
+			float progress = benchmarkFrames > 1 ? glm::max(benchmarkFrame, 0) / static_cast<float>(benchmarkFrames - 1) : 0.0f;
+			CameraPose pose = benchmarkPath.Evaluate(progress);
+			cameraPos = pose.position;
+			cameraFront = pose.front;
+		}
+		else
+		{
+			processInput(window);
+
+			CameraState camera = simulation.GetCamera(frameStart);
+			cameraPos = camera.position;
+			cameraFront = camera.front;
+			fov = camera.fov;
+		}
 
 		//BG COLOR RGBA FORMAT
 		glClearColor((sinValue * 245.0f)/255.0f,(sinValue * 245.0f)/255.0f,(sinValue * 220.0f)/255.0f, 1.0f);
@@ -378,11 +919,22 @@ int main()
 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, tex);
+		if (bakedLighting)
+		{
+			lightmap.Bind();
+		}
 
 		glm::mat4 viewMatrix = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
 
 		glm::mat4 projectionMatrix = glm::perspective(glm::radians(fov), (float)imageWidth / (float)imageHeight, 0.1f, 100.0f);
 
+		// A quarter of a turn every second, one cell away from where the light was placed
+		if (movingLight)
+		{
+			float angle = static_cast<float>(now) * glm::half_pi<float>();
+			lightLocation = sceneLightPosition + CellGrid::CellSize * glm::vec3(glm::cos(angle), 0.0f, glm::sin(angle));
+		}
+
 		// glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);  //BACK FACING FORWARD
 		// glDrawArrays(GL_TRIANGLE_STRIP, 4, 4);  //FRONT FACING FORWARD
 		// glDrawArrays(GL_TRIANGLE_STRIP, 8, 4);  //CEILING
@@ -390,425 +942,398 @@ int main()
 		// glDrawArrays(GL_TRIANGLE_STRIP, 16, 4); //LEFT WALL
 		// glDrawArrays(GL_TRIANGLE_STRIP, 20, 4); //RIGHT WALL
 		
-		glUseProgram(program);
-		glBindVertexArray(vao);
-		//Ambient Lighting
-
-		GLint ambientLightingUniform = glGetUniformLocation(program, "ambientLightColor");
-		glUniform3fv(ambientLightingUniform, 1, glm::value_ptr(ambientColor));
-		
-		GLint diffuseLightingUniform = glGetUniformLocation(program, "diffuseLightColor");
-		glUniform3fv(diffuseLightingUniform, 1, glm::value_ptr(diffuseColor));
-
-		GLint specularLightingUniform = glGetUniformLocation(program, "specularLightColor");
-		glUniform3fv(specularLightingUniform, 1, glm::value_ptr(specularColor));
-		
-		GLint objectSpecularUniform = glGetUniformLocation(program, "objectSpecularColor");
-		glUniform3fv(objectSpecularUniform, 1, glm::value_ptr(objectSpecular));
-
-		GLint lightPositionUniform = glGetUniformLocation(program, "lightLoc");
-		glUniform3fv(lightPositionUniform, 1, glm::value_ptr(lightLocation));
-
-		GLint shinyUniform = glGetUniformLocation(program, "shiny");
-		glUniform1f(shinyUniform, specShine);
-
-		GLint cameraPositionUniform = glGetUniformLocation(program, "camLoc");
-		glUniform3fv(cameraPositionUniform, 1, glm::value_ptr(cameraPos));
-
-		GLint timeLocation = glGetUniformLocation(program, "time");
-		glUniform1f(timeLocation, glfwGetTime()/2);
-
-		// FLOOR
-		glm::vec3 floorArray[101];
-		int floatCount = 0;
-		for(int i = 0; i < 10; i++){
-			for(int j = 0 ; j < 10; j++)
-			{
-				floorArray[floatCount] = glm::vec3((-2.0 * i),  0.0f, (-2.0 * j));
-				floatCount++;
-			}
+		// Start writing to the region of the stream buffer that belongs to this frame
+		{
+			ProfileScope scope(profiler, "Upload");
+			streamBuffer.BeginFrame();
+
+			// Fill in the values shared by every program and upload them all at once
+			//Ambient Lighting
+			frameData.ambientLightColor = ambientColor;
+			frameData.diffuseLightColor = diffuseColor;
+			frameData.specularLightColor = specularColor;
+			frameData.objectSpecularColor = objectSpecular;
+			frameData.lightLoc = lightLocation;
+			frameData.shiny = specShine;
+			frameData.camLoc = cameraPos;
+			frameData.time = static_cast<GLfloat>(now/2);
+			frameData.viewProjection = projectionMatrix * viewMatrix;
+			frameUniforms.Upload(frameData);
 		}
 
-		glm::mat4 mat = glm::mat4(1.0f);
-
-		for(int i = 0; i < 101; i++)
+		// Place the torches within sight and bin them into the clusters of this view
+		if (torches)
 		{
-			glm::mat4 mat = glm::mat4(1.0f);
-			mat = glm::scale(mat, glm::vec3(1.0f, 1.0f, 1.0f));
-			mat = glm::translate(mat, floorArray[i]);
-
-			glm::mat4 modelMatrix = projectionMatrix * viewMatrix * mat;
-
-			GLint modelMatrixUniform = glGetUniformLocation(program, "model");
-			glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, glm::value_ptr(mat));
-
-			GLint mvpUniform = glGetUniformLocation(program, "mvp");
-			glUniformMatrix4fv(mvpUniform, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-
-			GLint translateuniformLocation = glGetUniformLocation(program, "translate");
-			glUniformMatrix4fv(translateuniformLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-
-			glDrawArrays(GL_TRIANGLE_STRIP, 12, 4);
+			ProfileScope scope(profiler, "Lights");
+			GatherTorches(*mazeSource, cameraPos, 100.0f, torchSpacing, static_cast<float>(now), torchLights);
+			clusteredLights.Update(torchLights, viewMatrix, projectionMatrix);
+			clusteredLights.Bind();
 		}
 
-		
-
-		//WALLS
-
-		glm::vec3 rightWallArray[11];
-		for(int i = 0; i < 10; i++){
-			rightWallArray[i] = glm::vec3( 0.0f,  0.0f,(-2.0 * i));
+		// Load the chunks around the camera and evict the ones left behind
+		if (renderPath == RenderPath::Streamed)
+		{
+			ProfileScope scope(profiler, "Streaming");
+			worldStreamer.Update(cameraPos);
 		}
 
-		for(int i = 0; i < 10; i++)
+		// The shadow map is only drawn again when the light moved or the chunks within its
+		// range were loaded or evicted. Otherwise the depth of the previous frames is reused.
+		if (shadows)
 		{
-			glm::mat4 mat2 = glm::mat4(1.0f);
-			mat2 = glm::scale(mat2, glm::vec3(1.0f, 1.0f, 1.0f));
-			mat2 = glm::translate(mat2,rightWallArray[i]);
-
-
-			glm::mat4 modelMatrix2 = projectionMatrix * viewMatrix * mat2;
-
-			GLint modelMatrixUniform = glGetUniformLocation(program, "model");
-			glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, glm::value_ptr(mat2));
-
-			GLint mvpUniform = glGetUniformLocation(program, "mvp");
-			glUniformMatrix4fv(mvpUniform, 1, GL_FALSE, glm::value_ptr(modelMatrix2));
-
-			GLint translateuniformLocation = glGetUniformLocation(program, "translate");
-			glUniformMatrix4fv(translateuniformLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix2));
+			ProfileScope scope(profiler, "Shadows");
+			Frustum casterFrustum = shadowMap.GetCasterFrustum(lightLocation);
+			if (renderPath == RenderPath::Streamed && worldStreamer.HasChangedWithin(casterFrustum))
+			{
+				shadowMap.Invalidate();
+			}
 
-			glDrawArrays(GL_TRIANGLE_STRIP, 20, 4);
+			if (shadowMap.NeedsUpdate(lightLocation))
+			{
+				// Gather the casters once, since every face draws the same ones. The chunks are
+				// culled again for the camera right after.
+				if (renderPath == RenderPath::Streamed)
+				{
+					worldStreamer.Cull(casterFrustum, lightLocation, false);
+				}
+				else
+				{
+					cellGrid.CullFrustum(casterFrustum, shadowCells);
+					if (renderPath == RenderPath::Instanced)
+					{
+						visibleTiles.clear();
+						cellGrid.GatherTiles(shadowCells, visibleTiles);
+						instancedRenderer.SetTiles(visibleTiles);
+					}
+				}
+
+				shadowMap.Render(lightLocation, [&](ShaderVariants& shaders)
+				{
+					if (renderPath == RenderPath::Baked)
+					{
+						shaders.Use(TransformClass::Translation);
+						staticWorld.Draw(shadowCells);
+					}
+					else if (renderPath == RenderPath::Streamed)
+					{
+						shaders.Use(TransformClass::Translation);
+						worldStreamer.Draw();
+					}
+					else
+					{
+						instancedRenderer.Draw(shaders);
+					}
+				});
+			}
+			shadowMap.Bind();
 		}
 
-		glm::vec3 leftWallArray[11];
-		for(int i = 0; i < 10; i++){
-			leftWallArray[i] = glm::vec3( -18.0f,  0.0f,(-2.0 * i));
+		if (renderPath == RenderPath::Streamed)
+		{
+			// Only the loaded chunks can be drawn, so they are culled instead of the whole maze
+			ProfileScope scope(profiler, "Culling");
+			worldStreamer.Cull(Frustum::FromMatrix(projectionMatrix * viewMatrix), cameraPos, frontToBack);
 		}
-
-		for(int i = 0; i < 10; i++)
+		else
 		{
-			glm::mat4 mat3 = glm::mat4(1.0f);
-			mat3 = glm::scale(mat3, glm::vec3(1.0f, 1.0f, 1.0f));
-			mat3 = glm::translate(mat3,leftWallArray[i]);
+			ProfileScope scope(profiler, "Culling");
 
-			glm::mat4 modelMatrix3 = projectionMatrix * viewMatrix * mat3;
-			
-			GLint modelMatrixUniform = glGetUniformLocation(program, "model");
-			glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, glm::value_ptr(mat3));
-
-			GLint mvpUniform = glGetUniformLocation(program, "mvp");
-			glUniformMatrix4fv(mvpUniform, 1, GL_FALSE, glm::value_ptr(modelMatrix3));
-
-			GLint translateuniformLocation = glGetUniformLocation(program, "translate");
-			glUniformMatrix4fv(translateuniformLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix3));
+			// Find the cells inside the view frustum. Rectangles of cells are tested
+			// against the frustum planes first, so most cells are never tested on their own.
+			if (frustumCulling)
+			{
+				cellGrid.CullFrustum(Frustum::FromMatrix(projectionMatrix * viewMatrix), visibleCells);
+			}
+			else
+			{
+				visibleCells.clear();
+				for (int cell = 0; cell < cellGrid.GetCellCount(); cell++)
+				{
+					visibleCells.push_back(cell);
+				}
+			}
 
-			glDrawArrays(GL_TRIANGLE_STRIP, 16, 4);
-		}
+			// While the camera is inside the maze, the walls hide every cell that is not
+			// in the potentially visible set of the cell containing the camera
+			int cameraCell = cellGrid.GetCellIndex(cameraPos);
+			if (potentiallyVisibleSet.IsValid() && cameraCell >= 0 && cellGrid.IsBetweenFloorAndWallTops(cameraPos))
+			{
+				potentiallyVisibleSet.Filter(cameraCell, visibleCells);
+			}
 
-		glm::vec3 frontWallArray[11];
-		for(int i = 0; i < 10; i++){
-			frontWallArray[i] = glm::vec3( (-2.0 * i),  0.0f, 0.0f);
+			if (frontToBack)
+			{
+				cellGrid.SortFrontToBack(cameraPos, visibleCells);
+			}
 		}
 
-		for(int i = 0; i < 10; i++)
+		// Floor tiles, boundary walls and maze walls of the visible cells
+		int frameDrawCalls = 0;
+		long long frameTriangles = 0;
+		bool shadingPass = true;
+		auto drawCells = [&](const std::vector<int>& cells)
 		{
-			glm::mat4 mat4 = glm::mat4(1.0f);
-			mat4 = glm::scale(mat4, glm::vec3(1.0f, 1.0f, 1.0f));
-			mat4 = glm::translate(mat4,frontWallArray[i]);
-
-			glm::mat4 modelMatrix4 = projectionMatrix * viewMatrix * mat4;
+			ShaderVariants& shaders = shadingPass ? sceneShaders : depthShaders;
+			if (shadingPass)
+			{
+				overdrawCounter.BeginPass();
+			}
 
-			GLint modelMatrixUniform = glGetUniformLocation(program, "model");
-			glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, glm::value_ptr(mat4));
+			if (renderPath == RenderPath::Baked)
+			{
+				// The baked vertices are already in world space, with only a translation per tile
+				shaders.Use(TransformClass::Translation);
+				staticWorld.Draw(cells);
+				frameDrawCalls += staticWorld.GetDrawCount();
+				frameTriangles += staticWorld.GetTriangleCount();
+			}
+			else if (renderPath == RenderPath::Streamed)
+			{
+				// Each chunk draws the cells it found when it was culled
+				shaders.Use(TransformClass::Translation);
+				worldStreamer.Draw();
+				frameDrawCalls += worldStreamer.GetDrawCount();
+				frameTriangles += worldStreamer.GetTriangleCount();
+			}
+			else
+			{
+				visibleTiles.clear();
+				cellGrid.GatherTiles(cells, visibleTiles);
+				instancedRenderer.SetTiles(visibleTiles);
+				instancedRenderer.Draw(shaders);
+				frameDrawCalls += instancedRenderer.GetDrawCount();
+				frameTriangles += instancedRenderer.GetTriangleCount();
+			}
 
-			GLint mvpUniform = glGetUniformLocation(program, "mvp");
-			glUniformMatrix4fv(mvpUniform, 1, GL_FALSE, glm::value_ptr(modelMatrix4));
+			overdrawCounter.EndPass();
+		};
 
-			GLint translateuniformLocation = glGetUniformLocation(program, "translate");
-			glUniformMatrix4fv(translateuniformLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix4));
+		if (depthPrepass)
+		{
+			// Lay down the depth of the visible cells without shading them. The occlusion
+			// queries issued here test against the complete depth of the scene.
+			{
+				ProfileScope scope(profiler, "Depth pre-pass");
+				shadingPass = false;
+				glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+				if (occlusionCulling)
+				{
+					occlusionCuller.Draw(visibleCells, cameraPos, drawCells);
+				}
+				else
+				{
+					drawCells(visibleCells);
+				}
+				glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			}
 
-			glDrawArrays(GL_TRIANGLE_STRIP, 4, 4);
+			// Only the nearest surface of each pixel still passes the depth test
+			{
+				ProfileScope scope(profiler, "Scene");
+				shadingPass = true;
+				glDepthFunc(GL_LEQUAL);
+				glDepthMask(GL_FALSE);
+				if (occlusionCulling)
+				{
+					occlusionCuller.Redraw(drawCells);
+				}
+				else
+				{
+					drawCells(visibleCells);
+				}
+				glDepthMask(GL_TRUE);
+				glDepthFunc(GL_LESS);
+			}
 		}
+		else
+		{
+			ProfileScope scope(profiler, "Scene");
+			if (deferredShading)
+			{
+				int framebufferWidth = 0;
+				int framebufferHeight = 0;
+				glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+				deferredRenderer.BeginGeometryPass(framebufferWidth, framebufferHeight);
+			}
 
-		glm::vec3 backWallArray[11];
-		for(int i = 0; i < 10; i++){
-			backWallArray[i] = glm::vec3((-2.0 * i),  0.0f, -18.0f);
+			if (occlusionCulling)
+			{
+				occlusionCuller.Draw(visibleCells, cameraPos, drawCells);
+			}
+			else
+			{
+				drawCells(visibleCells);
+			}
 		}
 
-		for(int i = 0; i < 10; i++)
+		// Shade the pixels of the G-buffer into the window
+		if (deferredShading)
 		{
-			glm::mat4 mat5 = glm::mat4(1.0f);
-			mat5 = glm::scale(mat5, glm::vec3(1.0f, 1.0f, 1.0f));
-			mat5 = glm::translate(mat5,backWallArray[i]);
-
-			glm::mat4 modelMatrix5 = projectionMatrix * viewMatrix * mat5;
-
-			GLint modelMatrixUniform = glGetUniformLocation(program, "model");
-			glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, glm::value_ptr(mat5));
-
-			GLint mvpUniform = glGetUniformLocation(program, "mvp");
-			glUniformMatrix4fv(mvpUniform, 1, GL_FALSE, glm::value_ptr(modelMatrix5));
-
-			GLint translateuniformLocation = glGetUniformLocation(program, "translate");
-			glUniformMatrix4fv(translateuniformLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix5));
-
-			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+			ProfileScope scope(profiler, "Lighting");
+			deferredRenderer.DrawLighting(projectionMatrix * viewMatrix);
 		}
 
-		glm::vec3 backWallMazeArray[46] = {
-			//FIRST ROW
-			glm::vec3(-0.0f, 0.0f,-2.0f),
-			glm::vec3(-14.0f, 0.0f,-2.0f),
-			glm::vec3(-16.0f, 0.0f,-2.0f),
-			glm::vec3(-18.0f, 0.0f,-2.0f),
-
-
-			glm::vec3(-2.0f, 0.0f,-4.0f),
-			glm::vec3(-6.0f, 0.0f,-4.0f),
-			glm::vec3(-8.0f,0.0f,-4.0f),
-			glm::vec3(-16.0f,0.0f,-4.0f),
-
-			glm::vec3(-4.0f,0.0f,-6.0f),
-			glm::vec3(-6.0f,0.0f,-6.0f),
-			glm::vec3(-12.0f,0.0f,-6.0f),
-			glm::vec3(-14.0f,0.0f,-6.0f),
-
-			glm::vec3(-2.0f, 0.0f, -8.0f),
-			glm::vec3(-12.0f,0.0f, -8.0f),
-			glm::vec3(-14.0f,0.0f, -8.0f),
-			glm::vec3(-16.0f,0.0f, -8.0f),
-
-			glm::vec3(-2.0f,0.0f,-10.0f),
-
-			glm::vec3(0.0f,0.0f,-12.0f),
-			glm::vec3(-2.0f,0.0f,-12.0f),
-			glm::vec3(-4.0f,0.0f,-12.0f),
-			glm::vec3(-14.0f,0.0f,-12.0f),
-
-			glm::vec3(-2.0f,0.0f,-14.0f),
-			glm::vec3(-4.0f,0.0f,-14.0f),
-			glm::vec3(-10.0f,0.0f,-14.0f),
-			glm::vec3(-12.0f,0.0f,-14.0f),
-			glm::vec3(-14.0f,0.0f,-14.0f),
-			glm::vec3(-16.0f,0.0f,-14.0f),
-
-			glm::vec3(-2.0f,0.0f,-16.0f),
-			glm::vec3(-4.0f,0.0f,-16.0f),
-			glm::vec3(-8.0f,0.0f,-16.0f),
-			glm::vec3(-10.0f,0.0f,-16.0f),
-			glm::vec3(-12.0f,0.0f,-16.0f),
-			glm::vec3(-14.0f,0.0f,-16.0f),
-			glm::vec3(-16.0f,0.0f,-16.0f),
-
-
-			glm::vec3(-0.0f,0.0f,-18.0f),
-			glm::vec3(-12.0f,0.0f,-18.0f),
-			glm::vec3(-14.0f,0.0f,-18.0f),
-		};
-
-		for(int i = 0; i < 46; i++)
+		// Show how many clusters the GPU skipped, the overdraw and where the time goes in
+		// the title bar, a few times per second
+		if ((occlusionCulling || overdrawStats || pacingStats || streamingStats || lightStats || shadowStats || profiler.IsEnabled()) && currentFrame - lastTitleUpdate > 0.25)
 		{
-			glm::mat4 mat6 = glm::mat4(1.0f);
-			mat6 = glm::scale(mat6, glm::vec3(1.0f, 1.0f, 1.0f));
-			mat6 = glm::translate(mat6,backWallMazeArray[i]);
-
-			glm::mat4 modelMatrix6= projectionMatrix * viewMatrix * mat6;
-
-			GLint modelMatrixUniform = glGetUniformLocation(program, "model");
-			glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, glm::value_ptr(mat6));
-
-			GLint mvpUniform = glGetUniformLocation(program, "mvp");
-			glUniformMatrix4fv(mvpUniform, 1, GL_FALSE, glm::value_ptr(modelMatrix6));
-
-			GLint translateuniformLocation = glGetUniformLocation(program, "translate");
-			glUniformMatrix4fv(translateuniformLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix6));
-
-			glDrawArrays(GL_TRIANGLE_STRIP, 4, 4);
+			std::string title = "Textures";
+			if (occlusionCulling)
+			{
+				title += " - " + std::to_string(occlusionCuller.GetCulledClusterCount()) + "/"
+					+ std::to_string(occlusionCuller.GetActiveClusterCount()) + " clusters occluded";
+			}
+			if (overdrawStats)
+			{
+				char overdrawText[64];
+				std::snprintf(overdrawText, sizeof(overdrawText), " - overdraw %.2fx", overdrawCounter.GetOverdraw());
+				title += overdrawText;
+			}
+			if (pacingStats)
+			{
+				title += " - " + framePacer.FormatReadout();
+			}
+			if (streamingStats && renderPath == RenderPath::Streamed)
+			{
+				title += " - " + worldStreamer.FormatReadout();
+			}
+			if (lightStats && torches)
+			{
+				title += " - " + clusteredLights.FormatReadout();
+			}
+			if (shadowStats && shadows)
+			{
+				title += " - " + shadowMap.FormatReadout();
+			}
+			if (profiler.IsEnabled())
+			{
+				title += " - " + profiler.FormatReadout();
+			}
+			glfwSetWindowTitle(window, title.c_str());
+			lastTitleUpdate = currentFrame;
 		}
 
-		glm::vec3 sideWallMazeArray[41] = {
-			glm::vec3(-2.0f,0.0f, -4.0f),
-			glm::vec3(-2.0f,0.0f, -6.0f),
-
-			glm::vec3(-4.0f,0.0f, 0.0f),
-			glm::vec3(-4.0f,0.0f, -2.0f),
-			glm::vec3(-4.0f,0.0f, -8.0f),
-			glm::vec3(-4.0f,0.0f, -16.0f),
-			glm::vec3(-4.0f,0.0f, -18.0f),
-
-			glm::vec3(-6.0f,0.0f, -2.0f),
-			glm::vec3(-6.0f,0.0f, -4.0f),
-			glm::vec3(-6.0f,0.0f, -8.0f),
-			glm::vec3(-6.0f,0.0f, -10.0f),
-			glm::vec3(-6.0f,0.0f, -16.0f),
+		// The region of this frame can be reused once the GPU has finished these commands
+		streamBuffer.EndFrame();
 
-			glm::vec3(-8.0f,0.0f, 0.0f),
-			glm::vec3(-8.0f,0.0f, -6.0f),
-			glm::vec3(-8.0f,0.0f, -8.0f),
-			glm::vec3(-8.0f,0.0f, -10.0f),
-			glm::vec3(-8.0f,0.0f, -12.0f),
-			glm::vec3(-8.0f,0.0f, -14.0f),
-			glm::vec3(-8.0f,0.0f, -16.0f),
-			glm::vec3(-8.0f,0.0f, -18.0f),
-
-			glm::vec3(-10.0f,0.0f, -2.0f),
-			glm::vec3(-10.0f,0.0f, -10.0f),
-			glm::vec3(-10.0f,0.0f, -12.0f),
-			glm::vec3(-10.0f,0.0f, -18.0f),
-
-			glm::vec3(-12.0f,0.0f, -2.0f),
-			glm::vec3(-12.0f,0.0f, -4.0f),
-			glm::vec3(-12.0f,0.0f, -12.0f),
-			glm::vec3(-12.0f,0.0f, -14.0f),
-
-			glm::vec3(-14.0f,0.0f, -8.0f),
-
-			glm::vec3(-18.0f,0.0f, -6.0f),
-			glm::vec3(-18.0f,0.0f, -8.0f),
-			glm::vec3(-18.0f,0.0f, -10.0f),
-			glm::vec3(-18.0f,0.0f, -12.0f),
-			glm::vec3(-18.0f,0.0f, -14.0f),
-			glm::vec3(-18.0f,0.0f, -18.0f),
-		};
-
-		for(int i = 0; i < 41; i++)
+		// Wait until the next frame is due when the frame rate is capped
 		{
-			glm::mat4 mat7 = glm::mat4(1.0f);
-			mat7 = glm::scale(mat7, glm::vec3(1.0f, 1.0f, 1.0f));
-			mat7 = glm::translate(mat7, sideWallMazeArray[i]);
-
-			glm::mat4 modelMatrix7 = projectionMatrix * viewMatrix * mat7;
-
-			GLint modelMatrixUniform = glGetUniformLocation(program, "model");
-			glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, glm::value_ptr(mat7));
-
-			GLint mvpUniform = glGetUniformLocation(program, "mvp");
-			glUniformMatrix4fv(mvpUniform, 1, GL_FALSE, glm::value_ptr(modelMatrix7));
-
-			GLint translateuniformLocation = glGetUniformLocation(program, "translate");
-			glUniformMatrix4fv(translateuniformLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix7));
-
-			glDrawArrays(GL_TRIANGLE_STRIP, 20, 4);
+			ProfileScope scope(profiler, "Pacing");
+			framePacer.Wait();
 		}
 
-
-		// "Unuse" the vertex array object
-		glBindVertexArray(0);
-
 		// Tell GLFW to swap the screen buffer with the offscreen buffer
-		glfwSwapBuffers(window);
+		{
+			ProfileScope scope(profiler, "Present");
+			glfwSwapBuffers(window);
+		}
+		framePacer.EndFrame();
 
 		// Tell GLFW to process window events (e.g., input events, window closed events, etc.)
 		glfwPollEvents();
-	}
-
-	// --- Cleanup ---
 
-	// Make sure to delete the shader program
-	glDeleteProgram(program);
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+		overdrawCounter.EndFrame(static_cast<long long>(framebufferWidth) * framebufferHeight);
+		profiler.EndFrame();
 
-	// Delete the VBO that contains our vertices
-	glDeleteBuffers(1, &vbo);
+		if (benchmarking)
+		{
+			// Wait for the GPU, so the measured time covers the whole frame and not just
+			// the time taken to submit it
+			glFinish();
+			std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+			if (benchmarkFrame >= 0)
+			{
+				benchmarkRecorder.AddFrame(frameTime.count(), frameDrawCalls, frameTriangles);
+			}
 
-	// Delete the vertex array object
-	glDeleteVertexArrays(1, &vao);
+			if (++benchmarkFrame >= benchmarkFrames)
+			{
+				glfwSetWindowShouldClose(window, true);
+			}
+		}
+	}
 
-	// Remember to tell GLFW to clean itself up before exiting the application
-	glfwTerminate();
+	simulation.Stop();
 
-	return 0;
-}
-/// <summary>
-/// Creates a shader program based on the provided file paths for the vertex and fragment shaders.
-/// </summary>
-/// <param name="vertexShaderFilePath">Vertex shader file path</param>
-/// <param name="fragmentShaderFilePath">Fragment shader file path</param>
-/// <returns>OpenGL handle to the created shader program</returns>
-GLuint CreateShaderProgram(const std::string& vertexShaderFilePath, const std::string& fragmentShaderFilePath)
-{
-	GLuint vertexShader = CreateShaderFromFile(GL_VERTEX_SHADER, vertexShaderFilePath);
-	GLuint fragmentShader = CreateShaderFromFile(GL_FRAGMENT_SHADER, fragmentShaderFilePath);
+	int exitCode = 0;
+	if (benchmarking)
+	{
+		const char* renderPathNames[] = { "\"baked\"", "\"instanced\"", "\"streamed\"" };
+		const char* renderPathName = renderPathNames[static_cast<int>(renderPath)];
+		char startupText[32];
+		std::snprintf(startupText, sizeof(startupText), "%.1f", startupTime.count());
+		bool written = benchmarkRecorder.WriteJson(benchmarkOutputPath, {
+			{ "renderPath", renderPathName },
+			{ "frustumCulling", frustumCulling ? "true" : "false" },
+			{ "portalCulling", portalCulling ? "true" : "false" },
+			{ "occlusionCulling", occlusionCulling ? "true" : "false" },
+			{ "frontToBack", frontToBack ? "true" : "false" },
+			{ "depthPrepass", depthPrepass ? "true" : "false" },
+			{ "shading", deferredShading ? "\"deferred\"" : "\"forward\"" },
+			{ "torches", torches ? "true" : "false" },
+			{ "lightmap", bakedLighting ? "true" : "false" },
+			{ "shadows", shadows ? "true" : "false" },
+			{ "programsFromCache", std::to_string(programBinaryCache.GetLoadedCount()) },
+			{ "programsSavedToCache", std::to_string(programBinaryCache.GetSavedCount()) },
+			{ "startupMs", startupText },
+			{ "mazeSize", std::to_string(mazeSource->GetWidth()) },
+			{ "width", std::to_string(windowWidth) },
+			{ "height", std::to_string(windowHeight) },
+		});
+
+		if (!written)
+		{
+			std::cerr << "Failed to write benchmark results to " << benchmarkOutputPath << std::endl;
+			exitCode = 1;
+		}
+	}
 
-	GLuint program = glCreateProgram();
-	glAttachShader(program, vertexShader);
-	glAttachShader(program, fragmentShader);
+	// --- Cleanup ---
 
-	glLinkProgram(program);
+	// Delete the profiler and overdraw queries, and finish the CSV file
+	profiler.Destroy();
+	overdrawCounter.Destroy();
 
-	glDetachShader(program, vertexShader);
-	glDeleteShader(vertexShader);
-	glDetachShader(program, fragmentShader);
-	glDeleteShader(fragmentShader);
+	// Make sure to delete the shader programs
+	sceneShaders.Destroy();
+	depthShaders.Destroy();
+	frameUniforms.Destroy();
 
-	// Check shader program link status
-	GLint linkStatus;
-	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
-	if (linkStatus != GL_TRUE) {
-		char infoLog[512];
-		GLsizei infoLogLen = sizeof(infoLog);
-		glGetProgramInfoLog(program, infoLogLen, &infoLogLen, infoLog);
-		std::cerr << "program link error: " << infoLog << std::endl;
-	}
+	// Delete the light buffers, the G-buffer, the lightmap and the shadow map
+	clusteredLights.Destroy();
+	deferredRenderer.Destroy();
+	lightmap.Destroy();
+	shadowMap.Destroy();
 
-	return program;
-}
+	// Delete the buffers of the cube mesh
+	cubeMesh.Destroy();
 
-/// <summary>
-/// Creates a shader based on the provided shader type and the path to the file containing the shader source.
-/// </summary>
-/// <param name="shaderType">Shader type</param>
-/// <param name="shaderFilePath">Path to the file containing the shader source</param>
-/// <returns>OpenGL handle to the created shader</returns>
-GLuint CreateShaderFromFile(const GLuint& shaderType, const std::string& shaderFilePath)
-{
-	std::ifstream shaderFile(shaderFilePath);
-	if (shaderFile.fail())
-	{
-		std::cerr << "Unable to open shader file: " << shaderFilePath << std::endl;
-		return 0;
-	}
+	// Delete the occlusion queries
+	occlusionCuller.Destroy();
 
-	std::string shaderSource;
-	std::string temp;
-	while (std::getline(shaderFile, temp))
-	{
-		shaderSource += temp + "\n";
-	}
-	shaderFile.close();
+	// Delete the baked world, the streamed chunks, the vertex array objects and the stream buffer
+	staticWorld.Destroy();
+	worldStreamer.Destroy();
+	instancedRenderer.Destroy();
+	streamBuffer.Destroy();
 
-	return CreateShaderFromSource(shaderType, shaderSource);
-}
+	// Unmap the maze file, which the streamed chunks were read from
+	mappedMaze.Close();
 
-/// <summary>
-/// Creates a shader based on the provided shader type and the string containing the shader source.
-/// </summary>
-/// <param name="shaderType">Shader type</param>
-/// <param name="shaderSource">Shader source string</param>
-/// <returns>OpenGL handle to the created shader</returns>
-GLuint CreateShaderFromSource(const GLuint& shaderType, const std::string& shaderSource)
-{
-	GLuint shader = glCreateShader(shaderType);
+	// Restore the timer resolution changed by the frame pacer
+	framePacer.Destroy();
 
-	const char* shaderSourceCStr = shaderSource.c_str();
-	GLint shaderSourceLen = static_cast<GLint>(shaderSource.length());
-	glShaderSource(shader, 1, &shaderSourceCStr, &shaderSourceLen);
-	glCompileShader(shader);
+	// Stop the worker threads
+	jobSystem.Destroy();
 
-	// Check compilation status
-	GLint compileStatus;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus);
-	if (compileStatus == GL_FALSE)
-	{
-		char infoLog[512];
-		GLsizei infoLogLen = sizeof(infoLog);
-		glGetShaderInfoLog(shader, infoLogLen, &infoLogLen, infoLog);
-		std::cerr << "shader compilation error: " << infoLog << std::endl;
-	}
+	// Remember to tell GLFW to clean itself up before exiting the application
+	glfwTerminate();
 
-	return shader;
+	return exitCode;
 }
-
 /// <summary>
 /// Function for handling the event when the size of the framebuffer changed.
 /// </summary>
@@ -822,24 +1347,27 @@ void FramebufferSizeChangedCallback(GLFWwindow* window, int width, int height)
 	glViewport(0, 0, width, height);
 }
 
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
-// ---------------------------------------------------------------------------------------------------------
+// process all input: query GLFW whether relevant keys are pressed/released this frame and hand them to the simulation
+// ---------------------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    float cameraSpeed = static_cast<float>(globalSpeed * deltaTime);
+    unsigned keys = 0;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        cameraPos += cameraSpeed * cameraFront;
+        keys |= InputKeyForward;
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        cameraPos -= cameraSpeed * cameraFront;
+        keys |= InputKeyBackward;
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        cameraPos -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
+        keys |= InputKeyLeft;
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
-	if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS)
-        cameraPos = glm::vec3(0.0f, 0.0f, 0.0f);		
+        keys |= InputKeyRight;
+    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS)
+        keys |= InputKeyReset;
+
+    inputState.keys = keys;
+    simulation.SubmitInput(inputState);
 }
 
 
@@ -847,48 +1375,15 @@ void processInput(GLFWwindow *window)
 // -------------------------------------------------------
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
-    float xpos = static_cast<float>(xposIn);
-    float ypos = static_cast<float>(yposIn);
-
-    if (firstMouse)
-    {
-        lastX = xpos;
-        lastY = ypos;
-        firstMouse = false;
-    }
-
-    float xoffset = xpos - lastX;
-    float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
-    lastX = xpos;
-    lastY = ypos;
-
-    float sensitivity = 0.1f; // change this value to your liking
-    xoffset *= sensitivity;
-    yoffset *= sensitivity;
-
-    yaw += xoffset;
-    pitch += yoffset;
-
-    // make sure that when pitch is out of bounds, screen doesn't get flipped
-    if (pitch > 89.0f)
-        pitch = 89.0f;
-    if (pitch < -89.0f)
-        pitch = -89.0f;
-
-    glm::vec3 front;
-    front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-    front.y = sin(glm::radians(pitch));
-    front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-    cameraFront = glm::normalize(front);
+    // The simulation turns the camera by how far the cursor moved since the last position it saw
+    inputState.cursorX = xposIn;
+    inputState.cursorY = yposIn;
+    inputState.cursorEventCount++;
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    fov -= (float)yoffset;
-    if (fov < 1.0f)
-        fov = 1.0f;
-    if (fov > 45.0f)
-        fov = 45.0f;
+    inputState.scrollTotal += yoffset;
 }
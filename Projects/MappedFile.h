@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// <summary>
+/// Read-only view of a whole file mapped into memory. The operating system pages the file in
+/// on demand, so opening even a very large file takes constant time and nothing is copied.
+/// </summary>
+class MappedFile
+{
+public:
+	/// <summary>
+	/// Maps a file into memory, unmapping the previous one.
+	/// </summary>
+	/// <param name="filePath">Path of the file</param>
+	/// <returns>True if the file was mapped</returns>
+	bool Open(const std::string& filePath);
+
+	/// <summary>
+	/// Unmaps the file.
+	/// </summary>
+	void Close();
+
+	/// <summary>
+	/// First byte of the file, or nullptr if no file is mapped
+	/// </summary>
+	const unsigned char* GetData() const { return data; }
+
+	/// <summary>
+	/// Size of the file in bytes
+	/// </summary>
+	std::size_t GetSize() const { return size; }
+
+private:
+	const unsigned char* data = nullptr;
+	std::size_t size = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
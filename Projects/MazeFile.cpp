@@ -0,0 +1,94 @@
+#include "MazeFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+/// <summary>
+/// Maps a maze file and checks that its header matches its size.
+/// </summary>
+/// <param name="filePath">Path of the file</param>
+/// <returns>True if the file is a valid maze file</returns>
+bool MappedMaze::Open(const std::string& filePath)
+{
+	Close();
+	if (!file.Open(filePath) || file.GetSize() < sizeof(MazeFileHeader))
+	{
+		file.Close();
+		return false;
+	}
+
+	// The mapping starts on a page boundary, so the header and the words are aligned
+	// as long as the offsets are multiples of 8
+	const MazeFileHeader* header = reinterpret_cast<const MazeFileHeader*>(file.GetData());
+
+	// Cells and walls are counted and indexed with int, so the number of walls along either
+	// axis, which is a little more than the number of cells, must fit in one
+	bool validSize = header->width > 0 && header->depth > 0
+		&& (static_cast<std::uint64_t>(header->width) + 1) * (static_cast<std::uint64_t>(header->depth) + 1)
+			<= static_cast<std::uint64_t>(std::numeric_limits<int>::max());
+	if (!validSize)
+	{
+		file.Close();
+		return false;
+	}
+
+	std::uint64_t xBytes = BitsetMaze::GetXWallWordCount(header->width, header->depth) * sizeof(std::uint64_t);
+	std::uint64_t zBytes = BitsetMaze::GetZWallWordCount(header->width, header->depth) * sizeof(std::uint64_t);
+	bool valid = std::memcmp(header->magic, "MAZE", 4) == 0 && header->version == MazeFileVersion
+		&& header->xWallOffset % 8 == 0 && header->zWallOffset % 8 == 0
+		&& header->xWallOffset >= sizeof(MazeFileHeader) && header->zWallOffset >= sizeof(MazeFileHeader)
+		&& header->xWallOffset + xBytes <= file.GetSize() && header->zWallOffset + zBytes <= file.GetSize();
+	if (!valid)
+	{
+		file.Close();
+		return false;
+	}
+
+	SetSize(static_cast<int>(header->width), static_cast<int>(header->depth));
+	xWallBits = reinterpret_cast<const std::uint64_t*>(file.GetData() + header->xWallOffset);
+	zWallBits = reinterpret_cast<const std::uint64_t*>(file.GetData() + header->zWallOffset);
+	return true;
+}
+
+/// <summary>
+/// Unmaps the file.
+/// </summary>
+void MappedMaze::Close()
+{
+	file.Close();
+	xWallBits = nullptr;
+	zWallBits = nullptr;
+	width = depth = 0;
+}
+
+/// <summary>
+/// Writes a maze to a file that MappedMaze can open.
+/// </summary>
+/// <param name="maze">Maze to write</param>
+/// <param name="filePath">Path of the file</param>
+/// <returns>True if the file was written</returns>
+bool SaveMazeFile(const BitsetMaze& maze, const std::string& filePath)
+{
+	std::ofstream output(filePath, std::ios::binary);
+	if (output.fail())
+	{
+		return false;
+	}
+
+	std::size_t xWordCount = BitsetMaze::GetXWallWordCount(maze.GetWidth(), maze.GetDepth());
+	std::size_t zWordCount = BitsetMaze::GetZWallWordCount(maze.GetWidth(), maze.GetDepth());
+
+	MazeFileHeader header;
+	std::memcpy(header.magic, "MAZE", 4);
+	header.version = MazeFileVersion;
+	header.width = static_cast<std::uint32_t>(maze.GetWidth());
+	header.depth = static_cast<std::uint32_t>(maze.GetDepth());
+	header.xWallOffset = sizeof(MazeFileHeader);
+	header.zWallOffset = header.xWallOffset + xWordCount * sizeof(std::uint64_t);
+
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(maze.GetXWallBits()), xWordCount * sizeof(std::uint64_t));
+	output.write(reinterpret_cast<const char*>(maze.GetZWallBits()), zWordCount * sizeof(std::uint64_t));
+	return static_cast<bool>(output);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.h"
+#include "MazeSource.h"
+
+/// <summary>
+/// Version written to and expected in the header of a maze file
+/// </summary>
+const std::uint32_t MazeFileVersion = 1;
+
+/// <summary>
+/// Header at the start of a maze file. The header is followed by the two wall bitsets of a
+/// BitsetMaze, stored as little-endian 64-bit words at the offsets given in the header, so a
+/// mapped file can be read in place without any parsing.
+/// </summary>
+struct MazeFileHeader
+{
+	char magic[4];					// "MAZE"
+	std::uint32_t version;			// MazeFileVersion
+	std::uint32_t width;			// Cells along the x-axis
+	std::uint32_t depth;			// Cells along the z-axis
+	std::uint64_t xWallOffset;		// Byte offset of the bitset of the edges of constant x
+	std::uint64_t zWallOffset;		// Byte offset of the bitset of the edges of constant z
+};
+
+static_assert(sizeof(MazeFileHeader) == 32, "MazeFileHeader must match the file layout");
+
+/// <summary>
+/// Bitset maze read straight from a memory-mapped maze file. Opening the file only checks the
+/// header, and the pages holding the walls are only read once tiles are gathered from them,
+/// so opening takes the same time whatever the size of the maze.
+/// </summary>
+class MappedMaze : public BitsetMaze
+{
+public:
+	/// <summary>
+	/// Maps a maze file and checks that its header matches its size.
+	/// </summary>
+	/// <param name="filePath">Path of the file</param>
+	/// <returns>True if the file is a valid maze file</returns>
+	bool Open(const std::string& filePath);
+
+	/// <summary>
+	/// Unmaps the file.
+	/// </summary>
+	void Close();
+
+private:
+	MappedFile file;
+};
+
+/// <summary>
+/// Writes a maze to a file that MappedMaze can open.
+/// </summary>
+/// <param name="maze">Maze to write</param>
+/// <param name="filePath">Path of the file</param>
+/// <returns>True if the file was written</returns>
+bool SaveMazeFile(const BitsetMaze& maze, const std::string& filePath);
@@ -0,0 +1,481 @@
+#include "MazeGenerator.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+	/// <summary>
+	/// Small, fast random number generator (SplitMix64 by Sebastiano Vigna), used instead of
+	/// the standard distributions so that a seed gives the same maze on every platform.
+	/// </summary>
+	class Random
+	{
+	public:
+		explicit Random(std::uint64_t seed) : state(seed) {}
+
+		/// <summary>
+		/// Generates the next 64 random bits.
+		/// </summary>
+		/// <returns>Random bits</returns>
+		std::uint64_t Next()
+		{
+			std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		/// <summary>
+		/// Generates a random number below a bound, by scaling instead of dividing.
+		/// </summary>
+		/// <param name="bound">One past the largest number</param>
+		/// <returns>Random number from 0 to bound - 1</returns>
+		std::uint32_t Below(std::uint32_t bound)
+		{
+			return static_cast<std::uint32_t>(((Next() >> 32) * bound) >> 32);
+		}
+
+	private:
+		std::uint64_t state;
+	};
+
+	/// <summary>
+	/// Rectangle of cells generated on its own
+	/// </summary>
+	struct Region
+	{
+		int x0, z0;			// First cell
+		int width, depth;	// Number of cells
+	};
+
+	/// <summary>
+	/// Working memory of the algorithms, kept between the regions generated by one thread
+	/// </summary>
+	struct RegionScratch
+	{
+		std::vector<std::uint32_t> cells;	// Edges to visit, parents in the union-find or stack of cells
+		std::vector<std::uint32_t> parents;
+		std::vector<std::uint8_t> marks;	// Visited flags, ranks or walk directions
+	};
+
+	// Directions from a cell to its neighbours, and the steps they take along each axis
+	const int PositiveX = 0;
+	const int NegativeX = 1;
+	const int PositiveZ = 2;
+	const int NegativeZ = 3;
+	const int StepX[4] = { 1, -1, 0, 0 };
+	const int StepZ[4] = { 0, 0, 1, -1 };
+
+	/// <summary>
+	/// Checks whether the neighbour of a cell is inside its region.
+	/// </summary>
+	/// <param name="region">Region of the cell</param>
+	/// <param name="x">Column of the cell in the region</param>
+	/// <param name="z">Row of the cell in the region</param>
+	/// <param name="direction">Direction of the neighbour</param>
+	/// <returns>True if the neighbour is inside the region</returns>
+	bool HasNeighbour(const Region& region, int x, int z, int direction)
+	{
+		x += StepX[direction];
+		z += StepZ[direction];
+		return x >= 0 && x < region.width && z >= 0 && z < region.depth;
+	}
+
+	/// <summary>
+	/// Removes the wall between a cell of a region and one of its neighbours.
+	/// </summary>
+	/// <param name="maze">Grid of the maze</param>
+	/// <param name="region">Region of the cell</param>
+	/// <param name="x">Column of the cell in the region</param>
+	/// <param name="z">Row of the cell in the region</param>
+	/// <param name="direction">Direction of the neighbour</param>
+	void OpenWall(WallGrid& maze, const Region& region, int x, int z, int direction)
+	{
+		x += region.x0;
+		z += region.z0;
+		switch (direction)
+		{
+		case PositiveX:
+			maze.SetXWall(x + 1, z, false);
+			break;
+		case NegativeX:
+			maze.SetXWall(x, z, false);
+			break;
+		case PositiveZ:
+			maze.SetZWall(x, z + 1, false);
+			break;
+		default:
+			maze.SetZWall(x, z, false);
+			break;
+		}
+	}
+
+	/// <summary>
+	/// Finds the root of the set containing an element, halving the path to it on the way.
+	/// </summary>
+	/// <param name="parents">Parent of each element, roots being their own parent</param>
+	/// <param name="element">Element</param>
+	/// <returns>Root of the set</returns>
+	std::uint32_t FindRoot(std::vector<std::uint32_t>& parents, std::uint32_t element)
+	{
+		while (parents[element] != element)
+		{
+			parents[element] = parents[parents[element]];
+			element = parents[element];
+		}
+		return element;
+	}
+
+	/// <summary>
+	/// Merges the sets of two elements, unless they are already the same set.
+	/// </summary>
+	/// <param name="parents">Parent of each element</param>
+	/// <param name="ranks">Upper bound of the height of each set</param>
+	/// <param name="a">First element</param>
+	/// <param name="b">Second element</param>
+	/// <returns>True if the sets were different</returns>
+	bool Unite(std::vector<std::uint32_t>& parents, std::vector<std::uint8_t>& ranks, std::uint32_t a, std::uint32_t b)
+	{
+		a = FindRoot(parents, a);
+		b = FindRoot(parents, b);
+		if (a == b)
+		{
+			return false;
+		}
+		if (ranks[a] < ranks[b])
+		{
+			std::swap(a, b);
+		}
+		parents[b] = a;
+		if (ranks[a] == ranks[b])
+		{
+			ranks[a]++;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Shuffles a list (Fisher-Yates).
+	/// </summary>
+	/// <param name="values">List to shuffle</param>
+	/// <param name="random">Random sequence</param>
+	void Shuffle(std::vector<std::uint32_t>& values, Random& random)
+	{
+		for (std::size_t i = values.size(); i > 1; i--)
+		{
+			std::swap(values[i - 1], values[random.Below(static_cast<std::uint32_t>(i))]);
+		}
+	}
+
+	/// <summary>
+	/// Generates a region with Kruskal's algorithm: every inner wall is visited in random
+	/// order, and opened if the cells on its sides are not connected yet.
+	/// </summary>
+	void GenerateKruskal(WallGrid& maze, const Region& region, Random& random, RegionScratch& scratch)
+	{
+		std::uint32_t cellCount = static_cast<std::uint32_t>(region.width * region.depth);
+
+		// Each wall is the positive x or z side of a cell, packed as cell * 2 + side
+		std::vector<std::uint32_t>& walls = scratch.cells;
+		walls.clear();
+		for (int z = 0; z < region.depth; z++)
+		{
+			for (int x = 0; x < region.width; x++)
+			{
+				std::uint32_t cell = static_cast<std::uint32_t>(z * region.width + x);
+				if (x + 1 < region.width)
+				{
+					walls.push_back(cell * 2);
+				}
+				if (z + 1 < region.depth)
+				{
+					walls.push_back(cell * 2 + 1);
+				}
+			}
+		}
+		Shuffle(walls, random);
+
+		scratch.parents.resize(cellCount);
+		std::iota(scratch.parents.begin(), scratch.parents.end(), 0u);
+		scratch.marks.assign(cellCount, 0);
+
+		// A spanning tree is complete once it has one edge less than it has cells
+		std::uint32_t openedCount = 0;
+		for (std::size_t i = 0; i < walls.size() && openedCount + 1 < cellCount; i++)
+		{
+			std::uint32_t cell = walls[i] / 2;
+			bool alongX = walls[i] % 2 == 0;
+			std::uint32_t neighbour = alongX ? cell + 1 : cell + region.width;
+			if (Unite(scratch.parents, scratch.marks, cell, neighbour))
+			{
+				int x = static_cast<int>(cell % region.width);
+				int z = static_cast<int>(cell / region.width);
+				OpenWall(maze, region, x, z, alongX ? PositiveX : PositiveZ);
+				openedCount++;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Generates a region with the recursive backtracker: a path is carved from a random cell
+	/// into random unvisited neighbours, backing up along the path whenever it gets stuck.
+	/// The recursion is replaced by an explicit stack of cells, packed as z * width + x.
+	/// </summary>
+	void GenerateBacktracker(WallGrid& maze, const Region& region, Random& random, RegionScratch& scratch)
+	{
+		std::uint32_t cellCount = static_cast<std::uint32_t>(region.width * region.depth);
+		std::vector<std::uint8_t>& visited = scratch.marks;
+		visited.assign(cellCount, 0);
+		std::vector<std::uint32_t>& stack = scratch.cells;
+		stack.clear();
+
+		std::uint32_t start = random.Below(cellCount);
+		visited[start] = 1;
+		stack.push_back(start);
+		while (!stack.empty())
+		{
+			int x = static_cast<int>(stack.back() % region.width);
+			int z = static_cast<int>(stack.back() / region.width);
+			int directions[4];
+			int count = 0;
+			for (int direction = 0; direction < 4; direction++)
+			{
+				if (HasNeighbour(region, x, z, direction)
+					&& !visited[(z + StepZ[direction]) * region.width + x + StepX[direction]])
+				{
+					directions[count++] = direction;
+				}
+			}
+
+			if (count == 0)
+			{
+				stack.pop_back();
+				continue;
+			}
+
+			int direction = directions[random.Below(static_cast<std::uint32_t>(count))];
+			OpenWall(maze, region, x, z, direction);
+			std::uint32_t neighbour = static_cast<std::uint32_t>((z + StepZ[direction]) * region.width + x + StepX[direction]);
+			visited[neighbour] = 1;
+			stack.push_back(neighbour);
+		}
+	}
+
+	/// <summary>
+	/// Generates a region with Wilson's algorithm: starting from a single cell, random walks
+	/// from the cells that are not in the maze yet are added to it once they reach it, with
+	/// their loops erased. Unlike the other algorithms, every perfect maze is equally likely.
+	/// </summary>
+	void GenerateWilson(WallGrid& maze, const Region& region, Random& random, RegionScratch& scratch)
+	{
+		std::uint32_t cellCount = static_cast<std::uint32_t>(region.width * region.depth);
+
+		// Cells in the maze are marked with 4; the others hold the direction the last walk left them in,
+		// so a walk that crosses itself simply overwrites the loop
+		const std::uint8_t InMaze = 4;
+		std::vector<std::uint8_t>& marks = scratch.marks;
+		marks.assign(cellCount, 0);
+		marks[random.Below(cellCount)] = InMaze;
+
+		// Walks start from the cells in memory order, so the maze grows through the region row by row
+		for (int startZ = 0; startZ < region.depth; startZ++)
+		{
+			for (int startX = 0; startX < region.width; startX++)
+			{
+				int x = startX, z = startZ;
+				std::uint32_t cell = static_cast<std::uint32_t>(z * region.width + x);
+				while (marks[cell] != InMaze)
+				{
+					int direction;
+					do
+					{
+						direction = static_cast<int>(random.Below(4));
+					} while (!HasNeighbour(region, x, z, direction));
+					marks[cell] = static_cast<std::uint8_t>(direction);
+					x += StepX[direction];
+					z += StepZ[direction];
+					cell = static_cast<std::uint32_t>(z * region.width + x);
+				}
+
+				x = startX;
+				z = startZ;
+				cell = static_cast<std::uint32_t>(z * region.width + x);
+				while (marks[cell] != InMaze)
+				{
+					int direction = marks[cell];
+					marks[cell] = InMaze;
+					OpenWall(maze, region, x, z, direction);
+					x += StepX[direction];
+					z += StepZ[direction];
+					cell = static_cast<std::uint32_t>(z * region.width + x);
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Generates a region with an algorithm.
+	/// </summary>
+	void GenerateRegion(WallGrid& maze, const Region& region, MazeAlgorithm algorithm, Random& random, RegionScratch& scratch)
+	{
+		switch (algorithm)
+		{
+		case MazeAlgorithm::Kruskal:
+			GenerateKruskal(maze, region, random, scratch);
+			break;
+		case MazeAlgorithm::Backtracker:
+			GenerateBacktracker(maze, region, random, scratch);
+			break;
+		case MazeAlgorithm::Wilson:
+			GenerateWilson(maze, region, random, scratch);
+			break;
+		}
+	}
+
+	/// <summary>
+	/// Derives the seed of one of the random sequences of a maze.
+	/// </summary>
+	/// <param name="seed">Seed of the maze</param>
+	/// <param name="stream">Index of the sequence</param>
+	/// <returns>Seed of the sequence</returns>
+	std::uint64_t GetStreamSeed(std::uint32_t seed, std::uint64_t stream)
+	{
+		return Random((static_cast<std::uint64_t>(seed) << 32) ^ stream).Next();
+	}
+}
+
+/// <summary>
+/// Generates a perfect maze into a wall grid. The maze is split into square regions that are
+/// generated separately, each with scratch data small enough to stay in the cache, then joined
+/// by opening one wall between the regions along a random spanning tree. Every region has its
+/// own random sequence, derived from the seed and its position, so the maze only depends on the
+/// seed and the region size, whether or not the regions are generated in parallel.
+/// </summary>
+/// <param name="maze">Grid that receives the maze</param>
+/// <param name="width">Number of cells along the x-axis</param>
+/// <param name="depth">Number of cells along the z-axis</param>
+/// <param name="algorithm">Algorithm generating each region</param>
+/// <param name="seed">Seed of the random sequences</param>
+/// <param name="jobs">Job system generating the regions in parallel, or nullptr to generate them on this thread</param>
+/// <param name="regionSize">Number of cells along each side of a region, or 0 to generate the whole maze as one region</param>
+void GenerateMaze(WallGrid& maze, int width, int depth, MazeAlgorithm algorithm, std::uint32_t seed, JobSystem* jobs, int regionSize)
+{
+	maze.Create(width, depth, true);
+
+	// Walls are packed as cell * 2 + side in 32 bits, which limits the cells of a region
+	if (regionSize <= 0)
+	{
+		regionSize = std::max(width, depth);
+	}
+	regionSize = std::min(regionSize, 32768);
+	int regionColumns = (width + regionSize - 1) / regionSize;
+	int regionRows = (depth + regionSize - 1) / regionSize;
+
+	auto generateRow = [&](int row)
+	{
+		RegionScratch scratch;
+		for (int column = 0; column < regionColumns; column++)
+		{
+			Region region;
+			region.x0 = column * regionSize;
+			region.z0 = row * regionSize;
+			region.width = std::min(regionSize, width - region.x0);
+			region.depth = std::min(regionSize, depth - region.z0);
+			Random random(GetStreamSeed(seed, static_cast<std::uint64_t>(row) * regionColumns + column + 1));
+			GenerateRegion(maze, region, algorithm, random, scratch);
+		}
+	};
+
+	// Neighbouring regions share words of the bitsets, so rows of regions are generated in two
+	// passes, even rows then odd rows. Rows of the same pass are at least a row of regions apart,
+	// which is at least 64 bits as long as a row of regions has 64 cells.
+	if (jobs != nullptr && static_cast<long long>(regionSize) * width >= 64)
+	{
+		for (int parity = 0; parity < 2; parity++)
+		{
+			std::size_t rowCount = static_cast<std::size_t>((regionRows - parity + 1) / 2);
+			jobs->ParallelFor(rowCount, 1, [&](std::size_t begin, std::size_t end)
+			{
+				for (std::size_t i = begin; i < end; i++)
+				{
+					generateRow(parity + static_cast<int>(i) * 2);
+				}
+			});
+		}
+	}
+	else
+	{
+		for (int row = 0; row < regionRows; row++)
+		{
+			generateRow(row);
+		}
+	}
+
+	// Join the regions along a random spanning tree of the grid of regions, through one
+	// random wall on the side they share, so the whole maze stays perfect
+	Random random(GetStreamSeed(seed, 0));
+	std::uint32_t regionCount = static_cast<std::uint32_t>(regionColumns * regionRows);
+	RegionScratch scratch;
+	for (int row = 0; row < regionRows; row++)
+	{
+		for (int column = 0; column < regionColumns; column++)
+		{
+			std::uint32_t region = static_cast<std::uint32_t>(row * regionColumns + column);
+			if (column + 1 < regionColumns)
+			{
+				scratch.cells.push_back(region * 2);
+			}
+			if (row + 1 < regionRows)
+			{
+				scratch.cells.push_back(region * 2 + 1);
+			}
+		}
+	}
+	Shuffle(scratch.cells, random);
+	scratch.parents.resize(regionCount);
+	std::iota(scratch.parents.begin(), scratch.parents.end(), 0u);
+	scratch.marks.assign(regionCount, 0);
+	for (std::uint32_t side : scratch.cells)
+	{
+		std::uint32_t region = side / 2;
+		bool alongX = side % 2 == 0;
+		if (!Unite(scratch.parents, scratch.marks, region, alongX ? region + 1 : region + regionColumns))
+		{
+			continue;
+		}
+
+		int x0 = static_cast<int>(region % regionColumns) * regionSize;
+		int z0 = static_cast<int>(region / regionColumns) * regionSize;
+		if (alongX)
+		{
+			int length = std::min(regionSize, depth - z0);
+			maze.SetXWall(x0 + regionSize, z0 + static_cast<int>(random.Below(static_cast<std::uint32_t>(length))), false);
+		}
+		else
+		{
+			int length = std::min(regionSize, width - x0);
+			maze.SetZWall(x0 + static_cast<int>(random.Below(static_cast<std::uint32_t>(length))), z0 + regionSize, false);
+		}
+	}
+}
+
+/// <summary>
+/// Finds the name of an algorithm, as used on the command line.
+/// </summary>
+/// <param name="algorithm">Algorithm</param>
+/// <returns>Lowercase name of the algorithm</returns>
+const char* GetMazeAlgorithmName(MazeAlgorithm algorithm)
+{
+	switch (algorithm)
+	{
+	case MazeAlgorithm::Kruskal:
+		return "kruskal";
+	case MazeAlgorithm::Backtracker:
+		return "backtracker";
+	case MazeAlgorithm::Wilson:
+		return "wilson";
+	}
+	return "";
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+#include "JobSystem.h"
+#include "MazeSource.h"
+
+/// <summary>
+/// Algorithms that can generate a perfect maze, where every cell can be reached from every
+/// other cell by exactly one path
+/// </summary>
+enum class MazeAlgorithm
+{
+	Kruskal,		// Opens the walls in random order, skipping those between cells that are already connected
+	Backtracker,	// Carves a random path until it reaches a dead end, then backs up to the last cell with unvisited neighbours
+	Wilson,			// Adds loop-erased random walks to the maze until they cover every cell
+};
+
+/// <summary>
+/// Number of cells along each side of the regions generated on their own
+/// </summary>
+const int DefaultMazeRegionSize = 256;
+
+/// <summary>
+/// Generates a perfect maze into a wall grid. The maze is split into square regions that are
+/// generated separately, each with scratch data small enough to stay in the cache, then joined
+/// by opening one wall between the regions along a random spanning tree. Every region has its
+/// own random sequence, derived from the seed and its position, so the maze only depends on the
+/// seed and the region size, whether or not the regions are generated in parallel.
+/// </summary>
+/// <param name="maze">Grid that receives the maze</param>
+/// <param name="width">Number of cells along the x-axis</param>
+/// <param name="depth">Number of cells along the z-axis</param>
+/// <param name="algorithm">Algorithm generating each region</param>
+/// <param name="seed">Seed of the random sequences</param>
+/// <param name="jobs">Job system generating the regions in parallel, or nullptr to generate them on this thread</param>
+/// <param name="regionSize">Number of cells along each side of a region, or 0 to generate the whole maze as one region</param>
+void GenerateMaze(WallGrid& maze, int width, int depth, MazeAlgorithm algorithm, std::uint32_t seed, JobSystem* jobs = nullptr, int regionSize = DefaultMazeRegionSize);
+
+/// <summary>
+/// Finds the name of an algorithm, as used on the command line.
+/// </summary>
+/// <param name="algorithm">Algorithm</param>
+/// <returns>Lowercase name of the algorithm</returns>
+const char* GetMazeAlgorithmName(MazeAlgorithm algorithm);
@@ -0,0 +1,208 @@
+#include "MazeSource.h"
+
+/// <summary>
+/// Computes the world-space bounding box of a rectangle of cells.
+/// </summary>
+/// <param name="x0">First column</param>
+/// <param name="z0">First row</param>
+/// <param name="x1">One past the last column</param>
+/// <param name="z1">One past the last row</param>
+/// <param name="boxMin">Receives the minimum corner</param>
+/// <param name="boxMax">Receives the maximum corner</param>
+void MazeSource::GetBounds(int x0, int z0, int x1, int z1, glm::vec3& boxMin, glm::vec3& boxMax) const
+{
+	boxMin = origin + glm::vec3(x0 * CellGrid::CellSize, 0.0f, z0 * CellGrid::CellSize);
+	boxMax = origin + glm::vec3(x1 * CellGrid::CellSize, height, z1 * CellGrid::CellSize);
+}
+
+/// <summary>
+/// Finds the cell containing a position, as fractional cell coordinates that may be
+/// outside of the maze.
+/// </summary>
+/// <param name="position">World-space position</param>
+/// <returns>Column and row of the position, in cell units</returns>
+glm::vec2 MazeSource::GetCellCoordinates(const glm::vec3& position) const
+{
+	return glm::vec2(position.x - origin.x, position.z - origin.z) / CellGrid::CellSize;
+}
+
+/// <summary>
+/// Sets the number of cells, and places the maze so that the cell with the largest
+/// coordinates is centered on the origin, like the hand-made maze.
+/// </summary>
+/// <param name="mazeWidth">Number of cells along the x-axis</param>
+/// <param name="mazeDepth">Number of cells along the z-axis</param>
+void MazeSource::SetSize(int mazeWidth, int mazeDepth)
+{
+	width = mazeWidth;
+	depth = mazeDepth;
+	height = CellGrid::CellSize;
+	origin = glm::vec3(-(width - 0.5f) * CellGrid::CellSize, -0.5f * CellGrid::CellSize, -(depth - 0.5f) * CellGrid::CellSize);
+}
+
+/// <summary>
+/// Appends the tiles of a rectangle of cells to a list.
+/// </summary>
+/// <param name="x0">First column</param>
+/// <param name="z0">First row</param>
+/// <param name="x1">One past the last column</param>
+/// <param name="z1">One past the last row</param>
+/// <param name="tiles">List the tiles are appended to</param>
+void BitsetMaze::GatherTiles(int x0, int z0, int x1, int z1, std::vector<Tile>& tiles) const
+{
+	// Walls are one-sided faces. Every cell owns the walls on its positive sides, and the
+	// first column and row also own the outer walls on their negative sides.
+	float halfCell = CellGrid::CellSize * 0.5f;
+	for (int z = z0; z < z1; z++)
+	{
+		for (int x = x0; x < x1; x++)
+		{
+			glm::vec3 position = origin + glm::vec3((x + 0.5f) * CellGrid::CellSize, halfCell, (z + 0.5f) * CellGrid::CellSize);
+			tiles.push_back({ position, TileFace::Floor });
+
+			if (x == 0 && HasXWall(0, z))
+			{
+				tiles.push_back({ position, TileFace::Left });
+			}
+			if (HasXWall(x + 1, z))
+			{
+				tiles.push_back({ position, TileFace::Right });
+			}
+			if (z == 0 && HasZWall(x, 0))
+			{
+				tiles.push_back({ position, TileFace::Back });
+			}
+			if (HasZWall(x, z + 1))
+			{
+				tiles.push_back({ position, TileFace::Front });
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Allocates the bitsets.
+/// </summary>
+/// <param name="mazeWidth">Number of cells along the x-axis</param>
+/// <param name="mazeDepth">Number of cells along the z-axis</param>
+/// <param name="closed">True to start with a wall on every edge, false to start with none</param>
+void WallGrid::Create(int mazeWidth, int mazeDepth, bool closed)
+{
+	SetSize(mazeWidth, mazeDepth);
+
+	// The unused bits of the last words stay clear, so saved files do not depend on how the grid was made
+	std::uint64_t fill = closed ? ~std::uint64_t(0) : 0;
+	xWords.assign(GetXWallWordCount(width, depth), fill);
+	zWords.assign(GetZWallWordCount(width, depth), fill);
+	std::size_t xBits = static_cast<std::size_t>(width + 1) * depth;
+	std::size_t zBits = static_cast<std::size_t>(width) * (depth + 1);
+	if (closed && xBits % 64 != 0)
+	{
+		xWords.back() = (std::uint64_t(1) << (xBits % 64)) - 1;
+	}
+	if (closed && zBits % 64 != 0)
+	{
+		zWords.back() = (std::uint64_t(1) << (zBits % 64)) - 1;
+	}
+
+	xWallBits = xWords.data();
+	zWallBits = zWords.data();
+}
+
+/// <summary>
+/// Adds or removes the wall on an edge of constant x.
+/// </summary>
+/// <param name="x">Column of the edge, from 0 to the width</param>
+/// <param name="z">Row of the edge</param>
+/// <param name="wall">True to add a wall</param>
+void WallGrid::SetXWall(int x, int z, bool wall)
+{
+	std::size_t bit = static_cast<std::size_t>(z) * (width + 1) + x;
+	std::uint64_t mask = std::uint64_t(1) << (bit % 64);
+	xWords[bit / 64] = wall ? xWords[bit / 64] | mask : xWords[bit / 64] & ~mask;
+}
+
+/// <summary>
+/// Adds or removes the wall on an edge of constant z.
+/// </summary>
+/// <param name="x">Column of the edge</param>
+/// <param name="z">Row of the edge, from 0 to the depth</param>
+/// <param name="wall">True to add a wall</param>
+void WallGrid::SetZWall(int x, int z, bool wall)
+{
+	std::size_t bit = static_cast<std::size_t>(z) * width + x;
+	std::uint64_t mask = std::uint64_t(1) << (bit % 64);
+	zWords[bit / 64] = wall ? zWords[bit / 64] | mask : zWords[bit / 64] & ~mask;
+}
+
+/// <summary>
+/// Sets the size of the maze.
+/// </summary>
+/// <param name="mazeWidth">Number of cells along the x-axis</param>
+/// <param name="mazeDepth">Number of cells along the z-axis</param>
+/// <param name="mazeSeed">Seed of the hash, so that each seed gives a different maze</param>
+void BinaryTreeMaze::Create(int mazeWidth, int mazeDepth, std::uint32_t mazeSeed)
+{
+	SetSize(mazeWidth, mazeDepth);
+	seed = mazeSeed;
+}
+
+/// <summary>
+/// Appends the tiles of a rectangle of cells to a list.
+/// </summary>
+/// <param name="x0">First column</param>
+/// <param name="z0">First row</param>
+/// <param name="x1">One past the last column</param>
+/// <param name="z1">One past the last row</param>
+/// <param name="tiles">List the tiles are appended to</param>
+void BinaryTreeMaze::GatherTiles(int x0, int z0, int x1, int z1, std::vector<Tile>& tiles) const
+{
+	float halfCell = CellGrid::CellSize * 0.5f;
+	for (int z = z0; z < z1; z++)
+	{
+		for (int x = x0; x < x1; x++)
+		{
+			glm::vec3 position = origin + glm::vec3((x + 0.5f) * CellGrid::CellSize, halfCell, (z + 0.5f) * CellGrid::CellSize);
+			tiles.push_back({ position, TileFace::Floor });
+
+			// Each cell owns the walls on its positive sides, plus the outer walls on its negative sides
+			bool lastColumn = x == width - 1;
+			bool lastRow = z == depth - 1;
+			bool alongX = !lastColumn && (lastRow || OpensAlongX(x, z));
+			if (x == 0)
+			{
+				tiles.push_back({ position, TileFace::Left });
+			}
+			if (z == 0)
+			{
+				tiles.push_back({ position, TileFace::Back });
+			}
+			if (!alongX)
+			{
+				tiles.push_back({ position, TileFace::Right });
+			}
+			if (alongX || lastRow)
+			{
+				tiles.push_back({ position, TileFace::Front });
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Checks whether a cell opens its passage along the x-axis rather than the z-axis.
+/// </summary>
+/// <param name="x">Column of the cell</param>
+/// <param name="z">Row of the cell</param>
+/// <returns>True if the wall on the positive x side of the cell is open</returns>
+bool BinaryTreeMaze::OpensAlongX(int x, int z) const
+{
+	// Integer hash of the coordinates (lowbias32 by Chris Wellons)
+	std::uint32_t hash = seed ^ (static_cast<std::uint32_t>(x) * 0x9E3779B9u) ^ (static_cast<std::uint32_t>(z) * 0x85EBCA6Bu);
+	hash ^= hash >> 16;
+	hash *= 0x7FEB352Du;
+	hash ^= hash >> 15;
+	hash *= 0x846CA68Bu;
+	hash ^= hash >> 16;
+	return (hash & 1) != 0;
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "CellGrid.h"
+#include "Scene.h"
+
+/// <summary>
+/// Provides the tiles of any rectangle of cells of a maze, so that a maze far too large to
+/// keep in memory as tiles can be built one piece at a time. The cells form a grid of 2-unit
+/// squares starting at a world-space origin, like the cells of a CellGrid. Every tile belongs
+/// to the cell that contains its position.
+/// </summary>
+class MazeSource
+{
+public:
+	virtual ~MazeSource() = default;
+
+	/// <summary>
+	/// Appends the tiles of a rectangle of cells to a list. Safe to call from several
+	/// threads at once.
+	/// </summary>
+	/// <param name="x0">First column</param>
+	/// <param name="z0">First row</param>
+	/// <param name="x1">One past the last column</param>
+	/// <param name="z1">One past the last row</param>
+	/// <param name="tiles">List the tiles are appended to</param>
+	virtual void GatherTiles(int x0, int z0, int x1, int z1, std::vector<Tile>& tiles) const = 0;
+
+	/// <summary>
+	/// Number of cells along the x-axis
+	/// </summary>
+	int GetWidth() const { return width; }
+
+	/// <summary>
+	/// Number of cells along the z-axis
+	/// </summary>
+	int GetDepth() const { return depth; }
+
+	/// <summary>
+	/// Computes the world-space bounding box of a rectangle of cells.
+	/// </summary>
+	/// <param name="x0">First column</param>
+	/// <param name="z0">First row</param>
+	/// <param name="x1">One past the last column</param>
+	/// <param name="z1">One past the last row</param>
+	/// <param name="boxMin">Receives the minimum corner</param>
+	/// <param name="boxMax">Receives the maximum corner</param>
+	void GetBounds(int x0, int z0, int x1, int z1, glm::vec3& boxMin, glm::vec3& boxMax) const;
+
+	/// <summary>
+	/// Finds the cell containing a position, as fractional cell coordinates that may be
+	/// outside of the maze.
+	/// </summary>
+	/// <param name="position">World-space position</param>
+	/// <returns>Column and row of the position, in cell units</returns>
+	glm::vec2 GetCellCoordinates(const glm::vec3& position) const;
+
+protected:
+	/// <summary>
+	/// Sets the number of cells, and places the maze so that the cell with the largest
+	/// coordinates is centered on the origin, like the hand-made maze.
+	/// </summary>
+	/// <param name="mazeWidth">Number of cells along the x-axis</param>
+	/// <param name="mazeDepth">Number of cells along the z-axis</param>
+	void SetSize(int mazeWidth, int mazeDepth);
+
+	glm::vec3 origin = glm::vec3(0.0f);	// Minimum corner of the first cell
+	float height = CellGrid::CellSize;	// Height of the walls
+	int width = 0, depth = 0;
+};
+
+/// <summary>
+/// Maze stored as two bitsets: one bit per cell edge of constant x, (width + 1) per row,
+/// and one bit per cell edge of constant z, width per row and (depth + 1) rows. A set bit
+/// is a wall. Every cell has a floor. Each bitset is packed into 64-bit words, starting
+/// from the lowest bit of the first word.
+/// </summary>
+class BitsetMaze : public MazeSource
+{
+public:
+	/// <summary>
+	/// Checks whether there is a wall on an edge of constant x.
+	/// </summary>
+	/// <param name="x">Column of the edge, from 0 to the width; edge x is the negative x side of cell x</param>
+	/// <param name="z">Row of the edge</param>
+	/// <returns>True if the edge is a wall</returns>
+	bool HasXWall(int x, int z) const
+	{
+		std::size_t bit = static_cast<std::size_t>(z) * (width + 1) + x;
+		return (xWallBits[bit / 64] >> (bit % 64)) & 1;
+	}
+
+	/// <summary>
+	/// Checks whether there is a wall on an edge of constant z.
+	/// </summary>
+	/// <param name="x">Column of the edge</param>
+	/// <param name="z">Row of the edge, from 0 to the depth; edge z is the negative z side of cell z</param>
+	/// <returns>True if the edge is a wall</returns>
+	bool HasZWall(int x, int z) const
+	{
+		std::size_t bit = static_cast<std::size_t>(z) * width + x;
+		return (zWallBits[bit / 64] >> (bit % 64)) & 1;
+	}
+
+	void GatherTiles(int x0, int z0, int x1, int z1, std::vector<Tile>& tiles) const override;
+
+	/// <summary>
+	/// Words of the bitset of the edges of constant x
+	/// </summary>
+	const std::uint64_t* GetXWallBits() const { return xWallBits; }
+
+	/// <summary>
+	/// Words of the bitset of the edges of constant z
+	/// </summary>
+	const std::uint64_t* GetZWallBits() const { return zWallBits; }
+
+	/// <summary>
+	/// Number of 64-bit words of the bitset of the edges of constant x
+	/// </summary>
+	static std::size_t GetXWallWordCount(int mazeWidth, int mazeDepth) { return (static_cast<std::size_t>(mazeWidth + 1) * mazeDepth + 63) / 64; }
+
+	/// <summary>
+	/// Number of 64-bit words of the bitset of the edges of constant z
+	/// </summary>
+	static std::size_t GetZWallWordCount(int mazeWidth, int mazeDepth) { return (static_cast<std::size_t>(mazeWidth) * (mazeDepth + 1) + 63) / 64; }
+
+protected:
+	const std::uint64_t* xWallBits = nullptr;
+	const std::uint64_t* zWallBits = nullptr;
+};
+
+/// <summary>
+/// Bitset maze held in memory, which can be edited.
+/// </summary>
+class WallGrid : public BitsetMaze
+{
+public:
+	WallGrid() = default;
+	WallGrid(const WallGrid&) = delete;
+	WallGrid& operator=(const WallGrid&) = delete;
+
+	/// <summary>
+	/// Allocates the bitsets.
+	/// </summary>
+	/// <param name="mazeWidth">Number of cells along the x-axis</param>
+	/// <param name="mazeDepth">Number of cells along the z-axis</param>
+	/// <param name="closed">True to start with a wall on every edge, false to start with none</param>
+	void Create(int mazeWidth, int mazeDepth, bool closed);
+
+	/// <summary>
+	/// Adds or removes the wall on an edge of constant x.
+	/// </summary>
+	/// <param name="x">Column of the edge, from 0 to the width</param>
+	/// <param name="z">Row of the edge</param>
+	/// <param name="wall">True to add a wall</param>
+	void SetXWall(int x, int z, bool wall);
+
+	/// <summary>
+	/// Adds or removes the wall on an edge of constant z.
+	/// </summary>
+	/// <param name="x">Column of the edge</param>
+	/// <param name="z">Row of the edge, from 0 to the depth</param>
+	/// <param name="wall">True to add a wall</param>
+	void SetZWall(int x, int z, bool wall);
+
+private:
+	std::vector<std::uint64_t> xWords;
+	std::vector<std::uint64_t> zWords;
+};
+
+/// <summary>
+/// Perfect maze of any size, generated on demand instead of stored. Each cell opens a passage
+/// either along the x-axis or along the z-axis, chosen by hashing its coordinates (the binary
+/// tree algorithm), so the walls of any cell can be found without generating the others.
+/// The maze lies on the same side of the origin as the hand-made maze, with its first
+/// corridor at the origin.
+/// </summary>
+class BinaryTreeMaze : public MazeSource
+{
+public:
+	/// <summary>
+	/// Sets the size of the maze.
+	/// </summary>
+	/// <param name="mazeWidth">Number of cells along the x-axis</param>
+	/// <param name="mazeDepth">Number of cells along the z-axis</param>
+	/// <param name="mazeSeed">Seed of the hash, so that each seed gives a different maze</param>
+	void Create(int mazeWidth, int mazeDepth, std::uint32_t mazeSeed = 1);
+
+	void GatherTiles(int x0, int z0, int x1, int z1, std::vector<Tile>& tiles) const override;
+
+private:
+	/// <summary>
+	/// Checks whether a cell opens its passage along the x-axis rather than the z-axis.
+	/// </summary>
+	/// <param name="x">Column of the cell</param>
+	/// <param name="z">Row of the cell</param>
+	/// <returns>True if the wall on the positive x side of the cell is open</returns>
+	bool OpensAlongX(int x, int z) const;
+
+	std::uint32_t seed = 1;
+};
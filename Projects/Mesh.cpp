@@ -0,0 +1,346 @@
+#include "Mesh.h"
+
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+
+/// <summary>
+/// Finds the finest quantization that covers a bounding box.
+/// </summary>
+/// <param name="boundsMin">Minimum corner of the positions to store</param>
+/// <param name="boundsMax">Maximum corner of the positions to store</param>
+/// <returns>Quantization covering the box</returns>
+PositionQuantization PositionQuantization::FromBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	PositionQuantization quantization;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// One value is kept in reserve, since the center is rounded to a whole step
+		float halfExtent = glm::max((boundsMax[axis] - boundsMin[axis]) * 0.5f, 1e-6f);
+		float step = std::exp2(std::ceil(std::log2(halfExtent / 32766.0f)));
+		float center = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+
+		quantization.step[axis] = step;
+		quantization.offset[axis] = std::round(center / step) * step;
+	}
+
+	return quantization;
+}
+
+/// <summary>
+/// Converts a position to normalized shorts.
+/// </summary>
+/// <param name="position">Position inside the bounds</param>
+/// <param name="packed">Receives the x, y and z shorts</param>
+void PositionQuantization::Encode(const glm::vec3& position, GLshort* packed) const
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float value = std::round((position[axis] - offset[axis]) / step[axis]);
+		packed[axis] = static_cast<GLshort>(glm::clamp(value, -32767.0f, 32767.0f));
+	}
+}
+
+/// <summary>
+/// Packs a vertex to the format stored on the GPU.
+/// </summary>
+/// <param name="vertex">Full precision vertex</param>
+/// <param name="quantization">Quantization of the positions of the mesh</param>
+/// <returns>Packed vertex</returns>
+PackedVertex PackVertex(const MeshVertex& vertex, const PositionQuantization& quantization)
+{
+	PackedVertex packed;
+	quantization.Encode(vertex.position, &packed.x);
+	packed.w = 0;
+	packed.uv = glm::packHalf2x16(vertex.uv);
+	packed.normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0f));
+	return packed;
+}
+
+/// <summary>
+/// Points the position, UV and normal attributes at packed vertices in the bound array buffer,
+/// and enables them in the bound vertex array object.
+/// </summary>
+/// <param name="stride">Distance between two vertices in bytes</param>
+/// <param name="offset">Offset of the first PackedVertex in the buffer</param>
+void SetPackedVertexAttributes(GLsizei stride, std::size_t offset)
+{
+	// Vertex attribute 0 - Position
+	glEnableVertexAttribArray(PositionAttribute);
+	glVertexAttribPointer(PositionAttribute, 3, GL_SHORT, GL_TRUE, stride, (void*)(offset + offsetof(PackedVertex, x)));
+
+	// Vertex attribute 2 - UV coordinate
+	glEnableVertexAttribArray(UVAttribute);
+	glVertexAttribPointer(UVAttribute, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(PackedVertex, uv)));
+
+	// Vertex attribute 12 - Normal
+	glEnableVertexAttribArray(NormalAttribute);
+	glVertexAttribPointer(NormalAttribute, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)(offset + offsetof(PackedVertex, normal)));
+}
+
+/// <summary>
+/// Sets the constant attributes used with packed vertices: the white vertex color, and the
+/// scale and offset that turn quantized positions back into model space. These are not part
+/// of the vertex array object, so they must be set again before drawing another mesh.
+/// </summary>
+/// <param name="quantization">Quantization of the positions of the mesh about to be drawn</param>
+void SetPackedVertexConstants(const PositionQuantization& quantization)
+{
+	glm::vec3 scale = quantization.GetScale();
+	glVertexAttrib3f(ColorAttribute, 1.0f, 1.0f, 1.0f);
+	glVertexAttrib3f(PositionScaleAttribute, scale.x, scale.y, scale.z);
+	glVertexAttrib3f(PositionOffsetAttribute, quantization.offset.x, quantization.offset.y, quantization.offset.z);
+}
+
+/// <summary>
+/// Uploads indices to the element array buffer currently bound, as shorts if every vertex
+/// can be addressed with one.
+/// </summary>
+/// <param name="indices">Indices to upload</param>
+/// <param name="vertexCount">Number of vertices the indices refer to</param>
+/// <returns>GL_UNSIGNED_SHORT or GL_UNSIGNED_INT</returns>
+GLenum UploadIndices(const std::vector<GLuint>& indices, std::size_t vertexCount)
+{
+	if (vertexCount > 65536)
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+		return GL_UNSIGNED_INT;
+	}
+
+	std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+	return GL_UNSIGNED_SHORT;
+}
+
+/// <summary>
+/// Reorders triangles so that they reuse the vertices still in the post-transform cache of the GPU
+/// (Tom Forsyth's linear-speed vertex cache optimization).
+/// </summary>
+/// <param name="indices">Triangle list indices to reorder in place</param>
+/// <param name="indexCount">Number of indices, a multiple of 3</param>
+/// <param name="vertexCount">Number of vertices the indices refer to</param>
+void OptimizeVertexCache(GLuint* indices, std::size_t indexCount, std::size_t vertexCount)
+{
+	const int cacheSize = 32;
+	std::size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	// Triangles that still use each vertex, as a list per vertex
+	std::vector<int> remaining(vertexCount, 0);
+	for (std::size_t i = 0; i < indexCount; i++)
+	{
+		remaining[indices[i]]++;
+	}
+
+	std::vector<std::size_t> firstTriangle(vertexCount + 1, 0);
+	for (std::size_t v = 0; v < vertexCount; v++)
+	{
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+	}
+
+	std::vector<int> vertexTriangles(indexCount);
+	std::vector<std::size_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (std::size_t i = 0; i < indexCount; i++)
+	{
+		vertexTriangles[filled[indices[i]]++] = static_cast<int>(i / 3);
+	}
+
+	// Vertices score higher when they were used recently, and when few triangles still
+	// need them, so that lone vertices get finished off instead of left behind
+	std::vector<int> cachePosition(vertexCount, -1);
+	auto scoreVertex = [&](GLuint v)
+	{
+		if (remaining[v] == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		int position = cachePosition[v];
+		if (position >= 0)
+		{
+			score = position < 3 ? 0.75f : std::pow(1.0f - (position - 3) / static_cast<float>(cacheSize - 3), 1.5f);
+		}
+
+		return score + 2.0f / std::sqrt(static_cast<float>(remaining[v]));
+	};
+
+	std::vector<float> vertexScores(vertexCount);
+	for (std::size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScores[v] = scoreVertex(static_cast<GLuint>(v));
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (std::size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+	}
+
+	std::vector<GLuint> output;
+	output.reserve(indexCount);
+	std::vector<GLuint> cache;
+	cache.reserve(cacheSize + 3);
+
+	std::size_t scanStart = 0;
+	int bestTriangle = -1;
+	while (output.size() < indexCount)
+	{
+		// When the cache offers nothing, start again from the best remaining triangle
+		if (bestTriangle < 0)
+		{
+			while (emitted[scanStart])
+			{
+				scanStart++;
+			}
+
+			bestTriangle = static_cast<int>(scanStart);
+			for (std::size_t t = scanStart; t < triangleCount; t++)
+			{
+				if (!emitted[t] && triangleScores[t] > triangleScores[bestTriangle])
+				{
+					bestTriangle = static_cast<int>(t);
+				}
+			}
+		}
+
+		emitted[bestTriangle] = true;
+		GLuint corners[3] = { indices[bestTriangle * 3], indices[bestTriangle * 3 + 1], indices[bestTriangle * 3 + 2] };
+		for (GLuint v : corners)
+		{
+			output.push_back(v);
+
+			// Remove the triangle from the list of the vertex
+			// (a degenerate triangle lists the same vertex more than once)
+			int* begin = vertexTriangles.data() + firstTriangle[v];
+			int* end = begin + remaining[v];
+			int* found = std::find(begin, end, bestTriangle);
+			if (found != end)
+			{
+				*found = *(end - 1);
+				remaining[v]--;
+			}
+
+			// Move the vertex to the front of the cache
+			std::vector<GLuint>::iterator cached = std::find(cache.begin(), cache.end(), v);
+			if (cached != cache.end())
+			{
+				cache.erase(cached);
+			}
+			cache.insert(cache.begin(), v);
+		}
+
+		// Vertices pushed out of the cache lose their cache bonus
+		while (cache.size() > static_cast<std::size_t>(cacheSize))
+		{
+			cachePosition[cache.back()] = -1;
+			vertexScores[cache.back()] = scoreVertex(cache.back());
+			cache.pop_back();
+		}
+
+		for (std::size_t i = 0; i < cache.size(); i++)
+		{
+			cachePosition[cache[i]] = static_cast<int>(i);
+		}
+
+		// Rescore the vertices in the cache, and pick the best triangle using any of them
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (GLuint v : cache)
+		{
+			vertexScores[v] = scoreVertex(v);
+		}
+		for (GLuint v : cache)
+		{
+			for (int i = 0; i < remaining[v]; i++)
+			{
+				int t = vertexTriangles[firstTriangle[v] + i];
+				triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+/// <summary>
+/// Optimizes the index order of each submesh and the vertex order, packs the vertices and
+/// uploads everything to the GPU.
+/// </summary>
+/// <param name="vertices">Vertices of the mesh</param>
+/// <param name="indices">Triangle list indices, grouped by submesh</param>
+/// <param name="submeshIndexCounts">Number of indices in each submesh, in order</param>
+void Mesh::Create(std::vector<MeshVertex> vertices, std::vector<GLuint> indices, const std::vector<GLsizei>& submeshIndexCounts)
+{
+	submeshFirstIndex.assign(1, 0);
+	for (GLsizei count : submeshIndexCounts)
+	{
+		OptimizeVertexCache(indices.data() + submeshFirstIndex.back(), count, vertices.size());
+		submeshFirstIndex.push_back(submeshFirstIndex.back() + count);
+	}
+	OptimizeVertexFetch(vertices, indices);
+
+	glm::vec3 boundsMin(0.0f);
+	glm::vec3 boundsMax(0.0f);
+	if (!vertices.empty())
+	{
+		boundsMin = boundsMax = vertices[0].position;
+	}
+	for (const MeshVertex& vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+	quantization = PositionQuantization::FromBounds(boundsMin, boundsMax);
+
+	std::vector<PackedVertex> packedVertices;
+	packedVertices.reserve(vertices.size());
+	for (const MeshVertex& vertex : vertices)
+	{
+		packedVertices.push_back(PackVertex(vertex, quantization));
+	}
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, packedVertices.size() * sizeof(PackedVertex), packedVertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// The element buffer is bound without a vertex array object here, only to upload it
+	glBindVertexArray(0);
+	glGenBuffers(1, &ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	indexType = UploadIndices(indices, vertices.size());
+	indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/// <summary>
+/// Binds the vertex and index buffers and sets the vertex attributes of the mesh in the
+/// bound vertex array object.
+/// </summary>
+void Mesh::SetAttributes() const
+{
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	SetPackedVertexAttributes(sizeof(PackedVertex), 0);
+}
+
+/// <summary>
+/// Deletes the buffers of the mesh.
+/// </summary>
+void Mesh::Destroy()
+{
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ibo);
+	vbo = ibo = 0;
+	submeshFirstIndex.clear();
+}
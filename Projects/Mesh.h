@@ -0,0 +1,195 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+/// <summary>
+/// Vertex attribute locations shared by every mesh and by main.vsh
+/// </summary>
+const GLuint PositionAttribute = 0;
+const GLuint ColorAttribute = 1;
+const GLuint UVAttribute = 2;
+const GLuint TileOriginAttribute = 7;
+const GLuint NormalAttribute = 12;
+const GLuint PositionScaleAttribute = 13;
+const GLuint PositionOffsetAttribute = 14;
+
+/// <summary>
+/// Vertex with full precision attributes, used while building meshes on the CPU
+/// </summary>
+struct MeshVertex
+{
+	glm::vec3 position;
+	glm::vec2 uv;
+	glm::vec3 normal;
+};
+
+/// <summary>
+/// Vertex as stored on the GPU, 16 bytes instead of the 32 bytes of a MeshVertex.
+/// The color is always white, so it is a constant attribute instead of being stored.
+/// </summary>
+struct PackedVertex
+{
+	GLshort x, y, z, w;	// Position, as normalized shorts within the bounds of the mesh (w is padding)
+	GLuint uv;			// UV coordinates, as two half floats
+	GLuint normal;		// Normal, as signed normalized 10_10_10_2
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay tightly packed");
+
+/// <summary>
+/// Maps positions within a bounding box to normalized shorts and back. The step between two
+/// representable positions is a power of two, so positions on a coarser power-of-two grid
+/// (such as the whole-unit positions of the maze) are stored exactly.
+/// </summary>
+struct PositionQuantization
+{
+	glm::vec3 step = glm::vec3(1.0f);	// Distance between two consecutive short values
+	glm::vec3 offset = glm::vec3(0.0f);	// Position stored as zero
+
+	/// <summary>
+	/// Finds the finest quantization that covers a bounding box.
+	/// </summary>
+	/// <param name="boundsMin">Minimum corner of the positions to store</param>
+	/// <param name="boundsMax">Maximum corner of the positions to store</param>
+	/// <returns>Quantization covering the box</returns>
+	static PositionQuantization FromBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	/// <summary>
+	/// Converts a position to normalized shorts.
+	/// </summary>
+	/// <param name="position">Position inside the bounds</param>
+	/// <param name="packed">Receives the x, y and z shorts</param>
+	void Encode(const glm::vec3& position, GLshort* packed) const;
+
+	/// <summary>
+	/// Value the shader multiplies the normalized position by, before adding the offset
+	/// </summary>
+	glm::vec3 GetScale() const { return step * 32767.0f; }
+};
+
+/// <summary>
+/// Packs a vertex to the format stored on the GPU.
+/// </summary>
+/// <param name="vertex">Full precision vertex</param>
+/// <param name="quantization">Quantization of the positions of the mesh</param>
+/// <returns>Packed vertex</returns>
+PackedVertex PackVertex(const MeshVertex& vertex, const PositionQuantization& quantization);
+
+/// <summary>
+/// Points the position, UV and normal attributes at packed vertices in the bound array buffer,
+/// and enables them in the bound vertex array object.
+/// </summary>
+/// <param name="stride">Distance between two vertices in bytes</param>
+/// <param name="offset">Offset of the first PackedVertex in the buffer</param>
+void SetPackedVertexAttributes(GLsizei stride, std::size_t offset);
+
+/// <summary>
+/// Sets the constant attributes used with packed vertices: the white vertex color, and the
+/// scale and offset that turn quantized positions back into model space. These are not part
+/// of the vertex array object, so they must be set again before drawing another mesh.
+/// </summary>
+/// <param name="quantization">Quantization of the positions of the mesh about to be drawn</param>
+void SetPackedVertexConstants(const PositionQuantization& quantization);
+
+/// <summary>
+/// Uploads indices to the element array buffer currently bound, as shorts if every vertex
+/// can be addressed with one.
+/// </summary>
+/// <param name="indices">Indices to upload</param>
+/// <param name="vertexCount">Number of vertices the indices refer to</param>
+/// <returns>GL_UNSIGNED_SHORT or GL_UNSIGNED_INT</returns>
+GLenum UploadIndices(const std::vector<GLuint>& indices, std::size_t vertexCount);
+
+/// <summary>
+/// Reorders triangles so that they reuse the vertices still in the post-transform cache of the GPU
+/// (Tom Forsyth's linear-speed vertex cache optimization).
+/// </summary>
+/// <param name="indices">Triangle list indices to reorder in place</param>
+/// <param name="indexCount">Number of indices, a multiple of 3</param>
+/// <param name="vertexCount">Number of vertices the indices refer to</param>
+void OptimizeVertexCache(GLuint* indices, std::size_t indexCount, std::size_t vertexCount);
+
+/// <summary>
+/// Reorders vertices by the order the indices first use them, so the GPU reads the vertex
+/// buffer mostly sequentially. Vertices that are never used are dropped.
+/// </summary>
+/// <param name="vertices">Vertices to reorder</param>
+/// <param name="indices">Indices to remap to the new order</param>
+template<typename V>
+void OptimizeVertexFetch(std::vector<V>& vertices, std::vector<GLuint>& indices)
+{
+	std::vector<GLuint> remap(vertices.size(), static_cast<GLuint>(-1));
+	std::vector<V> reordered;
+	reordered.reserve(vertices.size());
+
+	for (GLuint& index : indices)
+	{
+		if (remap[index] == static_cast<GLuint>(-1))
+		{
+			remap[index] = static_cast<GLuint>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(reordered);
+}
+
+/// <summary>
+/// Indexed triangle mesh stored with packed vertices. Each submesh is a range of indices that
+/// can be drawn on its own. Indices are stored as shorts when there are few enough vertices.
+/// </summary>
+class Mesh
+{
+public:
+	/// <summary>
+	/// Optimizes the index order of each submesh and the vertex order, packs the vertices and
+	/// uploads everything to the GPU.
+	/// </summary>
+	/// <param name="vertices">Vertices of the mesh</param>
+	/// <param name="indices">Triangle list indices, grouped by submesh</param>
+	/// <param name="submeshIndexCounts">Number of indices in each submesh, in order</param>
+	void Create(std::vector<MeshVertex> vertices, std::vector<GLuint> indices, const std::vector<GLsizei>& submeshIndexCounts);
+
+	/// <summary>
+	/// Binds the vertex and index buffers and sets the vertex attributes of the mesh in the
+	/// bound vertex array object.
+	/// </summary>
+	void SetAttributes() const;
+
+	/// <summary>
+	/// Deletes the buffers of the mesh.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Quantization of the vertex positions, to pass to SetPackedVertexConstants() before drawing
+	/// </summary>
+	const PositionQuantization& GetQuantization() const { return quantization; }
+
+	/// <summary>
+	/// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	/// </summary>
+	GLenum GetIndexType() const { return indexType; }
+
+	/// <summary>
+	/// Number of indices in a submesh
+	/// </summary>
+	GLsizei GetIndexCount(int submesh) const { return submeshFirstIndex[submesh + 1] - submeshFirstIndex[submesh]; }
+
+	/// <summary>
+	/// Byte offset of the first index of a submesh in the index buffer
+	/// </summary>
+	const void* GetIndexOffset(int submesh) const { return (const void*)(submeshFirstIndex[submesh] * indexSize); }
+
+private:
+	GLuint vbo = 0;
+	GLuint ibo = 0;
+	GLenum indexType = GL_UNSIGNED_SHORT;
+	std::size_t indexSize = sizeof(GLushort);
+	PositionQuantization quantization;
+	std::vector<GLsizei> submeshFirstIndex;	// First index of each submesh, plus one final entry for the end
+};
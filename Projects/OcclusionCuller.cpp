@@ -0,0 +1,221 @@
+#include "OcclusionCuller.h"
+
+/// <summary>
+/// Splits the grid into clusters and creates their queries, along with the
+/// geometry and shader program used to draw the bounding boxes.
+/// </summary>
+/// <param name="cellGrid">Grid of the maze</param>
+/// <param name="size">Number of cells along each side of a cluster</param>
+void OcclusionCuller::Create(const CellGrid& cellGrid, int size)
+{
+	grid = &cellGrid;
+	clusterSize = size;
+	clustersX = (grid->GetWidth() + clusterSize - 1) / clusterSize;
+	int clustersZ = (grid->GetDepth() + clusterSize - 1) / clusterSize;
+
+	// The boxes are grown slightly, so that walls lying exactly on the side of a box
+	// do not hide the box from the depth test
+	const glm::vec3 margin = glm::vec3(0.01f);
+
+	clusters.resize(clustersX * clustersZ);
+	for (int z = 0; z < clustersZ; z++)
+	{
+		for (int x = 0; x < clustersX; x++)
+		{
+			Cluster& cluster = clusters[z * clustersX + x];
+			glGenQueries(1, &cluster.query);
+
+			int x1 = glm::min((x + 1) * clusterSize, grid->GetWidth());
+			int z1 = glm::min((z + 1) * clusterSize, grid->GetDepth());
+			grid->GetBounds(x * clusterSize, z * clusterSize, x1, z1, cluster.boxMin, cluster.boxMax);
+			cluster.boxMin -= margin;
+			cluster.boxMax += margin;
+		}
+	}
+
+	// Unit cube drawn as 12 triangles
+	const GLfloat corners[] = {
+		0.0f, 0.0f, 0.0f,	1.0f, 0.0f, 0.0f,	0.0f, 1.0f, 0.0f,	1.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 1.0f,	1.0f, 0.0f, 1.0f,	0.0f, 1.0f, 1.0f,	1.0f, 1.0f, 1.0f,
+	};
+	const GLubyte indices[] = {
+		0, 2, 1,	1, 2, 3,	// z = 0
+		4, 5, 6,	5, 7, 6,	// z = 1
+		0, 1, 4,	1, 5, 4,	// y = 0
+		2, 6, 3,	3, 6, 7,	// y = 1
+		0, 4, 2,	2, 4, 6,	// x = 0
+		1, 3, 5,	3, 7, 5,	// x = 1
+	};
+
+	glGenVertexArrays(1, &boxVao);
+	glBindVertexArray(boxVao);
+
+	glGenBuffers(1, &boxVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, boxVbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &boxIbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boxIbo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	// Vertex attribute 0 - Position
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	boxProgram.Create("occlusion.vsh", "occlusion.fsh");
+	boxProgram.SetUniformBlockBinding("FrameUniforms", FrameUniformsBinding);
+	boxMinUniform = boxProgram.GetUniform<glm::vec3>("boxMin");
+	boxSizeUniform = boxProgram.GetUniform<glm::vec3>("boxSize");
+}
+
+/// <summary>
+/// Draws the provided cells cluster by cluster, each cluster under conditional
+/// rendering with the query issued for it on the previous frame, then issues this
+/// frame's queries. Clusters containing the camera, and clusters that were not
+/// tested on the previous frame, are drawn unconditionally.
+/// </summary>
+/// <param name="cells">Cells that passed the other culling stages, in draw order</param>
+/// <param name="cameraPosition">World-space position of the camera</param>
+/// <param name="drawCells">Draws a list of cells in draw order, using the scene program</param>
+void OcclusionCuller::Draw(const std::vector<int>& cells, const glm::vec3& cameraPosition,
+	const std::function<void(const std::vector<int>&)>& drawCells)
+{
+	// Sort the cells into their clusters, keeping the draw order within each cluster.
+	// The clusters themselves are drawn in the order of their first cell.
+	for (int index : activeClusters)
+	{
+		clusters[index].cells.clear();
+	}
+	activeClusters.clear();
+
+	for (int cell : cells)
+	{
+		int x = cell % grid->GetWidth();
+		int z = cell / grid->GetWidth();
+		int index = (z / clusterSize) * clustersX + (x / clusterSize);
+		if (clusters[index].cells.empty())
+		{
+			activeClusters.push_back(index);
+		}
+		clusters[index].cells.push_back(cell);
+	}
+
+	activeClusterCount = static_cast<int>(activeClusters.size());
+	culledClusterCount = 0;
+
+	// Draw pass, using the results of the previous frame
+	for (int index : activeClusters)
+	{
+		Cluster& cluster = clusters[index];
+		bool cameraInside = glm::all(glm::greaterThanEqual(cameraPosition, cluster.boxMin))
+			&& glm::all(glm::lessThanEqual(cameraPosition, cluster.boxMax));
+
+		if (cameraInside || cluster.lastQueriedFrame != frame - 1)
+		{
+			drawCells(cluster.cells);
+			continue;
+		}
+
+		// Only for the statistics; the result is never waited for
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(cluster.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_TRUE)
+		{
+			GLuint anySamplesPassed = GL_TRUE;
+			glGetQueryObjectuiv(cluster.query, GL_QUERY_RESULT, &anySamplesPassed);
+			if (anySamplesPassed == GL_FALSE)
+			{
+				culledClusterCount++;
+			}
+		}
+
+		// If the result is not ready yet, the GPU draws the cluster anyway
+		glBeginConditionalRender(cluster.query, GL_QUERY_NO_WAIT);
+		drawCells(cluster.cells);
+		glEndConditionalRender();
+	}
+
+	// Query pass, against the depth buffer of this frame. The view-projection matrix
+	// comes from the frame uniform block.
+	boxProgram.Use();
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	glBindVertexArray(boxVao);
+
+	for (int index : activeClusters)
+	{
+		Cluster& cluster = clusters[index];
+		bool cameraInside = glm::all(glm::greaterThanEqual(cameraPosition, cluster.boxMin))
+			&& glm::all(glm::lessThanEqual(cameraPosition, cluster.boxMax));
+
+		// The box of the cluster containing the camera may be clipped by the near plane
+		if (cameraInside)
+		{
+			continue;
+		}
+
+		boxProgram.Set(boxMinUniform, cluster.boxMin);
+		boxProgram.Set(boxSizeUniform, cluster.boxMax - cluster.boxMin);
+
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, cluster.query);
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, nullptr);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+		cluster.lastQueriedFrame = frame;
+	}
+
+	glBindVertexArray(0);
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	frame++;
+}
+
+/// <summary>
+/// Draws the clusters of the last call to Draw() again, each under conditional rendering
+/// with the query Draw() just issued for it. Used for the shading pass after a depth
+/// pre-pass, where those queries were tested against the finished depth buffer.
+/// </summary>
+/// <param name="drawCells">Draws a list of cells in draw order, using the scene program</param>
+void OcclusionCuller::Redraw(const std::function<void(const std::vector<int>&)>& drawCells)
+{
+	for (int index : activeClusters)
+	{
+		Cluster& cluster = clusters[index];
+
+		// Clusters containing the camera were not queried
+		if (cluster.lastQueriedFrame != frame - 1)
+		{
+			drawCells(cluster.cells);
+			continue;
+		}
+
+		glBeginConditionalRender(cluster.query, GL_QUERY_NO_WAIT);
+		drawCells(cluster.cells);
+		glEndConditionalRender();
+	}
+}
+
+/// <summary>
+/// Deletes the queries, buffers and shader program owned by the culler.
+/// </summary>
+void OcclusionCuller::Destroy()
+{
+	for (Cluster& cluster : clusters)
+	{
+		glDeleteQueries(1, &cluster.query);
+	}
+	clusters.clear();
+	activeClusters.clear();
+
+	glDeleteVertexArrays(1, &boxVao);
+	glDeleteBuffers(1, &boxVbo);
+	glDeleteBuffers(1, &boxIbo);
+	boxVao = boxVbo = boxIbo = 0;
+
+	boxProgram.Destroy();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <functional>
+#include <vector>
+
+#include "CellGrid.h"
+#include "FrameUniforms.h"
+#include "ShaderProgram.h"
+
+/// <summary>
+/// Hardware occlusion culling for square clusters of maze cells. Each frame, the bounding
+/// box of every cluster is tested against the depth buffer with a GL_ANY_SAMPLES_PASSED
+/// query, and on the next frame the cluster is drawn under conditional rendering with that
+/// query. The GPU skips clusters that were hidden, and the CPU never waits for a result.
+/// </summary>
+class OcclusionCuller
+{
+public:
+	/// <summary>
+	/// Splits the grid into clusters and creates their queries, along with the
+	/// geometry and shader program used to draw the bounding boxes.
+	/// </summary>
+	/// <param name="cellGrid">Grid of the maze</param>
+	/// <param name="size">Number of cells along each side of a cluster</param>
+	void Create(const CellGrid& cellGrid, int size = 4);
+
+	/// <summary>
+	/// Draws the provided cells cluster by cluster, each cluster under conditional
+	/// rendering with the query issued for it on the previous frame, then issues this
+	/// frame's queries. Clusters containing the camera, and clusters that were not
+	/// tested on the previous frame, are drawn unconditionally.
+	/// </summary>
+	/// <param name="cells">Cells that passed the other culling stages, in draw order</param>
+	/// <param name="cameraPosition">World-space position of the camera</param>
+	/// <param name="drawCells">Draws a list of cells in draw order, using the scene program</param>
+	void Draw(const std::vector<int>& cells, const glm::vec3& cameraPosition,
+		const std::function<void(const std::vector<int>&)>& drawCells);
+
+	/// <summary>
+	/// Draws the clusters of the last call to Draw() again, each under conditional rendering
+	/// with the query Draw() just issued for it. Used for the shading pass after a depth
+	/// pre-pass, where those queries were tested against the finished depth buffer.
+	/// </summary>
+	/// <param name="drawCells">Draws a list of cells in draw order, using the scene program</param>
+	void Redraw(const std::function<void(const std::vector<int>&)>& drawCells);
+
+	/// <summary>
+	/// Deletes the queries, buffers and shader program owned by the culler.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Number of clusters that had cells to draw on the last frame
+	/// </summary>
+	int GetActiveClusterCount() const { return activeClusterCount; }
+
+	/// <summary>
+	/// Number of clusters that the GPU skipped on the last frame, counting only the
+	/// queries whose result was already available without waiting
+	/// </summary>
+	int GetCulledClusterCount() const { return culledClusterCount; }
+
+private:
+	/// <summary>
+	/// A square block of cells with its occlusion query
+	/// </summary>
+	struct Cluster
+	{
+		GLuint query = 0;
+		glm::vec3 boxMin = glm::vec3(0.0f);
+		glm::vec3 boxMax = glm::vec3(0.0f);
+		int lastQueriedFrame = -2;	// Frame on which the query was last issued
+		std::vector<int> cells;		// Cells of the cluster to draw this frame
+	};
+
+	const CellGrid* grid = nullptr;
+	int clusterSize = 1;
+	int clustersX = 0;
+	std::vector<Cluster> clusters;
+	std::vector<int> activeClusters;
+
+	ShaderProgram boxProgram;
+	UniformHandle<glm::vec3> boxMinUniform;
+	UniformHandle<glm::vec3> boxSizeUniform;
+	GLuint boxVao = 0;
+	GLuint boxVbo = 0;
+	GLuint boxIbo = 0;
+
+	int frame = 0;
+	int activeClusterCount = 0;
+	int culledClusterCount = 0;
+};
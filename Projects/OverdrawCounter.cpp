@@ -0,0 +1,134 @@
+#include "OverdrawCounter.h"
+
+/// <summary>
+/// Enables the counter.
+/// </summary>
+void OverdrawCounter::Create()
+{
+	enabled = true;
+	currentFrame = 0;
+}
+
+/// <summary>
+/// Reads back the counts of the oldest frame still in flight and starts a new frame.
+/// </summary>
+/// <returns>True if the counts of a frame were read back</returns>
+bool OverdrawCounter::BeginFrame()
+{
+	if (!enabled)
+	{
+		return false;
+	}
+
+	currentFrame = (currentFrame + 1) % BufferCount;
+	FrameQueries& frame = frames[currentFrame];
+	bool resolved = frame.pending && Resolve(frame);
+
+	frame.passCount = 0;
+	return resolved;
+}
+
+/// <summary>
+/// Starts counting the fragments of a shading pass. Passes cannot be nested.
+/// </summary>
+void OverdrawCounter::BeginPass()
+{
+	if (!enabled)
+	{
+		return;
+	}
+
+	// The queries are kept from frame to frame, so new ones are only needed for new passes
+	FrameQueries& frame = frames[currentFrame];
+	if (frame.queries.size() <= static_cast<std::size_t>(frame.passCount))
+	{
+		GLuint query;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+	}
+
+	glBeginQuery(GL_SAMPLES_PASSED, frame.queries[frame.passCount]);
+	counting = true;
+}
+
+/// <summary>
+/// Stops counting the fragments of the current shading pass.
+/// </summary>
+void OverdrawCounter::EndPass()
+{
+	if (!counting)
+	{
+		return;
+	}
+
+	glEndQuery(GL_SAMPLES_PASSED);
+	frames[currentFrame].passCount++;
+	counting = false;
+}
+
+/// <summary>
+/// Finishes the frame.
+/// </summary>
+/// <param name="pixelCount">Number of pixels in the framebuffer this frame</param>
+void OverdrawCounter::EndFrame(long long pixelCount)
+{
+	if (!enabled)
+	{
+		return;
+	}
+
+	frames[currentFrame].pixelCount = pixelCount;
+	frames[currentFrame].pending = true;
+}
+
+/// <summary>
+/// Reads the results of a frame if the GPU has finished it.
+/// </summary>
+/// <param name="frame">Frame to read</param>
+/// <returns>True if the results were available</returns>
+bool OverdrawCounter::Resolve(FrameQueries& frame)
+{
+	frame.pending = false;
+
+	// The queries finish in order, so once the last one is available, all of them are
+	if (frame.passCount > 0)
+	{
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(frame.queries[frame.passCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE)
+		{
+			return false;
+		}
+	}
+
+	shadedFragmentCount = 0;
+	for (int pass = 0; pass < frame.passCount; pass++)
+	{
+		GLuint64 samples = 0;
+		glGetQueryObjectui64v(frame.queries[pass], GL_QUERY_RESULT, &samples);
+		shadedFragmentCount += samples;
+	}
+
+	overdraw = frame.pixelCount > 0 ? static_cast<double>(shadedFragmentCount) / frame.pixelCount : 0.0;
+	return true;
+}
+
+/// <summary>
+/// Deletes the queries.
+/// </summary>
+void OverdrawCounter::Destroy()
+{
+	for (FrameQueries& frame : frames)
+	{
+		if (!frame.queries.empty())
+		{
+			glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		}
+		frame.queries.clear();
+		frame.passCount = 0;
+		frame.pending = false;
+	}
+
+	enabled = false;
+	counting = false;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+/// <summary>
+/// Counts the fragments that pass the depth test in the shading passes of each frame, with
+/// GL_SAMPLES_PASSED queries. Since the fragment shader has no side effects that prevent the
+/// early depth test, this is the number of times the scene fragment shader ran. Divided by
+/// the number of pixels, it gives the average overdraw. Like the profiler, the queries of
+/// each frame are only read back two frames later, so the CPU never waits for them.
+/// </summary>
+class OverdrawCounter
+{
+public:
+	/// <summary>
+	/// Enables the counter.
+	/// </summary>
+	void Create();
+
+	/// <summary>
+	/// Reads back the counts of the oldest frame still in flight and starts a new frame.
+	/// </summary>
+	/// <returns>True if the counts of a frame were read back</returns>
+	bool BeginFrame();
+
+	/// <summary>
+	/// Starts counting the fragments of a shading pass. Passes cannot be nested.
+	/// </summary>
+	void BeginPass();
+
+	/// <summary>
+	/// Stops counting the fragments of the current shading pass.
+	/// </summary>
+	void EndPass();
+
+	/// <summary>
+	/// Finishes the frame.
+	/// </summary>
+	/// <param name="pixelCount">Number of pixels in the framebuffer this frame</param>
+	void EndFrame(long long pixelCount);
+
+	/// <summary>
+	/// Deletes the queries.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// True once Create() has been called
+	/// </summary>
+	bool IsEnabled() const { return enabled; }
+
+	/// <summary>
+	/// Number of fragments shaded in the last frame that was read back
+	/// </summary>
+	GLuint64 GetShadedFragmentCount() const { return shadedFragmentCount; }
+
+	/// <summary>
+	/// Fragments shaded per pixel of the framebuffer in the last frame that was read back.
+	/// Pixels showing the background count as zero, so a fully covered frame without any
+	/// overdraw reads 1.
+	/// </summary>
+	double GetOverdraw() const { return overdraw; }
+
+private:
+	/// <summary>
+	/// Queries of one frame in flight
+	/// </summary>
+	struct FrameQueries
+	{
+		std::vector<GLuint> queries;	// One query per shading pass
+		int passCount = 0;
+		long long pixelCount = 0;
+		bool pending = false;			// True until the results have been read back
+	};
+
+	/// <summary>
+	/// Reads the results of a frame if the GPU has finished it.
+	/// </summary>
+	/// <param name="frame">Frame to read</param>
+	/// <returns>True if the results were available</returns>
+	bool Resolve(FrameQueries& frame);
+
+	static const int BufferCount = 2;
+
+	bool enabled = false;
+	bool counting = false;
+	FrameQueries frames[BufferCount];
+	int currentFrame = 0;
+
+	GLuint64 shadedFragmentCount = 0;
+	double overdraw = 0.0;
+};
@@ -0,0 +1,203 @@
+#include "Profiler.h"
+
+#include <cstdio>
+
+/// <summary>
+/// Enables the profiler.
+/// </summary>
+/// <param name="csvFilePath">File to write every sample to, or an empty string to only keep the last frame</param>
+/// <returns>True if the CSV file could be opened</returns>
+bool Profiler::Create(const std::string& csvFilePath)
+{
+	enabled = true;
+	currentFrame = 0;
+	frameIndex = 0;
+
+	if (csvFilePath.empty())
+	{
+		return true;
+	}
+
+	csvFile.open(csvFilePath);
+	if (csvFile.fail())
+	{
+		return false;
+	}
+
+	csvFile << "frame,scope,depth,cpu_ms,gpu_ms\n";
+	return true;
+}
+
+/// <summary>
+/// Reads back the samples of the oldest frame still in flight, then opens the scope
+/// covering the whole new frame.
+/// </summary>
+void Profiler::BeginFrame()
+{
+	if (!enabled)
+	{
+		return;
+	}
+
+	currentFrame = (currentFrame + 1) % BufferCount;
+	FrameQueries& frame = frames[currentFrame];
+	if (frame.pending)
+	{
+		Resolve(frame);
+	}
+
+	frame.scopes.clear();
+	frame.frameIndex = frameIndex++;
+	depth = 0;
+
+	BeginScope("Frame");
+}
+
+/// <summary>
+/// Closes the scope covering the whole frame.
+/// </summary>
+void Profiler::EndFrame()
+{
+	if (!enabled)
+	{
+		return;
+	}
+
+	EndScope(0);
+	frames[currentFrame].pending = true;
+}
+
+/// <summary>
+/// Starts measuring a scope. Scopes must be closed in the reverse order they were opened.
+/// </summary>
+/// <param name="name">Name of the scope, which must outlive the profiler</param>
+/// <returns>Handle to pass to EndScope(), or -1 if the profiler is disabled</returns>
+int Profiler::BeginScope(const char* name)
+{
+	if (!enabled)
+	{
+		return -1;
+	}
+
+	FrameQueries& frame = frames[currentFrame];
+	int scope = static_cast<int>(frame.scopes.size());
+
+	// The queries are kept from frame to frame, so new ones are only needed for new scopes
+	if (frame.queries.size() < static_cast<std::size_t>(scope + 1) * 2)
+	{
+		GLuint queries[2];
+		glGenQueries(2, queries);
+		frame.queries.push_back(queries[0]);
+		frame.queries.push_back(queries[1]);
+	}
+
+	PendingScope pendingScope;
+	pendingScope.name = name;
+	pendingScope.depth = depth++;
+	pendingScope.cpuBegin = Clock::now();
+	pendingScope.cpuEnd = pendingScope.cpuBegin;
+	frame.scopes.push_back(pendingScope);
+
+	glQueryCounter(frame.queries[scope * 2], GL_TIMESTAMP);
+	return scope;
+}
+
+/// <summary>
+/// Stops measuring a scope.
+/// </summary>
+/// <param name="scope">Handle returned by BeginScope()</param>
+void Profiler::EndScope(int scope)
+{
+	if (scope < 0)
+	{
+		return;
+	}
+
+	FrameQueries& frame = frames[currentFrame];
+	glQueryCounter(frame.queries[scope * 2 + 1], GL_TIMESTAMP);
+	frame.scopes[scope].cpuEnd = Clock::now();
+	depth--;
+}
+
+/// <summary>
+/// Reads the results of a frame if the GPU has finished it.
+/// </summary>
+/// <param name="frame">Frame to read</param>
+void Profiler::Resolve(FrameQueries& frame)
+{
+	frame.pending = false;
+
+	// The whole-frame scope ends last, so once its end query is available, all of them are
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == GL_FALSE)
+	{
+		droppedFrameCount++;
+		return;
+	}
+
+	lastFrame.clear();
+	for (std::size_t i = 0; i < frame.scopes.size(); i++)
+	{
+		const PendingScope& scope = frame.scopes[i];
+
+		GLuint64 gpuBegin = 0;
+		GLuint64 gpuEnd = 0;
+		glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &gpuBegin);
+		glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &gpuEnd);
+
+		ProfileSample sample;
+		sample.name = scope.name;
+		sample.depth = scope.depth;
+		sample.cpuMs = std::chrono::duration<double, std::milli>(scope.cpuEnd - scope.cpuBegin).count();
+		sample.gpuMs = gpuEnd > gpuBegin ? (gpuEnd - gpuBegin) / 1000000.0 : 0.0;
+		lastFrame.push_back(sample);
+
+		if (csvFile.is_open())
+		{
+			csvFile << frame.frameIndex << ',' << sample.name << ',' << sample.depth << ','
+				<< sample.cpuMs << ',' << sample.gpuMs << '\n';
+		}
+	}
+}
+
+/// <summary>
+/// Formats the samples of the last frame that was read back, as CPU/GPU milliseconds per scope.
+/// </summary>
+/// <returns>One line of text, such as "Frame 1.20/0.85 ms | Scene 0.40/0.80 ms"</returns>
+std::string Profiler::FormatReadout() const
+{
+	std::string readout;
+	for (const ProfileSample& sample : lastFrame)
+	{
+		char text[96];
+		std::snprintf(text, sizeof(text), "%s%s %.2f/%.2f ms", readout.empty() ? "" : " | ", sample.name, sample.cpuMs, sample.gpuMs);
+		readout += text;
+	}
+
+	return readout;
+}
+
+/// <summary>
+/// Deletes the queries and closes the CSV file.
+/// </summary>
+void Profiler::Destroy()
+{
+	for (FrameQueries& frame : frames)
+	{
+		if (!frame.queries.empty())
+		{
+			glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		}
+		frame.queries.clear();
+		frame.scopes.clear();
+		frame.pending = false;
+	}
+
+	lastFrame.clear();
+	if (csvFile.is_open())
+	{
+		csvFile.close();
+	}
+	enabled = false;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// CPU and GPU time spent in one scope of a frame
+/// </summary>
+struct ProfileSample
+{
+	const char* name;	// Name given to the scope
+	int depth;			// Number of scopes the scope is nested in
+	double cpuMs;		// Time between the start and the end of the scope on the CPU
+	double gpuMs;		// Time the GPU took to execute the commands issued inside the scope
+};
+
+/// <summary>
+/// Measures named, nestable scopes of each frame on both the CPU and the GPU. The GPU side
+/// uses a pair of GL_TIMESTAMP queries per scope, since GL_TIME_ELAPSED queries cannot be
+/// nested. The queries of each frame are only read back two frames later, once the GPU
+/// has normally finished them, so reading the results never stalls the CPU.
+/// </summary>
+class Profiler
+{
+public:
+	/// <summary>
+	/// Enables the profiler.
+	/// </summary>
+	/// <param name="csvFilePath">File to write every sample to, or an empty string to only keep the last frame</param>
+	/// <returns>True if the CSV file could be opened</returns>
+	bool Create(const std::string& csvFilePath = "");
+
+	/// <summary>
+	/// Reads back the samples of the oldest frame still in flight, then opens the scope
+	/// covering the whole new frame.
+	/// </summary>
+	void BeginFrame();
+
+	/// <summary>
+	/// Closes the scope covering the whole frame.
+	/// </summary>
+	void EndFrame();
+
+	/// <summary>
+	/// Starts measuring a scope. Scopes must be closed in the reverse order they were opened.
+	/// </summary>
+	/// <param name="name">Name of the scope, which must outlive the profiler</param>
+	/// <returns>Handle to pass to EndScope(), or -1 if the profiler is disabled</returns>
+	int BeginScope(const char* name);
+
+	/// <summary>
+	/// Stops measuring a scope.
+	/// </summary>
+	/// <param name="scope">Handle returned by BeginScope()</param>
+	void EndScope(int scope);
+
+	/// <summary>
+	/// Formats the samples of the last frame that was read back, as CPU/GPU milliseconds per scope.
+	/// </summary>
+	/// <returns>One line of text, such as "Frame 1.20/0.85 ms | Scene 0.40/0.80 ms"</returns>
+	std::string FormatReadout() const;
+
+	/// <summary>
+	/// Deletes the queries and closes the CSV file.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// True once Create() has been called
+	/// </summary>
+	bool IsEnabled() const { return enabled; }
+
+	/// <summary>
+	/// Samples of the last frame that was read back
+	/// </summary>
+	const std::vector<ProfileSample>& GetLastFrame() const { return lastFrame; }
+
+	/// <summary>
+	/// Number of frames whose GPU results were still not available when read back, and were dropped
+	/// </summary>
+	int GetDroppedFrameCount() const { return droppedFrameCount; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	/// <summary>
+	/// A scope being measured, or waiting for its GPU results
+	/// </summary>
+	struct PendingScope
+	{
+		const char* name;
+		int depth;
+		Clock::time_point cpuBegin;
+		Clock::time_point cpuEnd;
+	};
+
+	/// <summary>
+	/// Scopes and timestamp queries of one frame in flight
+	/// </summary>
+	struct FrameQueries
+	{
+		std::vector<GLuint> queries;		// Two queries per scope, the start and the end
+		std::vector<PendingScope> scopes;
+		long long frameIndex = 0;
+		bool pending = false;				// True until the results have been read back
+	};
+
+	/// <summary>
+	/// Reads the results of a frame if the GPU has finished it.
+	/// </summary>
+	/// <param name="frame">Frame to read</param>
+	void Resolve(FrameQueries& frame);
+
+	static const int BufferCount = 2;
+
+	bool enabled = false;
+	FrameQueries frames[BufferCount];
+	int currentFrame = 0;
+	int depth = 0;
+	long long frameIndex = 0;
+	int droppedFrameCount = 0;
+
+	std::vector<ProfileSample> lastFrame;
+	std::ofstream csvFile;
+};
+
+/// <summary>
+/// Measures the lifetime of a block of code with a profiler.
+/// </summary>
+class ProfileScope
+{
+public:
+	ProfileScope(Profiler& profiler, const char* name) : profiler(profiler), scope(profiler.BeginScope(name)) {}
+	~ProfileScope() { profiler.EndScope(scope); }
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	Profiler& profiler;
+	int scope;
+};
@@ -0,0 +1,229 @@
+#include "ProgramBinaryCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	// Enumerants of OpenGL 4.1 and ARB_get_program_binary, which the loader does not define
+	const GLenum ProgramBinaryRetrievableHint = 0x8257;
+	const GLenum ProgramBinaryLength = 0x8741;
+	const GLenum NumProgramBinaryFormats = 0x87FE;
+
+	/// <summary>
+	/// Header at the start of a program binary file, followed by the binary
+	/// </summary>
+	struct ProgramBinaryFileHeader
+	{
+		char magic[4];				// "PGB1"
+		std::uint32_t format;		// Format of the binary, only meaningful to the driver
+		std::uint64_t key;			// Key the binary was saved under
+		std::uint64_t length;		// Bytes of binary that follow
+	};
+
+	/// <summary>
+	/// Hashes bytes into a running hash (FNV-1a).
+	/// </summary>
+	/// <param name="hash">Hash to update</param>
+	/// <param name="text">Bytes to hash</param>
+	void HashText(std::uint64_t& hash, const std::string& text)
+	{
+		for (unsigned char byte : text)
+		{
+			hash ^= byte;
+			hash *= 1099511628211ull;
+		}
+
+		// Separates the texts, so that moving bytes from one text to the next changes the key
+		hash ^= 0xff;
+		hash *= 1099511628211ull;
+	}
+}
+
+/// <summary>
+/// Looks up the program binary entry points and reads the strings identifying the driver.
+/// </summary>
+/// <param name="loadProcedure">Function returning the address of an OpenGL function, such as glfwGetProcAddress</param>
+/// <param name="directory">Directory the binaries are stored in, ending with a slash, or empty for the working directory</param>
+/// <returns>True if the driver can save program binaries, false if the cache stays off</returns>
+bool ProgramBinaryCache::Create(GLADloadproc loadProcedure, const std::string& directory)
+{
+	cacheDirectory = directory;
+	loadedCount = 0;
+	savedCount = 0;
+
+	// The functions have the same names in OpenGL 4.1 and in the extension
+	getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(loadProcedure("glGetProgramBinary"));
+	programBinary = reinterpret_cast<ProgramBinaryProc>(loadProcedure("glProgramBinary"));
+	programParameteri = reinterpret_cast<ProgramParameteriProc>(loadProcedure("glProgramParameteri"));
+
+	// Some drivers export the functions without supporting a single binary format
+	GLint formatCount = 0;
+	if (getProgramBinary != nullptr && programBinary != nullptr && programParameteri != nullptr)
+	{
+		glGetIntegerv(NumProgramBinaryFormats, &formatCount);
+	}
+
+	if (formatCount <= 0)
+	{
+		getProgramBinary = nullptr;
+		programBinary = nullptr;
+		programParameteri = nullptr;
+		return false;
+	}
+
+	// A driver update can change the binaries without changing the vendor or the renderer,
+	// so the version string is part of the key too
+	const GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	driver.clear();
+	for (GLenum name : names)
+	{
+		const GLubyte* text = glGetString(name);
+		driver += text != nullptr ? reinterpret_cast<const char*>(text) : "";
+		driver += '\n';
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Computes the key of a program.
+/// </summary>
+/// <param name="vertexSource">Vertex shader source, with its includes expanded and its defines inserted</param>
+/// <param name="fragmentSource">Fragment shader source, with its includes expanded and its defines inserted</param>
+/// <returns>Hash of both sources and of the driver</returns>
+std::uint64_t ProgramBinaryCache::GetKey(const std::string& vertexSource, const std::string& fragmentSource) const
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	HashText(hash, driver);
+	HashText(hash, vertexSource);
+	HashText(hash, fragmentSource);
+	return hash;
+}
+
+/// <summary>
+/// Loads the binary saved under a key into a program.
+/// </summary>
+/// <param name="key">Key returned by GetKey()</param>
+/// <param name="program">Program that was created but not linked</param>
+/// <returns>True if the driver accepted the binary, so the program is linked</returns>
+bool ProgramBinaryCache::Load(std::uint64_t key, GLuint program)
+{
+	if (programBinary == nullptr)
+	{
+		return false;
+	}
+
+	std::ifstream file(GetFilePath(key), std::ios::binary);
+	if (file.fail())
+	{
+		return false;
+	}
+
+	ProgramBinaryFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || std::memcmp(header.magic, "PGB1", 4) != 0 || header.key != key || header.length == 0 || header.length > (1u << 30))
+	{
+		return false;
+	}
+
+	std::vector<char> binary(static_cast<std::size_t>(header.length));
+	file.read(binary.data(), binary.size());
+	if (!file)
+	{
+		return false;
+	}
+
+	// A binary from another driver fails like a link error. It also raises GL_INVALID_ENUM
+	// when the format is unknown, which is cleared so it is not blamed on a later call.
+	programBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+	glGetError();
+
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE)
+	{
+		return false;
+	}
+
+	loadedCount++;
+	return true;
+}
+
+/// <summary>
+/// Asks the driver to keep the binary of a program it is about to link, so Save() can read it back.
+/// </summary>
+/// <param name="program">Program that is about to be linked</param>
+void ProgramBinaryCache::PrepareLink(GLuint program) const
+{
+	if (programParameteri != nullptr)
+	{
+		programParameteri(program, ProgramBinaryRetrievableHint, GL_TRUE);
+	}
+}
+
+/// <summary>
+/// Saves the binary of a linked program under a key, replacing any previous binary.
+/// </summary>
+/// <param name="key">Key returned by GetKey()</param>
+/// <param name="program">Program linked after a call to PrepareLink()</param>
+/// <returns>True if the file was written</returns>
+bool ProgramBinaryCache::Save(std::uint64_t key, GLuint program)
+{
+	if (getProgramBinary == nullptr)
+	{
+		return false;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, ProgramBinaryLength, &length);
+	if (length <= 0)
+	{
+		return false;
+	}
+
+	std::vector<char> binary(static_cast<std::size_t>(length));
+	GLsizei writtenLength = 0;
+	GLenum format = 0;
+	getProgramBinary(program, length, &writtenLength, &format, binary.data());
+	if (writtenLength <= 0)
+	{
+		return false;
+	}
+
+	std::ofstream file(GetFilePath(key), std::ios::binary);
+	if (file.fail())
+	{
+		return false;
+	}
+
+	ProgramBinaryFileHeader header;
+	std::memcpy(header.magic, "PGB1", 4);
+	header.format = format;
+	header.key = key;
+	header.length = static_cast<std::uint64_t>(writtenLength);
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), writtenLength);
+	if (!file)
+	{
+		return false;
+	}
+
+	savedCount++;
+	return true;
+}
+
+/// <summary>
+/// Path of the file holding the binary of a key.
+/// </summary>
+/// <param name="key">Key returned by GetKey()</param>
+/// <returns>Path of the file, named after the key</returns>
+std::string ProgramBinaryCache::GetFilePath(std::uint64_t key) const
+{
+	char name[48];
+	std::snprintf(name, sizeof(name), "program_%016llx.glbin", static_cast<unsigned long long>(key));
+	return cacheDirectory + name;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <string>
+
+/// <summary>
+/// On-disk cache of linked shader programs, so later launches skip compiling and linking
+/// them. Each program is saved with glGetProgramBinary() under a key that hashes its
+/// preprocessed sources together with the vendor, renderer and version strings of the
+/// driver, since a binary only loads on the driver that produced it. A binary the driver
+/// rejects anyway, after an update for instance, is compiled from source again and replaced.
+/// The entry points are core in OpenGL 4.1 and come from ARB_get_program_binary before that;
+/// the loader only covers OpenGL 3.3, so they are looked up at runtime and the cache stays
+/// off when the driver does not have them.
+/// </summary>
+class ProgramBinaryCache
+{
+public:
+	/// <summary>
+	/// Looks up the program binary entry points and reads the strings identifying the driver.
+	/// </summary>
+	/// <param name="loadProcedure">Function returning the address of an OpenGL function, such as glfwGetProcAddress</param>
+	/// <param name="directory">Directory the binaries are stored in, ending with a slash, or empty for the working directory</param>
+	/// <returns>True if the driver can save program binaries, false if the cache stays off</returns>
+	bool Create(GLADloadproc loadProcedure, const std::string& directory = "");
+
+	/// <summary>
+	/// Computes the key of a program.
+	/// </summary>
+	/// <param name="vertexSource">Vertex shader source, with its includes expanded and its defines inserted</param>
+	/// <param name="fragmentSource">Fragment shader source, with its includes expanded and its defines inserted</param>
+	/// <returns>Hash of both sources and of the driver</returns>
+	std::uint64_t GetKey(const std::string& vertexSource, const std::string& fragmentSource) const;
+
+	/// <summary>
+	/// Loads the binary saved under a key into a program.
+	/// </summary>
+	/// <param name="key">Key returned by GetKey()</param>
+	/// <param name="program">Program that was created but not linked</param>
+	/// <returns>True if the driver accepted the binary, so the program is linked</returns>
+	bool Load(std::uint64_t key, GLuint program);
+
+	/// <summary>
+	/// Asks the driver to keep the binary of a program it is about to link, so Save() can read it back.
+	/// </summary>
+	/// <param name="program">Program that is about to be linked</param>
+	void PrepareLink(GLuint program) const;
+
+	/// <summary>
+	/// Saves the binary of a linked program under a key, replacing any previous binary.
+	/// </summary>
+	/// <param name="key">Key returned by GetKey()</param>
+	/// <param name="program">Program linked after a call to PrepareLink()</param>
+	/// <returns>True if the file was written</returns>
+	bool Save(std::uint64_t key, GLuint program);
+
+	/// <summary>
+	/// Number of programs loaded from the cache instead of being compiled
+	/// </summary>
+	int GetLoadedCount() const { return loadedCount; }
+
+	/// <summary>
+	/// Number of programs compiled and saved to the cache
+	/// </summary>
+	int GetSavedCount() const { return savedCount; }
+
+private:
+	typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufferSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+	typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+	typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum name, GLint value);
+
+	/// <summary>
+	/// Path of the file holding the binary of a key.
+	/// </summary>
+	/// <param name="key">Key returned by GetKey()</param>
+	/// <returns>Path of the file, named after the key</returns>
+	std::string GetFilePath(std::uint64_t key) const;
+
+	GetProgramBinaryProc getProgramBinary = nullptr;
+	ProgramBinaryProc programBinary = nullptr;
+	ProgramParameteriProc programParameteri = nullptr;
+
+	std::string driver;				// Vendor, renderer and version strings, part of every key
+	std::string cacheDirectory;
+	int loadedCount = 0;
+	int savedCount = 0;
+};
@@ -0,0 +1,52 @@
+#include "Scene.h"
+
+/// <summary>
+/// Builds the cube that every tile is a face of, centered on the origin with sides of 2 units.
+/// Each face has its own 4 vertices and 2 triangles, and the faces are in TileFace order.
+/// The normals point towards the center of the cube, which is the side the tile is seen from.
+/// </summary>
+/// <param name="vertices">Receives the 24 vertices</param>
+/// <param name="indices">Receives 6 indices per face</param>
+void BuildCubeGeometry(std::vector<MeshVertex>& vertices, std::vector<GLuint>& indices)
+{
+	// Position and UV coordinate of the 4 corners of each face, in triangle strip order
+	const GLfloat corners[TileFaceCount][4][5] = {
+		//BACK FACING FORWARD
+		{ { -1.0f, -1.0f, -1.0f,	0.0f, 0.0f }, { 1.0f, -1.0f, -1.0f,	1.0f, 0.0f }, { -1.0f, 1.0f, -1.0f,	0.0f, 1.0f }, { 1.0f, 1.0f, -1.0f,	1.0f, 1.0f } },
+		//FRONT FACING FORWARD
+		{ { 1.0f, 1.0f, 1.0f,		0.0f, 1.0f }, { 1.0f, -1.0f, 1.0f,	0.0f, 0.0f }, { -1.0f, 1.0f, 1.0f,	1.0f, 1.0f }, { -1.0f, -1.0f, 1.0f,	1.0f, 0.0f } },
+		//CEILING
+		{ { -1.0f, 1.0f, -1.0f,		0.0f, 0.0f }, { -1.0f, 1.0f, 1.0f,	0.0f, 1.0f }, { 1.0f, 1.0f, -1.0f,	1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f,	1.0f, 1.0f } },
+		//FLOOR
+		{ { -1.0f, -1.0f, -1.0f,	0.0f, 0.0f }, { -1.0f, -1.0f, 1.0f,	0.0f, 1.0f }, { 1.0f, -1.0f, -1.0f,	1.0f, 0.0f }, { 1.0f, -1.0f, 1.0f,	1.0f, 1.0f } },
+		//LEFT WALL
+		{ { -1.0f, -1.0f, 1.0f,		0.0f, 0.0f }, { -1.0f, 1.0f, 1.0f,	0.0f, 1.0f }, { -1.0f, -1.0f, -1.0f,	1.0f, 0.0f }, { -1.0f, 1.0f, -1.0f,	1.0f, 1.0f } },
+		//RIGHT WALL
+		{ { 1.0f, -1.0f, -1.0f,		0.0f, 0.0f }, { 1.0f, 1.0f, -1.0f,	0.0f, 1.0f }, { 1.0f, -1.0f, 1.0f,	1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f,	1.0f, 1.0f } },
+	};
+
+	const glm::vec3 normals[TileFaceCount] = {
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3(-1.0f, 0.0f, 0.0f),
+	};
+
+	vertices.clear();
+	indices.clear();
+	for (int face = 0; face < TileFaceCount; face++)
+	{
+		GLuint first = static_cast<GLuint>(vertices.size());
+		for (int i = 0; i < 4; i++)
+		{
+			const GLfloat* corner = corners[face][i];
+			vertices.push_back({ glm::vec3(corner[0], corner[1], corner[2]), glm::vec2(corner[3], corner[4]), normals[face] });
+		}
+
+		// The two triangles of the 4-vertex strip, with the same winding as the strip
+		GLuint quad[6] = { first, first + 1, first + 2, first + 2, first + 1, first + 3 };
+		indices.insert(indices.end(), quad, quad + 6);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Mesh.h"
+
+/// <summary>
+/// Faces of the cube that every tile is drawn from. The value of each face is
+/// also the index of its submesh in the cube mesh.
+/// </summary>
+enum class TileFace
+{
+	Back = 0,		// z = -1 side
+	Front = 1,		// z = +1 side
+	Ceiling = 2,	// y = +1 side
+	Floor = 3,		// y = -1 side
+	Left = 4,		// x = -1 side
+	Right = 5,		// x = +1 side
+};
+
+/// <summary>
+/// Number of faces of the cube
+/// </summary>
+const int TileFaceCount = 6;
+
+/// <summary>
+/// A single floor tile or wall segment of the maze
+/// </summary>
+struct Tile
+{
+	glm::vec3 position;	// Translation applied to the cube
+	TileFace face;		// Which face of the cube is drawn
+};
+
+/// <summary>
+/// Builds the cube that every tile is a face of, centered on the origin with sides of 2 units.
+/// Each face has its own 4 vertices and 2 triangles, and the faces are in TileFace order.
+/// The normals point towards the center of the cube, which is the side the tile is seen from.
+/// </summary>
+/// <param name="vertices">Receives the 24 vertices</param>
+/// <param name="indices">Receives 6 indices per face</param>
+void BuildCubeGeometry(std::vector<MeshVertex>& vertices, std::vector<GLuint>& indices);
@@ -0,0 +1,387 @@
+#include "ShaderProgram.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+#include "ProgramBinaryCache.h"
+
+namespace
+{
+	// Cache of linked programs, or nullptr when every program is compiled
+	ProgramBinaryCache* programBinaryCache = nullptr;
+}
+
+/// <summary>
+/// Creates the program from the provided vertex and fragment shader files,
+/// then reflects its active uniforms and attributes.
+/// </summary>
+/// <param name="vertexShaderFilePath">Vertex shader file path</param>
+/// <param name="fragmentShaderFilePath">Fragment shader file path</param>
+/// <param name="defines">Preprocessor symbols to define, such as the name of a shader variant</param>
+/// <returns>True if the program linked successfully</returns>
+bool ShaderProgram::Create(const std::string& vertexShaderFilePath, const std::string& fragmentShaderFilePath,
+	const std::vector<std::string>& defines)
+{
+	program = CreateShaderProgram(vertexShaderFilePath, fragmentShaderFilePath, defines);
+
+	GLint linkStatus;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE)
+	{
+		return false;
+	}
+
+	Reflect();
+	return true;
+}
+
+/// <summary>
+/// Deletes the OpenGL program and forgets all reflected data.
+/// </summary>
+void ShaderProgram::Destroy()
+{
+	glDeleteProgram(program);
+	program = 0;
+	uniforms.clear();
+	attributes.clear();
+}
+
+/// <summary>
+/// Makes this the current program. Uniforms can only be assigned while the program is in use.
+/// </summary>
+void ShaderProgram::Use() const
+{
+	glUseProgram(program);
+}
+
+/// <summary>
+/// Connects a uniform block of the program to a uniform buffer binding point.
+/// </summary>
+/// <param name="blockName">Name of the uniform block in the shader source</param>
+/// <param name="binding">Binding point the block will read its buffer from</param>
+/// <returns>True if the program uses the block</returns>
+bool ShaderProgram::SetUniformBlockBinding(const std::string& blockName, GLuint binding)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(program, blockName.c_str());
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		return false;
+	}
+
+	glUniformBlockBinding(program, blockIndex, binding);
+	return true;
+}
+
+/// <summary>
+/// Looks up the location of an active vertex attribute by name.
+/// </summary>
+/// <param name="name">Name of the attribute in the shader source</param>
+/// <returns>Attribute location, or -1 if the program does not use the attribute</returns>
+GLint ShaderProgram::GetAttributeLocation(const std::string& name) const
+{
+	for (const AttributeSlot& attribute : attributes)
+	{
+		if (attribute.name == name)
+		{
+			return attribute.location;
+		}
+	}
+
+	return -1;
+}
+
+/// <summary>
+/// Queries every active uniform and attribute of the linked program and stores their
+/// names, types and locations, so that nothing has to be looked up by name afterwards.
+/// </summary>
+void ShaderProgram::Reflect()
+{
+	uniforms.clear();
+	attributes.clear();
+
+	char name[256];
+
+	GLint uniformCount = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLsizei nameLen = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program, i, sizeof(name), &nameLen, &size, &type, name);
+
+		UniformSlot slot;
+		slot.name.assign(name, nameLen);
+		slot.location = glGetUniformLocation(program, name);
+		slot.type = type;
+		slot.hasValue = false;
+
+		// Uniforms inside uniform blocks have no location and cannot be assigned individually
+		if (slot.location < 0)
+		{
+			continue;
+		}
+
+		// Arrays are reported as "name[0]"; refer to them by their plain name
+		std::string::size_type bracket = slot.name.find('[');
+		if (bracket != std::string::npos)
+		{
+			slot.name.erase(bracket);
+		}
+
+		uniforms.push_back(slot);
+	}
+
+	GLint attributeCount = 0;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+	for (GLint i = 0; i < attributeCount; i++)
+	{
+		GLsizei nameLen = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveAttrib(program, i, sizeof(name), &nameLen, &size, &type, name);
+
+		AttributeSlot slot;
+		slot.name.assign(name, nameLen);
+		slot.location = glGetAttribLocation(program, name);
+		slot.type = type;
+		attributes.push_back(slot);
+	}
+}
+
+/// <summary>
+/// Finds the index of an active uniform in the uniform table.
+/// </summary>
+/// <param name="name">Name of the uniform</param>
+/// <param name="type">GLSL type the caller expects the uniform to have</param>
+/// <returns>Index of the uniform, or -1 if it is not active or its type does not match</returns>
+int ShaderProgram::FindUniform(const std::string& name, GLenum type) const
+{
+	for (std::size_t i = 0; i < uniforms.size(); i++)
+	{
+		const UniformSlot& slot = uniforms[i];
+		if (slot.name != name)
+		{
+			continue;
+		}
+
+		// Samplers are assigned texture units with glUniform1i()
+		bool isSampler = slot.type == GL_SAMPLER_2D || slot.type == GL_SAMPLER_2D_SHADOW || slot.type == GL_SAMPLER_2D_ARRAY
+			|| slot.type == GL_SAMPLER_CUBE || slot.type == GL_SAMPLER_CUBE_SHADOW
+			|| slot.type == GL_SAMPLER_BUFFER || slot.type == GL_INT_SAMPLER_BUFFER
+			|| slot.type == GL_UNSIGNED_INT_SAMPLER_BUFFER || slot.type == GL_SAMPLER_3D;
+		if (slot.type != type && !(type == GL_INT && isSampler))
+		{
+			std::cerr << "uniform type mismatch: " << name << std::endl;
+			return -1;
+		}
+
+		return static_cast<int>(i);
+	}
+
+	return -1;
+}
+
+/// <summary>
+/// Makes CreateShaderProgram() load the programs it already linked on a previous launch from
+/// a cache of program binaries, and save the ones it has to compile.
+/// </summary>
+/// <param name="cache">Cache to use, which must outlive every call to CreateShaderProgram(), or nullptr to always compile</param>
+void SetProgramBinaryCache(ProgramBinaryCache* cache)
+{
+	programBinaryCache = cache;
+}
+
+/// <summary>
+/// Creates a shader program based on the provided file paths for the vertex and fragment shaders.
+/// The linked program is taken from the program binary cache when it holds one for the same sources.
+/// </summary>
+/// <param name="vertexShaderFilePath">Vertex shader file path</param>
+/// <param name="fragmentShaderFilePath">Fragment shader file path</param>
+/// <param name="defines">Preprocessor symbols to define, such as the name of a shader variant</param>
+/// <returns>OpenGL handle to the created shader program</returns>
+GLuint CreateShaderProgram(const std::string& vertexShaderFilePath, const std::string& fragmentShaderFilePath,
+	const std::vector<std::string>& defines)
+{
+	// The key covers the sources as the driver would see them, so editing a shader or one of
+	// its includes, or compiling another variant, never picks up a stale binary
+	std::string vertexSource;
+	std::string fragmentSource;
+	bool loaded = LoadShaderSource(vertexShaderFilePath, vertexSource) && LoadShaderSource(fragmentShaderFilePath, fragmentSource);
+	vertexSource = AddDefines(vertexSource, defines);
+	fragmentSource = AddDefines(fragmentSource, defines);
+
+	GLuint program = glCreateProgram();
+	std::uint64_t key = 0;
+	if (programBinaryCache != nullptr && loaded)
+	{
+		key = programBinaryCache->GetKey(vertexSource, fragmentSource);
+		if (programBinaryCache->Load(key, program))
+		{
+			return program;
+		}
+	}
+
+	// A rejected binary leaves the program unlinked, so it is compiled from source as if there were no cache
+	GLuint vertexShader = CreateShaderFromSource(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragmentShader = CreateShaderFromSource(GL_FRAGMENT_SHADER, fragmentSource);
+
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+
+	if (programBinaryCache != nullptr)
+	{
+		programBinaryCache->PrepareLink(program);
+	}
+	glLinkProgram(program);
+
+	glDetachShader(program, vertexShader);
+	glDeleteShader(vertexShader);
+	glDetachShader(program, fragmentShader);
+	glDeleteShader(fragmentShader);
+
+	// Check shader program link status
+	GLint linkStatus;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE) {
+		char infoLog[512];
+		GLsizei infoLogLen = sizeof(infoLog);
+		glGetProgramInfoLog(program, infoLogLen, &infoLogLen, infoLog);
+		std::cerr << "program link error: " << infoLog << std::endl;
+	}
+	else if (programBinaryCache != nullptr && loaded && !programBinaryCache->Save(key, program))
+	{
+		std::cerr << "Failed to save the binary of " << vertexShaderFilePath << " and " << fragmentShaderFilePath << std::endl;
+	}
+
+	return program;
+}
+
+/// <summary>
+/// Creates a shader based on the provided shader type and the path to the file containing the shader source.
+/// </summary>
+/// <param name="shaderType">Shader type</param>
+/// <param name="shaderFilePath">Path to the file containing the shader source</param>
+/// <param name="defines">Preprocessor symbols to define, such as the name of a shader variant</param>
+/// <returns>OpenGL handle to the created shader</returns>
+GLuint CreateShaderFromFile(const GLuint& shaderType, const std::string& shaderFilePath,
+	const std::vector<std::string>& defines)
+{
+	std::string shaderSource;
+	if (!LoadShaderSource(shaderFilePath, shaderSource))
+	{
+		return 0;
+	}
+
+	return CreateShaderFromSource(shaderType, shaderSource, defines);
+}
+
+/// <summary>
+/// Reads a shader source file. Lines of the form #include "file" are replaced with the
+/// contents of that file (relative to the including file), so that declarations shared
+/// by several shaders, such as uniform blocks, only need to be written once.
+/// </summary>
+/// <param name="shaderFilePath">Path to the file containing the shader source</param>
+/// <param name="shaderSource">Receives the shader source with all includes expanded</param>
+/// <returns>True if the file and all of its includes could be read</returns>
+bool LoadShaderSource(const std::string& shaderFilePath, std::string& shaderSource)
+{
+	std::ifstream shaderFile(shaderFilePath);
+	if (shaderFile.fail())
+	{
+		std::cerr << "Unable to open shader file: " << shaderFilePath << std::endl;
+		return false;
+	}
+
+	std::string directory;
+	std::string::size_type slash = shaderFilePath.find_last_of("/\\");
+	if (slash != std::string::npos)
+	{
+		directory = shaderFilePath.substr(0, slash + 1);
+	}
+
+	std::string temp;
+	while (std::getline(shaderFile, temp))
+	{
+		std::string::size_type open = temp.find('"');
+		std::string::size_type close = temp.rfind('"');
+		if (temp.compare(0, 8, "#include") == 0 && open != std::string::npos && close > open)
+		{
+			if (!LoadShaderSource(directory + temp.substr(open + 1, close - open - 1), shaderSource))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		shaderSource += temp + "\n";
+	}
+	shaderFile.close();
+
+	return true;
+}
+
+/// <summary>
+/// Creates a shader based on the provided shader type and the string containing the shader source.
+/// The defines are inserted right after the #version line.
+/// </summary>
+/// <param name="shaderType">Shader type</param>
+/// <param name="shaderSource">Shader source string</param>
+/// <param name="defines">Preprocessor symbols to define, such as the name of a shader variant</param>
+/// <returns>OpenGL handle to the created shader</returns>
+GLuint CreateShaderFromSource(const GLuint& shaderType, const std::string& shaderSource,
+	const std::vector<std::string>& defines)
+{
+	std::string source = AddDefines(shaderSource, defines);
+
+	GLuint shader = glCreateShader(shaderType);
+
+	const char* shaderSourceCStr = source.c_str();
+	GLint shaderSourceLen = static_cast<GLint>(source.length());
+	glShaderSource(shader, 1, &shaderSourceCStr, &shaderSourceLen);
+	glCompileShader(shader);
+
+	// Check compilation status
+	GLint compileStatus;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus);
+	if (compileStatus == GL_FALSE)
+	{
+		char infoLog[512];
+		GLsizei infoLogLen = sizeof(infoLog);
+		glGetShaderInfoLog(shader, infoLogLen, &infoLogLen, infoLog);
+		std::cerr << "shader compilation error: " << infoLog << std::endl;
+	}
+
+	return shader;
+}
+
+/// <summary>
+/// Inserts preprocessor symbols into a shader source, right after the #version line.
+/// </summary>
+/// <param name="shaderSource">Shader source string</param>
+/// <param name="defines">Preprocessor symbols to define, such as the name of a shader variant</param>
+/// <returns>Shader source with one #define line per symbol</returns>
+std::string AddDefines(const std::string& shaderSource, const std::vector<std::string>& defines)
+{
+	// #version must stay the first statement, so the defines go on the lines after it
+	std::string source = shaderSource;
+	if (!defines.empty())
+	{
+		std::string::size_type insertAt = 0;
+		if (source.compare(0, 8, "#version") == 0)
+		{
+			insertAt = source.find('\n');
+			insertAt = insertAt == std::string::npos ? source.length() : insertAt + 1;
+		}
+
+		std::string defineLines;
+		for (const std::string& define : defines)
+		{
+			defineLines += "#define " + define + "\n";
+		}
+		source.insert(insertAt, defineLines);
+	}
+
+	return source;
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class ProgramBinaryCache;
+
+/// <summary>
+/// Makes CreateShaderProgram() load the programs it already linked on a previous launch from
+/// a cache of program binaries, and save the ones it has to compile.
+/// </summary>
+/// <param name="cache">Cache to use, which must outlive every call to CreateShaderProgram(), or nullptr to always compile</param>
+void SetProgramBinaryCache(ProgramBinaryCache* cache);
+
+/// <summary>
+/// Creates a shader program based on the provided file paths for the vertex and fragment shaders.
+/// The linked program is taken from the program binary cache when it holds one for the same sources.
+/// </summary>
+/// <param name="vertexShaderFilePath">Vertex shader file path</param>
+/// <param name="fragmentShaderFilePath">Fragment shader file path</param>
+/// <param name="defines">Preprocessor symbols to define, such as the name of a shader variant</param>
+/// <returns>OpenGL handle to the created shader program</returns>
+GLuint CreateShaderProgram(const std::string& vertexShaderFilePath, const std::string& fragmentShaderFilePath,
+	const std::vector<std::string>& defines = {});
+
+/// <summary>
+/// Creates a shader based on the provided shader type and the path to the file containing the shader source.
+/// </summary>
+/// <param name="shaderType">Shader type</param>
+/// <param name="shaderFilePath">Path to the file containing the shader source</param>
+/// <param name="defines">Preprocessor symbols to define, such as the name of a shader variant</param>
+/// <returns>OpenGL handle to the created shader</returns>
+GLuint CreateShaderFromFile(const GLuint& shaderType, const std::string& shaderFilePath,
+	const std::vector<std::string>& defines = {});
+
+/// <summary>
+/// Creates a shader based on the provided shader type and the string containing the shader source.
+/// The defines are inserted right after the #version line.
+/// </summary>
+/// <param name="shaderType">Shader type</param>
+/// <param name="shaderSource">Shader source string</param>
+/// <param name="defines">Preprocessor symbols to define, such as the name of a shader variant</param>
+/// <returns>OpenGL handle to the created shader</returns>
+GLuint CreateShaderFromSource(const GLuint& shaderType, const std::string& shaderSource,
+	const std::vector<std::string>& defines = {});
+
+/// <summary>
+/// Inserts preprocessor symbols into a shader source, right after the #version line.
+/// </summary>
+/// <param name="shaderSource">Shader source string</param>
+/// <param name="defines">Preprocessor symbols to define, such as the name of a shader variant</param>
+/// <returns>Shader source with one #define line per symbol</returns>
+std::string AddDefines(const std::string& shaderSource, const std::vector<std::string>& defines);
+
+/// <summary>
+/// Reads a shader source file. Lines of the form #include "file" are replaced with the
+/// contents of that file (relative to the including file), so that declarations shared
+/// by several shaders, such as uniform blocks, only need to be written once.
+/// </summary>
+/// <param name="shaderFilePath">Path to the file containing the shader source</param>
+/// <param name="shaderSource">Receives the shader source with all includes expanded</param>
+/// <returns>True if the file and all of its includes could be read</returns>
+bool LoadShaderSource(const std::string& shaderFilePath, std::string& shaderSource);
+
+/// <summary>
+/// Handle to a uniform of a ShaderProgram, resolved once after linking.
+/// The template parameter is the C++ type of the values that will be assigned to it.
+/// </summary>
+template <typename T>
+struct UniformHandle
+{
+	int index = -1;	// Index into the program's uniform table, or -1 if the uniform is not active
+
+	bool IsValid() const { return index >= 0; }
+};
+
+/// <summary>
+/// Shader program that reflects all of its active uniforms and attributes once at link time.
+/// Uniforms are assigned through pre-resolved handles, and the last value assigned to each
+/// uniform is shadowed on the CPU, so assigning a value that has not changed does not call
+/// glUniform*() again.
+/// </summary>
+class ShaderProgram
+{
+public:
+	/// <summary>
+	/// Creates the program from the provided vertex and fragment shader files,
+	/// then reflects its active uniforms and attributes.
+	/// </summary>
+	/// <param name="vertexShaderFilePath">Vertex shader file path</param>
+	/// <param name="fragmentShaderFilePath">Fragment shader file path</param>
+	/// <param name="defines">Preprocessor symbols to define, such as the name of a shader variant</param>
+	/// <returns>True if the program linked successfully</returns>
+	bool Create(const std::string& vertexShaderFilePath, const std::string& fragmentShaderFilePath,
+		const std::vector<std::string>& defines = {});
+
+	/// <summary>
+	/// Deletes the OpenGL program and forgets all reflected data.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Makes this the current program. Uniforms can only be assigned while the program is in use.
+	/// </summary>
+	void Use() const;
+
+	/// <summary>
+	/// OpenGL handle to the program
+	/// </summary>
+	GLuint GetId() const { return program; }
+
+	/// <summary>
+	/// Looks up an active uniform by name. This is meant to be called once during setup,
+	/// not every frame. An invalid handle is returned if the program does not use the
+	/// uniform, or if its GLSL type does not match T; assigning to it does nothing.
+	/// </summary>
+	/// <param name="name">Name of the uniform in the shader source</param>
+	/// <returns>Handle to the uniform</returns>
+	template <typename T>
+	UniformHandle<T> GetUniform(const std::string& name) const
+	{
+		UniformHandle<T> handle;
+		handle.index = FindUniform(name, UniformType<T>());
+		return handle;
+	}
+
+	/// <summary>
+	/// Connects a uniform block of the program to a uniform buffer binding point.
+	/// </summary>
+	/// <param name="blockName">Name of the uniform block in the shader source</param>
+	/// <param name="binding">Binding point the block will read its buffer from</param>
+	/// <returns>True if the program uses the block</returns>
+	bool SetUniformBlockBinding(const std::string& blockName, GLuint binding);
+
+	/// <summary>
+	/// Looks up the location of an active vertex attribute by name.
+	/// </summary>
+	/// <param name="name">Name of the attribute in the shader source</param>
+	/// <returns>Attribute location, or -1 if the program does not use the attribute</returns>
+	GLint GetAttributeLocation(const std::string& name) const;
+
+	/// <summary>
+	/// Assigns a value to a uniform. The glUniform*() call is skipped if the uniform
+	/// already holds that value. The program must be in use.
+	/// </summary>
+	/// <param name="handle">Handle returned by GetUniform()</param>
+	/// <param name="value">New value of the uniform</param>
+	template <typename T>
+	void Set(UniformHandle<T> handle, const T& value)
+	{
+		if (handle.index < 0)
+		{
+			return;
+		}
+
+		UniformSlot& slot = uniforms[handle.index];
+		if (slot.hasValue && std::memcmp(slot.value, &value, sizeof(T)) == 0)
+		{
+			return;
+		}
+
+		std::memcpy(slot.value, &value, sizeof(T));
+		slot.hasValue = true;
+		Upload(slot.location, value);
+	}
+
+private:
+	/// <summary>
+	/// Reflected data and shadowed value of an active uniform
+	/// </summary>
+	struct UniformSlot
+	{
+		std::string name;
+		GLint location;
+		GLenum type;
+		bool hasValue;							// False until the first value is assigned
+		alignas(16) unsigned char value[64];	// Last value assigned, large enough for a mat4
+	};
+
+	/// <summary>
+	/// Reflected data of an active vertex attribute
+	/// </summary>
+	struct AttributeSlot
+	{
+		std::string name;
+		GLint location;
+		GLenum type;
+	};
+
+	void Reflect();
+	int FindUniform(const std::string& name, GLenum type) const;
+
+	template <typename T> static GLenum UniformType();
+
+	static void Upload(GLint location, const GLint& value) { glUniform1i(location, value); }
+	static void Upload(GLint location, const GLfloat& value) { glUniform1f(location, value); }
+	static void Upload(GLint location, const glm::vec2& value) { glUniform2fv(location, 1, &value[0]); }
+	static void Upload(GLint location, const glm::vec3& value) { glUniform3fv(location, 1, &value[0]); }
+	static void Upload(GLint location, const glm::vec4& value) { glUniform4fv(location, 1, &value[0]); }
+	static void Upload(GLint location, const glm::mat3& value) { glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]); }
+	static void Upload(GLint location, const glm::mat4& value) { glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]); }
+
+	GLuint program = 0;
+	std::vector<UniformSlot> uniforms;
+	std::vector<AttributeSlot> attributes;
+};
+
+template <> inline GLenum ShaderProgram::UniformType<GLint>() { return GL_INT; }
+template <> inline GLenum ShaderProgram::UniformType<GLfloat>() { return GL_FLOAT; }
+template <> inline GLenum ShaderProgram::UniformType<glm::vec2>() { return GL_FLOAT_VEC2; }
+template <> inline GLenum ShaderProgram::UniformType<glm::vec3>() { return GL_FLOAT_VEC3; }
+template <> inline GLenum ShaderProgram::UniformType<glm::vec4>() { return GL_FLOAT_VEC4; }
+template <> inline GLenum ShaderProgram::UniformType<glm::mat3>() { return GL_FLOAT_MAT3; }
+template <> inline GLenum ShaderProgram::UniformType<glm::mat4>() { return GL_FLOAT_MAT4; }
@@ -0,0 +1,99 @@
+#include "ShaderVariants.h"
+
+#include "FrameUniforms.h"
+
+/// <summary>
+/// Finds the cheapest class of transform that can represent a model matrix.
+/// </summary>
+/// <param name="model">Model matrix</param>
+/// <returns>Class of the matrix</returns>
+TransformClass ClassifyTransform(const glm::mat4& model)
+{
+	const float epsilon = 1e-5f;
+
+	glm::vec4 bottomRow(model[0][3], model[1][3], model[2][3], model[3][3]);
+	if (glm::any(glm::greaterThan(glm::abs(bottomRow - glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)), glm::vec4(epsilon))))
+	{
+		return TransformClass::General;
+	}
+
+	glm::mat3 linear(model);
+	bool identity = true;
+	bool orthonormal = true;
+	glm::mat3 product = glm::transpose(linear) * linear;
+	for (int column = 0; column < 3; column++)
+	{
+		glm::vec3 unit(0.0f);
+		unit[column] = 1.0f;
+		identity = identity && glm::all(glm::lessThanEqual(glm::abs(linear[column] - unit), glm::vec3(epsilon)));
+		orthonormal = orthonormal && glm::all(glm::lessThanEqual(glm::abs(product[column] - unit), glm::vec3(epsilon)));
+	}
+
+	if (identity)
+	{
+		return TransformClass::Translation;
+	}
+
+	// A reflection is orthonormal too, but flips the winding of the triangles
+	if (orthonormal && glm::determinant(linear) > 0.0f)
+	{
+		return TransformClass::Rigid;
+	}
+
+	return TransformClass::General;
+}
+
+/// <summary>
+/// Computes the matrix that the general shader variant applies to the translation of a tile,
+/// for a model matrix that does not fit the cheaper classes.
+/// </summary>
+/// <param name="model">Model matrix</param>
+/// <returns>Transpose of the inverse of the model matrix</returns>
+glm::mat4 ComputeNormalMatrix(const glm::mat4& model)
+{
+	return glm::transpose(glm::inverse(model));
+}
+
+/// <summary>
+/// Compiles every variant of the program and connects each to the frame uniform block.
+/// </summary>
+/// <param name="vertexShaderFilePath">Vertex shader file path</param>
+/// <param name="fragmentShaderFilePath">Fragment shader file path</param>
+/// <param name="extraDefines">Preprocessor symbols defined in every variant, such as optional features</param>
+/// <returns>True if every variant linked successfully</returns>
+bool ShaderVariants::Create(const std::string& vertexShaderFilePath, const std::string& fragmentShaderFilePath,
+	const std::vector<std::string>& extraDefines)
+{
+	const char* defines[TransformClassCount] = { "TRANSFORM_TRANSLATION", "TRANSFORM_RIGID", "TRANSFORM_GENERAL" };
+
+	bool success = true;
+	for (int i = 0; i < TransformClassCount; i++)
+	{
+		std::vector<std::string> variantDefines = extraDefines;
+		variantDefines.push_back(defines[i]);
+		success = variants[i].Create(vertexShaderFilePath, fragmentShaderFilePath, variantDefines) && success;
+		variants[i].SetUniformBlockBinding("FrameUniforms", FrameUniformsBinding);
+	}
+
+	return success;
+}
+
+/// <summary>
+/// Uses the variant for a class of transform.
+/// </summary>
+/// <param name="transformClass">Class of the model matrices about to be drawn</param>
+void ShaderVariants::Use(TransformClass transformClass)
+{
+	variants[static_cast<int>(transformClass)].Use();
+}
+
+/// <summary>
+/// Deletes every variant.
+/// </summary>
+void ShaderVariants::Destroy()
+{
+	for (ShaderProgram& variant : variants)
+	{
+		variant.Destroy();
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "ShaderProgram.h"
+
+/// <summary>
+/// Kind of model matrix, from the cheapest to the most expensive to transform with
+/// </summary>
+enum class TransformClass
+{
+	Translation,	// Translation only
+	Rigid,			// Rotation followed by a translation
+	General,		// Anything else, such as scaling or shearing
+};
+
+const int TransformClassCount = 3;
+
+/// <summary>
+/// Finds the cheapest class of transform that can represent a model matrix.
+/// </summary>
+/// <param name="model">Model matrix</param>
+/// <returns>Class of the matrix</returns>
+TransformClass ClassifyTransform(const glm::mat4& model);
+
+/// <summary>
+/// Computes the matrix that the general shader variant applies to the translation of a tile,
+/// for a model matrix that does not fit the cheaper classes.
+/// </summary>
+/// <param name="model">Model matrix</param>
+/// <returns>Transpose of the inverse of the model matrix</returns>
+glm::mat4 ComputeNormalMatrix(const glm::mat4& model);
+
+/// <summary>
+/// One permutation of a shader program for each class of transform. Each variant is compiled
+/// from the same files with a different TRANSFORM_* symbol defined, so cheaper model matrices
+/// skip the matrix work they do not need.
+/// </summary>
+class ShaderVariants
+{
+public:
+	/// <summary>
+	/// Compiles every variant of the program and connects each to the frame uniform block.
+	/// </summary>
+	/// <param name="vertexShaderFilePath">Vertex shader file path</param>
+	/// <param name="fragmentShaderFilePath">Fragment shader file path</param>
+	/// <param name="extraDefines">Preprocessor symbols defined in every variant, such as optional features</param>
+	/// <returns>True if every variant linked successfully</returns>
+	bool Create(const std::string& vertexShaderFilePath, const std::string& fragmentShaderFilePath,
+		const std::vector<std::string>& extraDefines = {});
+
+	/// <summary>
+	/// Uses the variant for a class of transform.
+	/// </summary>
+	/// <param name="transformClass">Class of the model matrices about to be drawn</param>
+	void Use(TransformClass transformClass);
+
+	/// <summary>
+	/// Deletes every variant.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Returns the variant for a class of transform.
+	/// </summary>
+	ShaderProgram& Get(TransformClass transformClass) { return variants[static_cast<int>(transformClass)]; }
+
+private:
+	ShaderProgram variants[TransformClassCount];
+};
@@ -0,0 +1,176 @@
+#include "ShadowMap.h"
+
+#include <cstdio>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+
+namespace
+{
+	// Direction and up vector of each face, in the order of GL_TEXTURE_CUBE_MAP_POSITIVE_X + i.
+	// Cube maps are looked up with the faces seen from inside the cube, so the up vectors point
+	// down except on the two vertical faces.
+	const glm::vec3 FaceDirections[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	const glm::vec3 FaceUps[6] = { { 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 } };
+}
+
+/// <summary>
+/// Creates the depth cube map and compiles the program drawing the shadow casters.
+/// </summary>
+/// <param name="faceSize">Number of texels along each side of a face of the cube map</param>
+/// <param name="lightRange">Distance from the light beyond which nothing casts or receives shadows</param>
+/// <returns>True if the framebuffer is complete and the program linked successfully</returns>
+bool ShadowMap::Create(int faceSize, float lightRange)
+{
+	size = faceSize;
+	range = lightRange;
+	nearPlane = 0.1f;
+	upToDate = false;
+	renderCount = 0;
+	framesSinceRender = 0;
+
+	// Comparing in the sampler lets linear filtering blend four depth tests per fetch
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	for (int face = 0; face < 6; face++)
+	{
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	// Filtering across the edges of the faces keeps the seams of the cube out of the shadows
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X, texture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	if (!complete)
+	{
+		std::cerr << "Shadow map of " << size << " by " << size << " texels is incomplete" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	bool linked = casterShaders.Create("main.vsh", "depth.fsh", { "SHADOW_PASS" });
+	for (int i = 0; i < TransformClassCount; i++)
+	{
+		faceViewProjectionUniforms[i] = casterShaders.Get(static_cast<TransformClass>(i)).GetUniform<glm::mat4>("shadowViewProjection");
+	}
+
+	return complete && linked;
+}
+
+/// <summary>
+/// Points the sampler of a program compiled with GetShaderDefines() to the texture unit
+/// of the cube map, and gives it the projection of the faces.
+/// </summary>
+/// <param name="program">Program to set up</param>
+void ShadowMap::ConnectProgram(ShaderProgram& program) const
+{
+	program.Use();
+	program.Set(program.GetUniform<GLint>("shadowMap"), ShadowMapTextureUnit);
+	program.Set(program.GetUniform<glm::vec3>("shadowParameters"), glm::vec3(nearPlane, range, static_cast<float>(size)));
+}
+
+/// <summary>
+/// Finds the region of the scene that can cast shadows, which is the cube of the range
+/// around the light. Meant to gather the cells the casters are drawn from.
+/// </summary>
+/// <param name="lightPosition">World-space position of the light</param>
+/// <returns>Frustum made of the six sides of the cube</returns>
+Frustum ShadowMap::GetCasterFrustum(const glm::vec3& lightPosition) const
+{
+	// An orthographic projection maps a box to the clip volume, so its planes are the sides of the box
+	glm::mat4 box = glm::ortho(-range, range, -range, range, -range, range) * glm::translate(glm::mat4(1.0f), -lightPosition);
+	return Frustum::FromMatrix(box);
+}
+
+/// <summary>
+/// Draws the depth of the casters into every face of the cube map. The viewport and the
+/// framebuffer are restored afterwards.
+/// </summary>
+/// <param name="lightPosition">World-space position of the light</param>
+/// <param name="drawCasters">Draws the casters with the program variants it is given, once per face</param>
+void ShadowMap::Render(const glm::vec3& lightPosition, const std::function<void(ShaderVariants&)>& drawCasters)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, size, size);
+
+	// The slope of a surface seen at a grazing angle spreads one texel over a range of depths,
+	// which the offset pushes the stored depth past, so lit surfaces do not shadow themselves
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+
+	// Each face sees a quarter turn around the light, with square texels
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, range);
+	for (int face = 0; face < 6; face++)
+	{
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, texture, 0);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		glm::mat4 faceViewProjection = projection * glm::lookAt(lightPosition, lightPosition + FaceDirections[face], FaceUps[face]);
+		for (int i = 0; i < TransformClassCount; i++)
+		{
+			ShaderProgram& program = casterShaders.Get(static_cast<TransformClass>(i));
+			program.Use();
+			program.Set(faceViewProjectionUniforms[i], faceViewProjection);
+		}
+
+		drawCasters(casterShaders);
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	upToDate = true;
+	renderedLightPosition = lightPosition;
+	renderCount++;
+	framesSinceRender = 0;
+}
+
+/// <summary>
+/// Binds the cube map to its texture unit. Called once per frame.
+/// </summary>
+void ShadowMap::Bind()
+{
+	glActiveTexture(GL_TEXTURE0 + ShadowMapTextureUnit);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	glActiveTexture(GL_TEXTURE0);
+	framesSinceRender++;
+}
+
+/// <summary>
+/// Deletes the cube map, its framebuffer and the caster program.
+/// </summary>
+void ShadowMap::Destroy()
+{
+	glDeleteTextures(1, &texture);
+	glDeleteFramebuffers(1, &framebuffer);
+	texture = 0;
+	framebuffer = 0;
+	casterShaders.Destroy();
+	upToDate = false;
+}
+
+/// <summary>
+/// Formats the state of the shadow map.
+/// </summary>
+/// <returns>One line of text, such as "shadows drawn 3 times, reused by the last 120 frames"</returns>
+std::string ShadowMap::FormatReadout() const
+{
+	char text[96];
+	std::snprintf(text, sizeof(text), "shadows drawn %d times, reused by the last %d frames", renderCount, framesSinceRender);
+	return text;
+}
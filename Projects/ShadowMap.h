@@ -0,0 +1,109 @@
+#pragma once
+
+#include <functional>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "Frustum.h"
+#include "ShaderProgram.h"
+#include "ShaderVariants.h"
+
+/// <summary>
+/// Texture unit the scene reads the shadow map from. Units 1 to 7 hold the clustered lights,
+/// the G-buffer and the lightmap.
+/// </summary>
+const GLint ShadowMapTextureUnit = 8;
+
+/// <summary>
+/// Omnidirectional shadow of the point light at lightLoc. The depth of the scene seen from
+/// the light is drawn into the six faces of a depth cube map, which main.fsh samples with
+/// percentage-closer filtering (see shadow.glsl). The maze is static, so the cube map stays
+/// resident and is only drawn again when the light moved or when the geometry within its
+/// range changed, such as streamed chunks being loaded or evicted. On every other frame the
+/// shadows cost a few texture fetches per fragment and nothing on the CPU.
+/// </summary>
+class ShadowMap
+{
+public:
+	/// <summary>
+	/// Creates the depth cube map and compiles the program drawing the shadow casters.
+	/// </summary>
+	/// <param name="faceSize">Number of texels along each side of a face of the cube map</param>
+	/// <param name="lightRange">Distance from the light beyond which nothing casts or receives shadows</param>
+	/// <returns>True if the framebuffer is complete and the program linked successfully</returns>
+	bool Create(int faceSize, float lightRange);
+
+	/// <summary>
+	/// Preprocessor symbols that make main.fsh darken the light of lightLoc where the shadow map hides it.
+	/// </summary>
+	/// <returns>Symbols to pass to ShaderVariants::Create()</returns>
+	static std::vector<std::string> GetShaderDefines() { return { "SHADOW_MAPPING" }; }
+
+	/// <summary>
+	/// Points the sampler of a program compiled with GetShaderDefines() to the texture unit
+	/// of the cube map, and gives it the projection of the faces.
+	/// </summary>
+	/// <param name="program">Program to set up</param>
+	void ConnectProgram(ShaderProgram& program) const;
+
+	/// <summary>
+	/// Finds the region of the scene that can cast shadows, which is the cube of the range
+	/// around the light. Meant to gather the cells the casters are drawn from.
+	/// </summary>
+	/// <param name="lightPosition">World-space position of the light</param>
+	/// <returns>Frustum made of the six sides of the cube</returns>
+	Frustum GetCasterFrustum(const glm::vec3& lightPosition) const;
+
+	/// <summary>
+	/// Forces the next call to NeedsUpdate() to return true, for when the casters changed.
+	/// </summary>
+	void Invalidate() { upToDate = false; }
+
+	/// <summary>
+	/// Checks whether the cube map must be drawn again for the light.
+	/// </summary>
+	/// <param name="lightPosition">World-space position of the light</param>
+	/// <returns>True if the cube map was never drawn, was invalidated, or was drawn for another position</returns>
+	bool NeedsUpdate(const glm::vec3& lightPosition) const { return !upToDate || lightPosition != renderedLightPosition; }
+
+	/// <summary>
+	/// Draws the depth of the casters into every face of the cube map. The viewport and the
+	/// framebuffer are restored afterwards.
+	/// </summary>
+	/// <param name="lightPosition">World-space position of the light</param>
+	/// <param name="drawCasters">Draws the casters with the program variants it is given, once per face</param>
+	void Render(const glm::vec3& lightPosition, const std::function<void(ShaderVariants&)>& drawCasters);
+
+	/// <summary>
+	/// Binds the cube map to its texture unit. Called once per frame.
+	/// </summary>
+	void Bind();
+
+	/// <summary>
+	/// Deletes the cube map, its framebuffer and the caster program.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Formats the state of the shadow map.
+	/// </summary>
+	/// <returns>One line of text, such as "shadows drawn 3 times, reused by the last 120 frames"</returns>
+	std::string FormatReadout() const;
+
+private:
+	GLuint texture = 0;
+	GLuint framebuffer = 0;
+	int size = 0;
+	float nearPlane = 0.0f;
+	float range = 0.0f;
+
+	ShaderVariants casterShaders;	// main.vsh and depth.fsh, with the matrix of the face
+	UniformHandle<glm::mat4> faceViewProjectionUniforms[TransformClassCount];
+
+	bool upToDate = false;
+	glm::vec3 renderedLightPosition = glm::vec3(0.0f);
+	int renderCount = 0;			// Number of times the cube map was drawn
+	int framesSinceRender = 0;		// Frames that bound the cube map since it was last drawn, including the one that drew it
+};
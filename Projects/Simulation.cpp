@@ -0,0 +1,206 @@
+#include "Simulation.h"
+
+#include <cmath>
+
+namespace
+{
+	/// <summary>
+	/// Blends two camera states. Equal values stay exactly equal, so a camera that
+	/// does not move does not jitter.
+	/// </summary>
+	/// <param name="from">State at the start of the step</param>
+	/// <param name="to">State at the end of the step</param>
+	/// <param name="alpha">Position within the step, from 0 to 1</param>
+	/// <returns>Blended state</returns>
+	CameraState Interpolate(const CameraState& from, const CameraState& to, float alpha)
+	{
+		CameraState result = to;
+		result.position = from.position + (to.position - from.position) * alpha;
+		result.fov = from.fov + (to.fov - from.fov) * alpha;
+
+		// Blending two unit vectors shortens them while the view turns, and the view matrix
+		// and the movement expect a unit vector. A still view is left untouched.
+		if (from.front != to.front)
+		{
+			glm::vec3 front = from.front + (to.front - from.front) * alpha;
+			float length = glm::length(front);
+			result.front = length > 0.0f ? front / length : to.front;
+		}
+		else
+		{
+			result.front = from.front;
+		}
+
+		return result;
+	}
+}
+
+/// <summary>
+/// Starts the simulation thread.
+/// </summary>
+/// <param name="initialState">State of the camera before the first step</param>
+/// <param name="stepSeconds">Duration of one simulation step</param>
+/// <param name="cameraSpeed">Distance the camera moves per second while a movement key is held</param>
+void Simulation::Start(const CameraState& initialState, double stepSeconds, float cameraSpeed)
+{
+	camera = initialState;
+	stepDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(stepSeconds));
+	this->stepSeconds = static_cast<float>(stepSeconds);
+	speed = cameraSpeed;
+	lastCursorEventCount = 0;
+	firstMouse = true;
+	lastScrollTotal = 0.0;
+
+	// The renderer has a snapshot to read before the first step is done
+	SimulationSnapshot& snapshot = snapshots.GetWriteBuffer();
+	snapshot.previous = camera;
+	snapshot.current = camera;
+	snapshot.step = 0;
+	snapshot.time = Clock::now();
+	snapshots.Publish();
+
+	running = true;
+	thread = std::thread(&Simulation::Run, this);
+}
+
+/// <summary>
+/// Stops the simulation thread and waits for it to finish its current step.
+/// </summary>
+void Simulation::Stop()
+{
+	running = false;
+	if (thread.joinable())
+	{
+		thread.join();
+	}
+}
+
+/// <summary>
+/// Publishes the latest state of the input devices. Only one thread may call this.
+/// </summary>
+/// <param name="input">Input state</param>
+void Simulation::SubmitInput(const InputState& input)
+{
+	inputs.GetWriteBuffer() = input;
+	inputs.Publish();
+}
+
+/// <summary>
+/// Computes the camera at a point in time from the latest snapshot, interpolating between
+/// its two states. The result lags the simulation by up to one step, but moves smoothly at
+/// any frame rate. Only one thread may call this.
+/// </summary>
+/// <param name="time">Time of the frame being rendered</param>
+/// <returns>Interpolated camera</returns>
+CameraState Simulation::GetCamera(Clock::time_point time)
+{
+	snapshots.Take();
+	const SimulationSnapshot& snapshot = snapshots.GetReadBuffer();
+
+	float alpha = 1.0f;
+	if (stepDuration > Clock::duration::zero())
+	{
+		alpha = std::chrono::duration<float>(time - snapshot.time).count() / stepSeconds;
+		alpha = glm::clamp(alpha, 0.0f, 1.0f);
+	}
+
+	return Interpolate(snapshot.previous, snapshot.current, alpha);
+}
+
+/// <summary>
+/// Steps the simulation at a fixed rate until Stop() is called.
+/// </summary>
+void Simulation::Run()
+{
+	// After a long stall (a breakpoint, the window being dragged), skip ahead instead of
+	// running many steps at once to catch up
+	const int maxCatchUpSteps = 5;
+
+	long long stepCount = 0;
+	Clock::time_point nextStep = Clock::now() + stepDuration;
+	while (running)
+	{
+		Clock::time_point now = Clock::now();
+		if (now < nextStep)
+		{
+			std::this_thread::sleep_until(nextStep);
+			continue;
+		}
+
+		if (now - nextStep > stepDuration * maxCatchUpSteps)
+		{
+			nextStep = now;
+		}
+
+		inputs.Take();
+		CameraState previous = camera;
+		Step(inputs.GetReadBuffer());
+
+		SimulationSnapshot& snapshot = snapshots.GetWriteBuffer();
+		snapshot.previous = previous;
+		snapshot.current = camera;
+		snapshot.step = ++stepCount;
+		snapshot.time = nextStep;
+		snapshots.Publish();
+
+		nextStep += stepDuration;
+	}
+}
+
+/// <summary>
+/// Advances the camera by one step.
+/// </summary>
+/// <param name="input">Latest input state</param>
+void Simulation::Step(const InputState& input)
+{
+	// Mouse look, applied once per new cursor position
+	if (input.cursorEventCount != lastCursorEventCount)
+	{
+		lastCursorEventCount = input.cursorEventCount;
+
+		float xpos = static_cast<float>(input.cursorX);
+		float ypos = static_cast<float>(input.cursorY);
+		if (firstMouse)
+		{
+			lastX = xpos;
+			lastY = ypos;
+			firstMouse = false;
+		}
+
+		float xoffset = xpos - lastX;
+		float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+		lastX = xpos;
+		lastY = ypos;
+
+		float sensitivity = 0.1f;
+		camera.yaw += xoffset * sensitivity;
+		camera.pitch += yoffset * sensitivity;
+
+		// make sure that when pitch is out of bounds, screen doesn't get flipped
+		camera.pitch = glm::clamp(camera.pitch, -89.0f, 89.0f);
+
+		glm::vec3 front;
+		front.x = cos(glm::radians(camera.yaw)) * cos(glm::radians(camera.pitch));
+		front.y = sin(glm::radians(camera.pitch));
+		front.z = sin(glm::radians(camera.yaw)) * cos(glm::radians(camera.pitch));
+		camera.front = glm::normalize(front);
+	}
+
+	// Zoom with the scroll wheel
+	camera.fov = glm::clamp(camera.fov - static_cast<float>(input.scrollTotal - lastScrollTotal), 1.0f, 45.0f);
+	lastScrollTotal = input.scrollTotal;
+
+	// Movement
+	const glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+	float distance = speed * stepSeconds;
+	if (input.keys & InputKeyForward)
+		camera.position += distance * camera.front;
+	if (input.keys & InputKeyBackward)
+		camera.position -= distance * camera.front;
+	if (input.keys & InputKeyLeft)
+		camera.position -= glm::normalize(glm::cross(camera.front, up)) * distance;
+	if (input.keys & InputKeyRight)
+		camera.position += glm::normalize(glm::cross(camera.front, up)) * distance;
+	if (input.keys & InputKeyReset)
+		camera.position = glm::vec3(0.0f, 0.0f, 0.0f);
+}
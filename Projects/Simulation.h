@@ -0,0 +1,128 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "TripleBuffer.h"
+
+/// <summary>
+/// Keys the simulation reacts to, as bits of InputState::keys
+/// </summary>
+enum InputKey : unsigned
+{
+	InputKeyForward = 1 << 0,	// W
+	InputKeyBackward = 1 << 1,	// S
+	InputKeyLeft = 1 << 2,		// A
+	InputKeyRight = 1 << 3,		// D
+	InputKeyReset = 1 << 4,		// J
+};
+
+/// <summary>
+/// State of the input devices, sampled by the main thread. The cursor position and the
+/// scroll offset are totals rather than changes, so the simulation loses nothing when it
+/// only sees the latest state.
+/// </summary>
+struct InputState
+{
+	unsigned keys = 0;				// InputKey bits of the keys held down
+	unsigned cursorEventCount = 0;	// Number of cursor movements reported so far
+	double cursorX = 0.0;			// Last cursor position, in screen coordinates
+	double cursorY = 0.0;
+	double scrollTotal = 0.0;		// Sum of every vertical scroll offset so far
+};
+
+/// <summary>
+/// State of the camera at one simulation step
+/// </summary>
+struct CameraState
+{
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 front = glm::vec3(0.0f);
+	float yaw = -90.0f;	// yaw is initialized to -90.0 degrees since a yaw of 0.0 results in a direction vector pointing to the right so we initially rotate a bit to the left.
+	float pitch = 0.0f;
+	float fov = 45.0f;
+};
+
+/// <summary>
+/// Immutable result of one simulation step, with the state of the step before it so the
+/// renderer can interpolate between the two
+/// </summary>
+struct SimulationSnapshot
+{
+	using Clock = std::chrono::steady_clock;
+
+	CameraState previous;
+	CameraState current;
+	long long step = 0;			// Number of steps simulated, including this one
+	Clock::time_point time;		// Time the current state belongs to
+};
+
+/// <summary>
+/// Runs the camera simulation on its own thread at a fixed time step. The main thread
+/// submits the input state, and the render thread takes the latest snapshot and
+/// interpolates it to the time of the frame. Both directions go through triple buffers,
+/// so neither thread ever blocks the other.
+/// </summary>
+class Simulation
+{
+public:
+	/// <summary>
+	/// Starts the simulation thread.
+	/// </summary>
+	/// <param name="initialState">State of the camera before the first step</param>
+	/// <param name="stepSeconds">Duration of one simulation step</param>
+	/// <param name="cameraSpeed">Distance the camera moves per second while a movement key is held</param>
+	void Start(const CameraState& initialState, double stepSeconds = 1.0 / 120.0, float cameraSpeed = 10.0f);
+
+	/// <summary>
+	/// Stops the simulation thread and waits for it to finish its current step.
+	/// </summary>
+	void Stop();
+
+	/// <summary>
+	/// Publishes the latest state of the input devices. Only one thread may call this.
+	/// </summary>
+	/// <param name="input">Input state</param>
+	void SubmitInput(const InputState& input);
+
+	/// <summary>
+	/// Computes the camera at a point in time from the latest snapshot, interpolating between
+	/// its two states. The result lags the simulation by up to one step, but moves smoothly at
+	/// any frame rate. Only one thread may call this.
+	/// </summary>
+	/// <param name="time">Time of the frame being rendered</param>
+	/// <returns>Interpolated camera</returns>
+	CameraState GetCamera(SimulationSnapshot::Clock::time_point time);
+
+private:
+	using Clock = SimulationSnapshot::Clock;
+
+	/// <summary>
+	/// Steps the simulation at a fixed rate until Stop() is called.
+	/// </summary>
+	void Run();
+
+	/// <summary>
+	/// Advances the camera by one step.
+	/// </summary>
+	/// <param name="input">Latest input state</param>
+	void Step(const InputState& input);
+
+	TripleBuffer<InputState> inputs;
+	TripleBuffer<SimulationSnapshot> snapshots;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+
+	// Owned by the simulation thread while it runs
+	CameraState camera;
+	Clock::duration stepDuration = Clock::duration::zero();
+	float stepSeconds = 0.0f;
+	float speed = 0.0f;
+	unsigned lastCursorEventCount = 0;
+	bool firstMouse = true;
+	float lastX = 0.0f;
+	float lastY = 0.0f;
+	double lastScrollTotal = 0.0;
+};
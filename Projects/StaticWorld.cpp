@@ -0,0 +1,441 @@
+#include "StaticWorld.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+namespace
+{
+	/// <summary>
+	/// Vertex of a baked tile before it is packed
+	/// </summary>
+	struct BakedVertex
+	{
+		MeshVertex vertex;
+		glm::vec3 origin;
+	};
+
+	/// <summary>
+	/// Appends the vertices and indices of a face of the cube stretched over a rectangle of
+	/// tiles. The texture coordinates change by a whole texture per tile across every face, so
+	/// continuing them over the rectangle repeats the texture once per tile, like separate tiles.
+	/// </summary>
+	/// <param name="first">Tile at the minimum corner of the rectangle</param>
+	/// <param name="last">Tile at the maximum corner of the rectangle, which is the first tile for a single tile</param>
+	/// <param name="cubeVertices">Vertices of the cube, 4 per face</param>
+	/// <param name="cubeIndices">Indices of the cube, 6 per face</param>
+	/// <param name="vertices">List the 4 vertices are appended to</param>
+	/// <param name="indices">List the 6 indices are appended to</param>
+	void AppendQuad(const Tile& first, const Tile& last, const std::vector<MeshVertex>& cubeVertices, const std::vector<GLuint>& cubeIndices,
+		std::vector<BakedVertex>& vertices, std::vector<GLuint>& indices)
+	{
+		GLuint firstVertex = static_cast<GLuint>(vertices.size());
+		int face = static_cast<int>(first.face);
+
+		// The corners of a face are at -1 or +1 along each axis, so this finds the change of the
+		// texture coordinates per unit along x and z (the axis across the face gives nonsense,
+		// but the rectangle never stretches along it)
+		glm::vec2 gradientX(0.0f);
+		glm::vec2 gradientZ(0.0f);
+		for (int i = 0; i < 4; i++)
+		{
+			const MeshVertex& corner = cubeVertices[face * 4 + i];
+			gradientX += corner.uv * corner.position.x * 0.25f;
+			gradientZ += corner.uv * corner.position.z * 0.25f;
+		}
+
+		// Every model matrix of the maze is a pure translation, so adding the
+		// tile position is the same as multiplying by the model matrix
+		for (int i = 0; i < 4; i++)
+		{
+			BakedVertex baked;
+			baked.vertex = cubeVertices[face * 4 + i];
+			baked.origin = first.position;
+			if (baked.vertex.position.x > 0.0f)
+			{
+				baked.origin.x = last.position.x;
+			}
+			if (baked.vertex.position.z > 0.0f)
+			{
+				baked.origin.z = last.position.z;
+			}
+
+			glm::vec3 stretch = baked.origin - first.position;
+			baked.vertex.position += baked.origin;
+			baked.vertex.uv += gradientX * stretch.x + gradientZ * stretch.z;
+			vertices.push_back(baked);
+		}
+
+		for (int i = 0; i < 6; i++)
+		{
+			indices.push_back(firstVertex + cubeIndices[face * 6 + i] - face * 4);
+		}
+	}
+
+	/// <summary>
+	/// Merges the tiles of a block of cells into as few rectangles as possible. Floors and
+	/// ceilings grow along both axes, while walls, which are one cell high, grow along their
+	/// own line. Each rectangle is as wide as the run of tiles at its first cell, then grows
+	/// row by row while the whole row matches (greedy meshing).
+	/// </summary>
+	/// <param name="grid">Tiles sorted by cell</param>
+	/// <param name="x0">First column of the block</param>
+	/// <param name="z0">First row of the block</param>
+	/// <param name="x1">One past the last column of the block</param>
+	/// <param name="z1">One past the last row of the block</param>
+	/// <param name="cubeVertices">Vertices of the cube, 4 per face</param>
+	/// <param name="cubeIndices">Indices of the cube, 6 per face</param>
+	/// <param name="vertices">List the vertices are appended to</param>
+	/// <param name="indices">List the indices are appended to</param>
+	void AppendMergedBlock(const CellGrid& grid, int x0, int z0, int x1, int z1, const std::vector<MeshVertex>& cubeVertices,
+		const std::vector<GLuint>& cubeIndices, std::vector<BakedVertex>& vertices, std::vector<GLuint>& indices)
+	{
+		const std::vector<Tile>& tiles = grid.GetTiles();
+		int blockWidth = x1 - x0;
+		int blockDepth = z1 - z0;
+
+		// Tile of each face in each cell of the block, or -1. Tiles that are not centered on
+		// their cell, or that repeat a face of the cell, are not merged.
+		std::vector<int> faceTiles(blockWidth * blockDepth * TileFaceCount, -1);
+		glm::vec3 boxMin, boxMax;
+		for (int z = z0; z < z1; z++)
+		{
+			for (int x = x0; x < x1; x++)
+			{
+				int cell = z * grid.GetWidth() + x;
+				grid.GetBounds(x, z, x + 1, z + 1, boxMin, boxMax);
+				glm::vec3 center = (boxMin + boxMax) * 0.5f;
+				for (int tile = grid.GetFirstTile(cell); tile < grid.GetFirstTile(cell + 1); tile++)
+				{
+					int& slot = faceTiles[((z - z0) * blockWidth + x - x0) * TileFaceCount + static_cast<int>(tiles[tile].face)];
+					if (slot < 0 && tiles[tile].position.x == center.x && tiles[tile].position.z == center.z)
+					{
+						slot = tile;
+					}
+					else
+					{
+						AppendQuad(tiles[tile], tiles[tile], cubeVertices, cubeIndices, vertices, indices);
+					}
+				}
+			}
+		}
+
+		for (int face = 0; face < TileFaceCount; face++)
+		{
+			TileFace tileFace = static_cast<TileFace>(face);
+			bool growX = tileFace != TileFace::Left && tileFace != TileFace::Right;
+			bool growZ = tileFace != TileFace::Back && tileFace != TileFace::Front;
+
+			// Two tiles merge if both exist and are at the same height
+			auto matches = [&](int first, int x, int z)
+			{
+				int tile = faceTiles[(z * blockWidth + x) * TileFaceCount + face];
+				return tile >= 0 && tiles[tile].position.y == tiles[first].position.y;
+			};
+
+			for (int z = 0; z < blockDepth; z++)
+			{
+				for (int x = 0; x < blockWidth; x++)
+				{
+					int first = faceTiles[(z * blockWidth + x) * TileFaceCount + face];
+					if (first < 0)
+					{
+						continue;
+					}
+
+					int width = 1;
+					while (growX && x + width < blockWidth && matches(first, x + width, z))
+					{
+						width++;
+					}
+
+					int depth = 1;
+					while (growZ && z + depth < blockDepth)
+					{
+						bool rowMatches = true;
+						for (int i = 0; i < width && rowMatches; i++)
+						{
+							rowMatches = matches(first, x + i, z + depth);
+						}
+						if (!rowMatches)
+						{
+							break;
+						}
+						depth++;
+					}
+
+					int last = faceTiles[((z + depth - 1) * blockWidth + x + width - 1) * TileFaceCount + face];
+					AppendQuad(tiles[first], tiles[last], cubeVertices, cubeIndices, vertices, indices);
+
+					// Clear the merged tiles, so they are not merged again
+					for (int j = 0; j < depth; j++)
+					{
+						for (int i = 0; i < width; i++)
+						{
+							faceTiles[((z + j) * blockWidth + x + i) * TileFaceCount + face] = -1;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Transforms the face of the cube used by each tile to world space and
+/// uploads the result to the GPU.
+/// </summary>
+/// <param name="grid">Tiles to bake, sorted by cell</param>
+/// <param name="cubeVertices">Vertices of the cube, 4 per face</param>
+/// <param name="cubeIndices">Indices of the cube, 6 per face</param>
+/// <param name="mergeTiles">Whether to merge the tiles of each block of cells into larger quads</param>
+void StaticWorld::Build(const CellGrid& grid, const std::vector<MeshVertex>& cubeVertices, const std::vector<GLuint>& cubeIndices, bool mergeTiles)
+{
+	BakedWorld baked;
+	Bake(grid, cubeVertices, cubeIndices, baked, mergeTiles);
+	Upload(baked);
+}
+
+/// <summary>
+/// Transforms the face of the cube used by each tile to world space, without uploading
+/// anything. Safe to call from any thread.
+/// </summary>
+/// <param name="grid">Tiles to bake, sorted by cell</param>
+/// <param name="cubeVertices">Vertices of the cube, 4 per face</param>
+/// <param name="cubeIndices">Indices of the cube, 6 per face</param>
+/// <param name="result">Receives the vertices and indices</param>
+/// <param name="mergeTiles">Whether to merge the tiles of each block of cells into larger quads</param>
+void StaticWorld::Bake(const CellGrid& grid, const std::vector<MeshVertex>& cubeVertices, const std::vector<GLuint>& cubeIndices, BakedWorld& result,
+	bool mergeTiles)
+{
+	const std::vector<Tile>& tiles = grid.GetTiles();
+
+	std::vector<BakedVertex> vertices;
+	std::vector<GLuint> indices;
+	vertices.reserve(tiles.size() * 4);
+	indices.reserve(tiles.size() * 6);
+
+	// Each quad is 4 vertices and 6 indices, and the quads of a cell, or of a block of cells
+	// when they are merged, are contiguous
+	std::vector<GLsizei>& cellFirstIndex = result.cellFirstIndex;
+	cellFirstIndex.clear();
+	result.cellBlocks.clear();
+	if (mergeTiles)
+	{
+		int blockColumns = (grid.GetWidth() + MergeBlockCells - 1) / MergeBlockCells;
+		int blockRows = (grid.GetDepth() + MergeBlockCells - 1) / MergeBlockCells;
+		result.cellBlocks.resize(grid.GetCellCount());
+		for (int z = 0; z < grid.GetDepth(); z++)
+		{
+			for (int x = 0; x < grid.GetWidth(); x++)
+			{
+				result.cellBlocks[z * grid.GetWidth() + x] = z / MergeBlockCells * blockColumns + x / MergeBlockCells;
+			}
+		}
+
+		for (int blockZ = 0; blockZ < blockRows; blockZ++)
+		{
+			for (int blockX = 0; blockX < blockColumns; blockX++)
+			{
+				cellFirstIndex.push_back(static_cast<GLsizei>(indices.size()));
+				int x0 = blockX * MergeBlockCells;
+				int z0 = blockZ * MergeBlockCells;
+				AppendMergedBlock(grid, x0, z0, std::min(x0 + MergeBlockCells, grid.GetWidth()), std::min(z0 + MergeBlockCells, grid.GetDepth()),
+					cubeVertices, cubeIndices, vertices, indices);
+			}
+		}
+	}
+	else
+	{
+		for (int cell = 0; cell < grid.GetCellCount(); cell++)
+		{
+			cellFirstIndex.push_back(static_cast<GLsizei>(indices.size()));
+			for (int tile = grid.GetFirstTile(cell); tile < grid.GetFirstTile(cell + 1); tile++)
+			{
+				AppendQuad(tiles[tile], tiles[tile], cubeVertices, cubeIndices, vertices, indices);
+			}
+		}
+	}
+	cellFirstIndex.push_back(static_cast<GLsizei>(indices.size()));
+
+	glm::vec3 boundsMin(0.0f);
+	glm::vec3 boundsMax(0.0f);
+	if (!vertices.empty())
+	{
+		boundsMin = boundsMax = vertices[0].origin;
+	}
+	for (const BakedVertex& baked : vertices)
+	{
+		boundsMin = glm::min(boundsMin, glm::min(baked.vertex.position, baked.origin));
+		boundsMax = glm::max(boundsMax, glm::max(baked.vertex.position, baked.origin));
+	}
+
+	// The triangles are only reordered within their cell, so that every cell stays a single
+	// index range. The vertices of a cell are contiguous too, so each cell is optimized on its own.
+	for (std::size_t cell = 0; cell + 1 < cellFirstIndex.size(); cell++)
+	{
+		GLsizei firstIndex = cellFirstIndex[cell];
+		GLsizei cellIndexCount = cellFirstIndex[cell + 1] - firstIndex;
+		if (cellIndexCount == 0)
+		{
+			continue;
+		}
+
+		GLuint* cellIndices = indices.data() + firstIndex;
+		GLuint firstVertex = static_cast<GLuint>(firstIndex / 6 * 4);
+		for (GLsizei i = 0; i < cellIndexCount; i++)
+		{
+			cellIndices[i] -= firstVertex;
+		}
+		OptimizeVertexCache(cellIndices, cellIndexCount, cellIndexCount / 6 * 4);
+		for (GLsizei i = 0; i < cellIndexCount; i++)
+		{
+			cellIndices[i] += firstVertex;
+		}
+	}
+	OptimizeVertexFetch(vertices, indices);
+
+	// The tile origins are quantized like the positions, so a single scale and offset decode both
+	result.quantization = PositionQuantization::FromBounds(boundsMin, boundsMax);
+	result.vertices.clear();
+	result.vertices.reserve(vertices.size());
+	for (const BakedVertex& baked : vertices)
+	{
+		WorldVertex vertex;
+		vertex.vertex = PackVertex(baked.vertex, result.quantization);
+		result.quantization.Encode(baked.origin, &vertex.ox);
+		vertex.ow = 0;
+		result.vertices.push_back(vertex);
+	}
+	result.indices = std::move(indices);
+}
+
+/// <summary>
+/// Uploads a baked world to the GPU. Must be called on the thread that owns the OpenGL context.
+/// </summary>
+/// <param name="baked">Result of Bake()</param>
+void StaticWorld::Upload(const BakedWorld& baked)
+{
+	indexCount = static_cast<GLsizei>(baked.indices.size());
+	cellFirstIndex = baked.cellFirstIndex;
+	cellBlocks = baked.cellBlocks;
+	quantization = baked.quantization;
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, baked.vertices.size() * sizeof(WorldVertex), baked.vertices.data(), GL_STATIC_DRAW);
+
+	// The element buffer binding is part of the vertex array object state
+	glGenBuffers(1, &ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	indexType = UploadIndices(baked.indices, baked.vertices.size());
+	indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	gpuBytes = baked.vertices.size() * sizeof(WorldVertex) + indexCount * indexSize;
+
+	// Vertex attributes 0, 2 and 12 - Position, UV coordinate and normal
+	SetPackedVertexAttributes(sizeof(WorldVertex), offsetof(WorldVertex, vertex));
+
+	// Vertex attribute 7 - Tile translation
+	glEnableVertexAttribArray(TileOriginAttribute);
+	glVertexAttribPointer(TileOriginAttribute, 3, GL_SHORT, GL_TRUE, sizeof(WorldVertex), (void*)(offsetof(WorldVertex, ox)));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/// <summary>
+/// Draws the tiles of the provided cells, in the order given. Runs of cells with
+/// consecutive indices are merged into a single index range. When the tiles are merged,
+/// the blocks of the cells are drawn instead, in the order of their first cell.
+/// The shader program must already be in use.
+/// </summary>
+/// <param name="cells">Cells to draw, in draw order</param>
+void StaticWorld::Draw(const std::vector<int>& cells)
+{
+	rangeCounts.clear();
+	rangeOffsets.clear();
+	drawnIndexCount = 0;
+
+	const std::vector<int>* ranges = &cells;
+	if (!cellBlocks.empty())
+	{
+		visibleBlocks.clear();
+		blockVisible.assign(cellFirstIndex.size() - 1, false);
+		for (int cell : cells)
+		{
+			int block = cellBlocks[cell];
+			if (!blockVisible[block])
+			{
+				blockVisible[block] = true;
+				visibleBlocks.push_back(block);
+			}
+		}
+		ranges = &visibleBlocks;
+	}
+
+	int runStart = -1;
+	int runEnd = -1;
+	for (std::size_t i = 0; i <= ranges->size(); i++)
+	{
+		if (i < ranges->size() && (*ranges)[i] == runEnd)
+		{
+			runEnd++;
+			continue;
+		}
+
+		if (runStart >= 0 && cellFirstIndex[runEnd] > cellFirstIndex[runStart])
+		{
+			GLsizei first = cellFirstIndex[runStart];
+			GLsizei count = cellFirstIndex[runEnd] - first;
+			rangeCounts.push_back(count);
+			rangeOffsets.push_back((const void*)(first * indexSize));
+			drawnIndexCount += count;
+		}
+
+		if (i < ranges->size())
+		{
+			runStart = (*ranges)[i];
+			runEnd = (*ranges)[i] + 1;
+		}
+	}
+
+	drawCount = 0;
+	if (rangeCounts.empty())
+	{
+		return;
+	}
+
+	// The model matrix attributes (3 to 6) are not read from a buffer here, so they
+	// take their constant value instead. Set it to the identity matrix, since the
+	// vertices are already in world space.
+	glVertexAttrib4f(3, 1.0f, 0.0f, 0.0f, 0.0f);
+	glVertexAttrib4f(4, 0.0f, 1.0f, 0.0f, 0.0f);
+	glVertexAttrib4f(5, 0.0f, 0.0f, 1.0f, 0.0f);
+	glVertexAttrib4f(6, 0.0f, 0.0f, 0.0f, 1.0f);
+	SetPackedVertexConstants(quantization);
+
+	glBindVertexArray(vao);
+	glMultiDrawElements(GL_TRIANGLES, rangeCounts.data(), indexType, rangeOffsets.data(), static_cast<GLsizei>(rangeCounts.size()));
+	glBindVertexArray(0);
+
+	drawCount = 1;
+}
+
+/// <summary>
+/// Deletes the buffers and vertex array object owned by the world.
+/// </summary>
+void StaticWorld::Destroy()
+{
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ibo);
+	vao = vbo = ibo = 0;
+	indexCount = 0;
+	gpuBytes = 0;
+	cellFirstIndex.clear();
+	cellBlocks.clear();
+}
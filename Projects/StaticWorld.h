@@ -0,0 +1,129 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+#include "CellGrid.h"
+#include "Mesh.h"
+#include "Scene.h"
+
+/// <summary>
+/// Struct containing data about a vertex that has already been transformed to world space
+/// </summary>
+struct WorldVertex
+{
+	PackedVertex vertex;		// World-space position, UV coordinates and normal
+	GLshort ox, oy, oz, ow;		// Translation of the tile the vertex belongs to (used by the lighting), quantized like the position
+};
+
+static_assert(sizeof(WorldVertex) == 24, "WorldVertex must stay tightly packed");
+
+/// <summary>
+/// Vertices and indices of a baked world, ready to be uploaded. Baking does not touch
+/// OpenGL, so it can run on any thread.
+/// </summary>
+struct BakedWorld
+{
+	std::vector<WorldVertex> vertices;
+	std::vector<GLuint> indices;
+	std::vector<GLsizei> cellFirstIndex;	// First index of each cell, or of each block when the tiles are merged, plus one final entry for the end
+	std::vector<int> cellBlocks;			// Block of each cell when the tiles are merged, empty otherwise
+	PositionQuantization quantization;
+};
+
+/// <summary>
+/// The static part of the maze, baked once at load time into a single vertex buffer and
+/// a single index buffer. Every tile is pre-transformed to world space, so drawing the
+/// whole maze takes one draw call and no per-tile CPU work. The indices are ordered by
+/// cell, so any set of cells can be drawn with one glMultiDrawElements() call.
+/// The tiles can also be merged into the largest quads that cover them, within blocks of
+/// cells. A quad then spans several cells, so the blocks take the place of the cells: a block
+/// is drawn whenever one of its cells is.
+/// </summary>
+class StaticWorld
+{
+public:
+	/// <summary>
+	/// Number of cells along each side of the blocks whose tiles are merged. The texture
+	/// coordinates grow by one per tile along a quad, and half floats still hold them exactly.
+	/// </summary>
+	static const int MergeBlockCells = 8;
+
+	/// <summary>
+	/// Transforms the face of the cube used by each tile to world space and
+	/// uploads the result to the GPU.
+	/// </summary>
+	/// <param name="grid">Tiles to bake, sorted by cell</param>
+	/// <param name="cubeVertices">Vertices of the cube, 4 per face</param>
+	/// <param name="cubeIndices">Indices of the cube, 6 per face</param>
+	/// <param name="mergeTiles">Whether to merge the tiles of each block of cells into larger quads</param>
+	void Build(const CellGrid& grid, const std::vector<MeshVertex>& cubeVertices, const std::vector<GLuint>& cubeIndices, bool mergeTiles = false);
+
+	/// <summary>
+	/// Transforms the face of the cube used by each tile to world space, without uploading
+	/// anything. Safe to call from any thread.
+	/// </summary>
+	/// <param name="grid">Tiles to bake, sorted by cell</param>
+	/// <param name="cubeVertices">Vertices of the cube, 4 per face</param>
+	/// <param name="cubeIndices">Indices of the cube, 6 per face</param>
+	/// <param name="result">Receives the vertices and indices</param>
+	/// <param name="mergeTiles">Whether to merge the tiles of each block of cells into larger quads</param>
+	static void Bake(const CellGrid& grid, const std::vector<MeshVertex>& cubeVertices, const std::vector<GLuint>& cubeIndices, BakedWorld& result,
+		bool mergeTiles = false);
+
+	/// <summary>
+	/// Uploads a baked world to the GPU. Must be called on the thread that owns the OpenGL context.
+	/// </summary>
+	/// <param name="baked">Result of Bake()</param>
+	void Upload(const BakedWorld& baked);
+
+	/// <summary>
+	/// Draws the tiles of the provided cells, in the order given. Runs of cells with
+	/// consecutive indices are merged into a single index range. When the tiles are merged,
+	/// the blocks of the cells are drawn instead, in the order of their first cell.
+	/// The shader program must already be in use.
+	/// </summary>
+	/// <param name="cells">Cells to draw, in draw order</param>
+	void Draw(const std::vector<int>& cells);
+
+	/// <summary>
+	/// Deletes the buffers and vertex array object owned by the world.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Number of draw calls issued by the last call to Draw()
+	/// </summary>
+	int GetDrawCount() const { return drawCount; }
+
+	/// <summary>
+	/// Number of triangles drawn by the last call to Draw()
+	/// </summary>
+	GLsizei GetTriangleCount() const { return drawnIndexCount / 3; }
+
+	/// <summary>
+	/// Size of the vertex and index buffers, in bytes
+	/// </summary>
+	std::size_t GetGpuBytes() const { return gpuBytes; }
+
+private:
+	GLuint vao = 0;
+	GLuint vbo = 0;
+	GLuint ibo = 0;
+	GLsizei indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_SHORT;
+	std::size_t indexSize = sizeof(GLushort);
+	std::size_t gpuBytes = 0;
+	PositionQuantization quantization;
+	std::vector<GLsizei> cellFirstIndex;	// First index of each cell, or of each block when the tiles are merged, plus one final entry for the end
+	std::vector<int> cellBlocks;			// Block of each cell when the tiles are merged, empty otherwise
+
+	// Index ranges and blocks gathered by Draw(), kept around to avoid reallocating them every frame
+	std::vector<GLsizei> rangeCounts;
+	std::vector<const void*> rangeOffsets;
+	std::vector<int> visibleBlocks;
+	std::vector<bool> blockVisible;
+
+	int drawCount = 0;
+	GLsizei drawnIndexCount = 0;
+};
@@ -0,0 +1,216 @@
+#include "StreamBuffer.h"
+
+#include <cstring>
+#include <iostream>
+
+/// <summary>
+/// Creates the buffer.
+/// </summary>
+/// <param name="frameSize">Number of bytes that can be allocated during a single frame</param>
+/// <param name="frameCount">Number of frames that can be in flight at once</param>
+void StreamBuffer::Create(GLsizeiptr frameSize, int frameCount)
+{
+	if (frameCount > MaxFrameCount)
+	{
+		frameCount = MaxFrameCount;
+	}
+
+	this->frameSize = frameSize;
+	this->frameCount = frameCount;
+
+	// Start on the last region, so that the first BeginFrame() moves to region 0
+	currentFrame = frameCount - 1;
+	frameUsed = 0;
+
+	// GL_COPY_WRITE_BUFFER is not used by the rest of the renderer, so binding the
+	// buffer there does not disturb the array buffer or vertex array bindings
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, frameSize * frameCount, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/// <summary>
+/// Moves on to the region of the next frame, waiting for the GPU first if it is still
+/// reading that region. Must be called before any allocation in a frame.
+/// </summary>
+void StreamBuffer::BeginFrame()
+{
+	currentFrame = (currentFrame + 1) % frameCount;
+	frameUsed = 0;
+
+	GLsync& fence = fences[currentFrame];
+	if (fence != nullptr)
+	{
+		// Usually the fence has long been signaled, so poll it before counting a wait
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			waitCount++;
+			do
+			{
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			} while (result == GL_TIMEOUT_EXPIRED);
+		}
+
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	// Once every region has been reused, the GPU has finished the frames that read a
+	// replaced buffer
+	for (std::size_t i = 0; i < retiredBuffers.size();)
+	{
+		if (--retiredBuffers[i].framesLeft > 0)
+		{
+			i++;
+			continue;
+		}
+
+		glDeleteBuffers(1, &retiredBuffers[i].buffer);
+		retiredBuffers.erase(retiredBuffers.begin() + i);
+	}
+}
+
+/// <summary>
+/// Places a fence after the commands of this frame, which the next use of the region
+/// waits for. Must be called after the last draw reading the data of this frame.
+/// </summary>
+void StreamBuffer::EndFrame()
+{
+	GLsync& fence = fences[currentFrame];
+	if (fence != nullptr)
+	{
+		glDeleteSync(fence);
+	}
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/// <summary>
+/// Allocates space in the region of the current frame and maps it for writing.
+/// The range must be unmapped with Unmap() before drawing.
+/// </summary>
+/// <param name="size">Number of bytes to allocate</param>
+/// <param name="alignment">Required alignment of the offset of the allocation</param>
+/// <param name="offset">Receives the offset of the allocation in the buffer</param>
+/// <returns>Pointer to write the data to, or nullptr if the range could not be mapped.
+/// The buffer may have been replaced, so GetBuffer() must be read after the call.</returns>
+void* StreamBuffer::Map(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset)
+{
+	if (size <= 0)
+	{
+		return nullptr;
+	}
+
+	GLsizeiptr start = (frameUsed + alignment - 1) / alignment * alignment;
+	if (start + size > frameSize)
+	{
+		Grow(size);
+		start = 0;
+	}
+
+	frameUsed = start + size;
+	offset = currentFrame * frameSize + start;
+
+	// The fence waited for in BeginFrame() guarantees that the GPU no longer reads this
+	// region, so the driver does not need to synchronize the mapping
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	void* pointer = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (pointer == nullptr)
+	{
+		std::cerr << "Failed to map " << size << " bytes of the stream buffer" << std::endl;
+	}
+
+	return pointer;
+}
+
+/// <summary>
+/// Unmaps the range returned by the last call to Map().
+/// </summary>
+void StreamBuffer::Unmap()
+{
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/// <summary>
+/// Copies data into the region of the current frame.
+/// </summary>
+/// <param name="data">Data to copy</param>
+/// <param name="size">Number of bytes to copy</param>
+/// <param name="alignment">Required alignment of the offset of the allocation</param>
+/// <returns>Offset of the data in GetBuffer(), or -1 if the range could not be mapped</returns>
+GLintptr StreamBuffer::Write(const void* data, GLsizeiptr size, GLsizeiptr alignment)
+{
+	GLintptr offset = 0;
+	void* pointer = Map(size, alignment, offset);
+	if (pointer == nullptr)
+	{
+		return -1;
+	}
+
+	std::memcpy(pointer, data, size);
+	Unmap();
+	return offset;
+}
+
+/// <summary>
+/// Deletes the buffer and any fence still pending.
+/// </summary>
+void StreamBuffer::Destroy()
+{
+	for (RetiredBuffer& retired : retiredBuffers)
+	{
+		glDeleteBuffers(1, &retired.buffer);
+	}
+	retiredBuffers.clear();
+
+	for (GLsync& fence : fences)
+	{
+		if (fence != nullptr)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+	frameSize = 0;
+	frameCount = 0;
+}
+
+/// <summary>
+/// Replaces the buffer with one whose regions can hold an allocation of the given size.
+/// Allocations made earlier in the frame stay in the old buffer, which is deleted once
+/// every region has been reused.
+/// </summary>
+/// <param name="size">Number of bytes of the allocation that did not fit</param>
+void StreamBuffer::Grow(GLsizeiptr size)
+{
+	// Deleting the buffer now would unbind it from the uniform block of this frame, and
+	// the fences of the other regions still guard the draws of the frames before
+	RetiredBuffer retired;
+	retired.buffer = buffer;
+	retired.framesLeft = frameCount;
+	retiredBuffers.push_back(retired);
+
+	// Doubling keeps the number of replacements low when the scene grows a little at a time
+	while (frameSize < size)
+	{
+		frameSize *= 2;
+	}
+	frameSize *= 2;
+
+	// The new buffer has never been read by the GPU, so the current region starts empty
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, frameSize * frameCount, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	frameUsed = 0;
+}
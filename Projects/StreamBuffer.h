@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+/// <summary>
+/// Ring buffer for data that is written by the CPU every frame, such as instance transforms
+/// and uniform blocks. The buffer is split into one region per frame in flight. Each frame
+/// sub-allocates from its own region, which is written through unsynchronized mappings, so
+/// the driver never has to stall waiting for draws still reading the other regions. A fence
+/// placed at the end of each frame guards the region until the GPU is done with it.
+/// When a frame needs more than its region, the buffer is replaced by one with larger
+/// regions, and the old one is kept until the frames that used it are done.
+/// </summary>
+class StreamBuffer
+{
+public:
+	/// <summary>
+	/// Creates the buffer.
+	/// </summary>
+	/// <param name="frameSize">Number of bytes that can be allocated during a single frame</param>
+	/// <param name="frameCount">Number of frames that can be in flight at once</param>
+	void Create(GLsizeiptr frameSize, int frameCount = 3);
+
+	/// <summary>
+	/// Moves on to the region of the next frame, waiting for the GPU first if it is still
+	/// reading that region. Must be called before any allocation in a frame.
+	/// </summary>
+	void BeginFrame();
+
+	/// <summary>
+	/// Places a fence after the commands of this frame, which the next use of the region
+	/// waits for. Must be called after the last draw reading the data of this frame.
+	/// </summary>
+	void EndFrame();
+
+	/// <summary>
+	/// Allocates space in the region of the current frame and maps it for writing.
+	/// The range must be unmapped with Unmap() before drawing.
+	/// </summary>
+	/// <param name="size">Number of bytes to allocate</param>
+	/// <param name="alignment">Required alignment of the offset of the allocation</param>
+	/// <param name="offset">Receives the offset of the allocation in the buffer</param>
+	/// <returns>Pointer to write the data to, or nullptr if the range could not be mapped.
+	/// The buffer may have been replaced, so GetBuffer() must be read after the call.</returns>
+	void* Map(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset);
+
+	/// <summary>
+	/// Unmaps the range returned by the last call to Map().
+	/// </summary>
+	void Unmap();
+
+	/// <summary>
+	/// Copies data into the region of the current frame.
+	/// </summary>
+	/// <param name="data">Data to copy</param>
+	/// <param name="size">Number of bytes to copy</param>
+	/// <param name="alignment">Required alignment of the offset of the allocation</param>
+	/// <returns>Offset of the data in GetBuffer(), or -1 if the range could not be mapped</returns>
+	GLintptr Write(const void* data, GLsizeiptr size, GLsizeiptr alignment = 16);
+
+	/// <summary>
+	/// Deletes the buffer and any fence still pending.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// OpenGL handle to the buffer, which can be bound to any target
+	/// </summary>
+	GLuint GetBuffer() const { return buffer; }
+
+	/// <summary>
+	/// Number of frames on which BeginFrame() had to wait for the GPU
+	/// </summary>
+	int GetWaitCount() const { return waitCount; }
+
+	/// <summary>
+	/// Number of bytes that can be allocated during a single frame
+	/// </summary>
+	GLsizeiptr GetFrameSize() const { return frameSize; }
+
+private:
+	static const int MaxFrameCount = 4;
+
+	/// <summary>
+	/// A buffer that was replaced while draws already issued still read from it
+	/// </summary>
+	struct RetiredBuffer
+	{
+		GLuint buffer = 0;
+		int framesLeft = 0;		// Calls to BeginFrame() before the GPU is done with it
+	};
+
+	/// <summary>
+	/// Replaces the buffer with one whose regions can hold an allocation of the given size.
+	/// Allocations made earlier in the frame stay in the old buffer, which is deleted once
+	/// every region has been reused.
+	/// </summary>
+	/// <param name="size">Number of bytes of the allocation that did not fit</param>
+	void Grow(GLsizeiptr size);
+
+	GLuint buffer = 0;
+	GLsizeiptr frameSize = 0;
+	int frameCount = 0;
+	int currentFrame = 0;
+	GLsizeiptr frameUsed = 0;		// Bytes allocated in the region of the current frame
+	GLsync fences[MaxFrameCount] = {};
+	std::vector<RetiredBuffer> retiredBuffers;
+	int waitCount = 0;
+};
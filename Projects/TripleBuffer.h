@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+
+/// <summary>
+/// Passes the latest value from one writer thread to one reader thread without locks.
+/// There are three copies of the value: the writer fills one, the reader reads another,
+/// and the third holds the most recent value that was published. Publishing and taking
+/// swap a copy with that third one atomically, so neither thread ever waits for the
+/// other, and values the reader was too slow to take are simply replaced.
+/// </summary>
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : shared(1) {}
+
+	/// <summary>
+	/// Copy the writer fills before calling Publish(). Only the writer thread may use it.
+	/// </summary>
+	T& GetWriteBuffer() { return buffers[writeIndex]; }
+
+	/// <summary>
+	/// Makes the write buffer the latest value, and gives the writer another copy to fill.
+	/// </summary>
+	void Publish()
+	{
+		int previous = shared.exchange(writeIndex | FreshBit, std::memory_order_acq_rel);
+		writeIndex = previous & IndexMask;
+	}
+
+	/// <summary>
+	/// Takes the latest value if one was published since the last call. Only the reader
+	/// thread may call this.
+	/// </summary>
+	/// <returns>True if the read buffer now holds a newer value</returns>
+	bool Take()
+	{
+		if ((shared.load(std::memory_order_relaxed) & FreshBit) == 0)
+		{
+			return false;
+		}
+
+		int previous = shared.exchange(readIndex, std::memory_order_acq_rel);
+		readIndex = previous & IndexMask;
+		return true;
+	}
+
+	/// <summary>
+	/// Latest value taken by the reader. Only the reader thread may use it.
+	/// </summary>
+	const T& GetReadBuffer() const { return buffers[readIndex]; }
+
+private:
+	static const int IndexMask = 3;
+	static const int FreshBit = 4;	// Set while the shared copy has not been taken yet
+
+	T buffers[3];
+	int writeIndex = 0;
+	int readIndex = 2;
+	std::atomic<int> shared;	// Index of the shared copy, with FreshBit
+};
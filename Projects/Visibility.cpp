@@ -0,0 +1,281 @@
+#include "Visibility.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	/// <summary>
+	/// Point in the top-down plane of the grid, in cell units
+	/// </summary>
+	struct GridPoint
+	{
+		float x, z;
+	};
+
+	/// <summary>
+	/// Header at the start of a potentially visible set file
+	/// </summary>
+	struct PvsFileHeader
+	{
+		char magic[4];				// "PVS1"
+		std::int32_t width;			// Number of cells along the x-axis
+		std::int32_t depth;			// Number of cells along the z-axis
+		std::uint64_t wallHash;		// Hash of the walls the sets were computed for
+	};
+
+	/// <summary>
+	/// Checks whether a directed line can pass through a sequence of portals. Each portal
+	/// is given by the endpoint on the left and the endpoint on the right of the direction
+	/// of travel. If such a line exists, one also exists that passes through two of the
+	/// endpoints, so only those lines need to be tried.
+	/// </summary>
+	/// <param name="lefts">Left endpoint of each portal</param>
+	/// <param name="rights">Right endpoint of each portal</param>
+	/// <returns>True if some line keeps every left endpoint on its left and every right endpoint on its right</returns>
+	bool IsStabbable(const std::vector<GridPoint>& lefts, const std::vector<GridPoint>& rights)
+	{
+		// Any two segments can be crossed by a single line
+		if (lefts.size() <= 2)
+		{
+			return true;
+		}
+
+		// Lines that only graze a wall corner count as passing, which keeps the sets conservative
+		const float epsilon = 1e-4f;
+
+		std::size_t pointCount = lefts.size() * 2;
+		for (std::size_t i = 0; i < pointCount; i++)
+		{
+			const GridPoint& a = i < lefts.size() ? lefts[i] : rights[i - lefts.size()];
+			for (std::size_t j = 0; j < pointCount; j++)
+			{
+				const GridPoint& b = j < lefts.size() ? lefts[j] : rights[j - lefts.size()];
+				float dx = b.x - a.x;
+				float dz = b.z - a.z;
+				if (i == j || (dx == 0.0f && dz == 0.0f))
+				{
+					continue;
+				}
+
+				// The cross product is positive for points on the left of the line
+				bool separates = true;
+				for (std::size_t k = 0; k < lefts.size() && separates; k++)
+				{
+					separates = dx * (lefts[k].z - a.z) - dz * (lefts[k].x - a.x) >= -epsilon
+						&& dx * (rights[k].z - a.z) - dz * (rights[k].x - a.x) <= epsilon;
+				}
+
+				if (separates)
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	/// <summary>
+	/// Walks through the portals of the maze from a single cell, marking every cell it reaches.
+	/// </summary>
+	class PortalWalker
+	{
+	public:
+		PortalWalker(const CellGrid& grid, std::uint64_t* row) : grid(grid), row(row) {}
+
+		/// <summary>
+		/// Marks a cell as visible, then continues through each of its open sides.
+		/// A straight line always moves the same way along each axis, so once the walk has
+		/// moved towards +x (for example) it never moves towards -x again.
+		/// </summary>
+		/// <param name="x">Column of the cell</param>
+		/// <param name="z">Row of the cell</param>
+		/// <param name="stepX">Direction already taken along x, or 0 if none yet</param>
+		/// <param name="stepZ">Direction already taken along z, or 0 if none yet</param>
+		void Walk(int x, int z, int stepX, int stepZ)
+		{
+			int cell = z * grid.GetWidth() + x;
+			row[cell / 64] |= std::uint64_t(1) << (cell % 64);
+
+			const CellSide sides[4] = { CellSide::NegativeX, CellSide::PositiveX, CellSide::NegativeZ, CellSide::PositiveZ };
+			for (CellSide side : sides)
+			{
+				int dx = side == CellSide::PositiveX ? 1 : (side == CellSide::NegativeX ? -1 : 0);
+				int dz = side == CellSide::PositiveZ ? 1 : (side == CellSide::NegativeZ ? -1 : 0);
+				int nextX = x + dx;
+				int nextZ = z + dz;
+				if ((dx != 0 && dx == -stepX) || (dz != 0 && dz == -stepZ)
+					|| nextX < 0 || nextZ < 0 || nextX >= grid.GetWidth() || nextZ >= grid.GetDepth())
+				{
+					continue;
+				}
+
+				// Endpoints of the portal, on the left and on the right of the direction of travel
+				float fx = static_cast<float>(x);
+				float fz = static_cast<float>(z);
+				switch (side)
+				{
+				case CellSide::PositiveX:	lefts.push_back({ fx + 1, fz + 1 });	rights.push_back({ fx + 1, fz });		break;
+				case CellSide::NegativeX:	lefts.push_back({ fx, fz });			rights.push_back({ fx, fz + 1 });		break;
+				case CellSide::PositiveZ:	lefts.push_back({ fx, fz + 1 });		rights.push_back({ fx + 1, fz + 1 });	break;
+				case CellSide::NegativeZ:	lefts.push_back({ fx + 1, fz });		rights.push_back({ fx, fz });			break;
+				}
+
+				// A wall tile belongs to only one of the two cells it separates, so the cell
+				// behind a wall that can be seen is visible too, but the walk stops there
+				if (IsStabbable(lefts, rights))
+				{
+					if (grid.IsBlocked(x, z, side))
+					{
+						int nextCell = nextZ * grid.GetWidth() + nextX;
+						row[nextCell / 64] |= std::uint64_t(1) << (nextCell % 64);
+					}
+					else
+					{
+						Walk(nextX, nextZ, dx != 0 ? dx : stepX, dz != 0 ? dz : stepZ);
+					}
+				}
+
+				lefts.pop_back();
+				rights.pop_back();
+			}
+		}
+
+	private:
+		const CellGrid& grid;
+		std::uint64_t* row;
+		std::vector<GridPoint> lefts;
+		std::vector<GridPoint> rights;
+	};
+}
+
+/// <summary>
+/// Computes the set of every cell by walking through the portals from each cell in turn,
+/// stopping once no straight line can pass through all of the portals on the way.
+/// The cells are split between the workers of the job system.
+/// </summary>
+/// <param name="grid">Grid containing the walls of the maze</param>
+/// <param name="jobs">Job system running the walks</param>
+void PotentiallyVisibleSet::Compute(const CellGrid& grid, JobSystem& jobs)
+{
+	cellCount = grid.GetCellCount();
+	wordsPerCell = (cellCount + 63) / 64;
+	bits.assign(static_cast<std::size_t>(cellCount) * wordsPerCell, 0);
+
+	// Each cell only writes to its own row, so the jobs never touch the same words.
+	// Walks from cells in open areas take much longer than others, so the batches are small.
+	jobs.ParallelFor(cellCount, 4, [&](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t cell = begin; cell < end; cell++)
+		{
+			PortalWalker walker(grid, &bits[cell * wordsPerCell]);
+			walker.Walk(static_cast<int>(cell % grid.GetWidth()), static_cast<int>(cell / grid.GetWidth()), 0, 0);
+		}
+	});
+}
+
+/// <summary>
+/// Loads the sets from a file written by Save(). The file is rejected if it was
+/// computed for a different maze.
+/// </summary>
+/// <param name="filePath">Path of the file</param>
+/// <param name="grid">Grid the sets must belong to</param>
+/// <returns>True if the file was loaded</returns>
+bool PotentiallyVisibleSet::Load(const std::string& filePath, const CellGrid& grid)
+{
+	std::ifstream file(filePath, std::ios::binary);
+	if (file.fail())
+	{
+		return false;
+	}
+
+	PvsFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || std::memcmp(header.magic, "PVS1", 4) != 0 || header.width != grid.GetWidth()
+		|| header.depth != grid.GetDepth() || header.wallHash != HashWalls(grid))
+	{
+		return false;
+	}
+
+	int loadedCellCount = grid.GetCellCount();
+	int loadedWordsPerCell = (loadedCellCount + 63) / 64;
+	std::vector<std::uint64_t> loadedBits(static_cast<std::size_t>(loadedCellCount) * loadedWordsPerCell);
+	file.read(reinterpret_cast<char*>(loadedBits.data()), loadedBits.size() * sizeof(std::uint64_t));
+	if (!file)
+	{
+		return false;
+	}
+
+	cellCount = loadedCellCount;
+	wordsPerCell = loadedWordsPerCell;
+	bits.swap(loadedBits);
+	return true;
+}
+
+/// <summary>
+/// Saves the sets to a file, so they do not need to be computed on the next launch.
+/// </summary>
+/// <param name="filePath">Path of the file</param>
+/// <param name="grid">Grid the sets were computed for</param>
+/// <returns>True if the file was written</returns>
+bool PotentiallyVisibleSet::Save(const std::string& filePath, const CellGrid& grid) const
+{
+	std::ofstream file(filePath, std::ios::binary);
+	if (file.fail())
+	{
+		return false;
+	}
+
+	PvsFileHeader header;
+	std::memcpy(header.magic, "PVS1", 4);
+	header.width = grid.GetWidth();
+	header.depth = grid.GetDepth();
+	header.wallHash = HashWalls(grid);
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(bits.data()), bits.size() * sizeof(std::uint64_t));
+	return static_cast<bool>(file);
+}
+
+/// <summary>
+/// Removes every cell that cannot be seen from a cell from a list of cells.
+/// </summary>
+/// <param name="fromCell">Cell containing the viewer</param>
+/// <param name="cells">List of cells to filter</param>
+void PotentiallyVisibleSet::Filter(int fromCell, std::vector<int>& cells) const
+{
+	std::size_t kept = 0;
+	for (int cell : cells)
+	{
+		if (IsVisible(fromCell, cell))
+		{
+			cells[kept++] = cell;
+		}
+	}
+
+	cells.resize(kept);
+}
+
+/// <summary>
+/// Hashes the walls of a grid (FNV-1a), to detect files computed for another maze.
+/// </summary>
+/// <param name="grid">Grid containing the walls</param>
+/// <returns>Hash of the blocked sides of every cell</returns>
+std::uint64_t PotentiallyVisibleSet::HashWalls(const CellGrid& grid)
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	for (int z = 0; z < grid.GetDepth(); z++)
+	{
+		for (int x = 0; x < grid.GetWidth(); x++)
+		{
+			unsigned sides = (grid.IsBlocked(x, z, CellSide::NegativeX) ? 1 : 0)
+				| (grid.IsBlocked(x, z, CellSide::PositiveX) ? 2 : 0)
+				| (grid.IsBlocked(x, z, CellSide::NegativeZ) ? 4 : 0)
+				| (grid.IsBlocked(x, z, CellSide::PositiveZ) ? 8 : 0);
+			hash = (hash ^ sides) * 1099511628211ull;
+		}
+	}
+
+	return hash;
+}
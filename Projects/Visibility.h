@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CellGrid.h"
+#include "JobSystem.h"
+
+/// <summary>
+/// Largest number of cells the potentially visible set is computed for. The set holds one bit
+/// per pair of cells, so this keeps it at 128 MB; larger mazes are meant for --streaming.
+/// </summary>
+const int MaxPotentiallyVisibleSetCells = 32768;
+
+/// <summary>
+/// Potentially visible set of every cell of an orthogonal maze, stored as one bitset per cell.
+/// Cell B is in the set of cell A if some straight line leaves A, passes through the openings
+/// (portals) between the cells on the way, and enters B without touching a wall. The walls
+/// are full height, so the test only needs to be done in the top-down plane.
+/// </summary>
+class PotentiallyVisibleSet
+{
+public:
+	/// <summary>
+	/// Computes the set of every cell by walking through the portals from each cell in turn,
+	/// stopping once no straight line can pass through all of the portals on the way.
+	/// The cells are split between the workers of the job system.
+	/// </summary>
+	/// <param name="grid">Grid containing the walls of the maze</param>
+	/// <param name="jobs">Job system running the walks</param>
+	void Compute(const CellGrid& grid, JobSystem& jobs);
+
+	/// <summary>
+	/// Loads the sets from a file written by Save(). The file is rejected if it was
+	/// computed for a different maze.
+	/// </summary>
+	/// <param name="filePath">Path of the file</param>
+	/// <param name="grid">Grid the sets must belong to</param>
+	/// <returns>True if the file was loaded</returns>
+	bool Load(const std::string& filePath, const CellGrid& grid);
+
+	/// <summary>
+	/// Saves the sets to a file, so they do not need to be computed on the next launch.
+	/// </summary>
+	/// <param name="filePath">Path of the file</param>
+	/// <param name="grid">Grid the sets were computed for</param>
+	/// <returns>True if the file was written</returns>
+	bool Save(const std::string& filePath, const CellGrid& grid) const;
+
+	/// <summary>
+	/// Checks whether a cell can be seen from another.
+	/// </summary>
+	/// <param name="fromCell">Cell containing the viewer</param>
+	/// <param name="cell">Cell being tested</param>
+	/// <returns>True if the cell is potentially visible</returns>
+	bool IsVisible(int fromCell, int cell) const
+	{
+		return (bits[fromCell * wordsPerCell + cell / 64] >> (cell % 64)) & 1;
+	}
+
+	/// <summary>
+	/// Removes every cell that cannot be seen from a cell from a list of cells.
+	/// </summary>
+	/// <param name="fromCell">Cell containing the viewer</param>
+	/// <param name="cells">List of cells to filter</param>
+	void Filter(int fromCell, std::vector<int>& cells) const;
+
+	/// <summary>
+	/// True once the sets have been computed or loaded
+	/// </summary>
+	bool IsValid() const { return cellCount > 0; }
+
+private:
+	static std::uint64_t HashWalls(const CellGrid& grid);
+
+	int cellCount = 0;
+	int wordsPerCell = 0;
+	std::vector<std::uint64_t> bits;	// wordsPerCell words for every cell
+};
@@ -0,0 +1,409 @@
+#include "WorldStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+	// Chunks within this distance beyond the load distance are kept once loaded, so a camera
+	// moving back and forth across the edge does not load and evict the same chunks every frame
+	const float KeepMargin = WorldStreamer::ChunkCells * CellGrid::CellSize * 0.5f;
+
+	// Bytes of buffers uploaded per frame. At least one chunk is uploaded per frame however large it is.
+	const std::size_t UploadBytesPerFrame = 1 << 20;
+
+	// Size of a chunk before any was measured: every cell with a floor and four walls
+	const std::size_t WorstCaseChunkBytes = WorldStreamer::ChunkCells * WorldStreamer::ChunkCells * 5
+		* (4 * sizeof(WorldVertex) + 6 * sizeof(GLushort));
+}
+
+/// <summary>
+/// Prepares to stream a maze. Nothing is loaded until the first call to Update().
+/// </summary>
+/// <param name="mazeSource">Maze to stream, which must outlive the streamer</param>
+/// <param name="cubeVertices">Vertices of the cube, 4 per face</param>
+/// <param name="cubeIndices">Indices of the cube, 6 per face</param>
+/// <param name="jobSystem">Job system the chunks are built on</param>
+/// <param name="memoryBudget">Largest number of bytes of vertex and index buffers to keep on the GPU</param>
+/// <param name="loadDistance">Distance from the camera within which chunks are loaded</param>
+/// <param name="mergeTiles">Whether to merge the tiles of each chunk into larger quads</param>
+void WorldStreamer::Create(const MazeSource& mazeSource, const std::vector<MeshVertex>& cubeVertices, const std::vector<GLuint>& cubeIndices,
+	JobSystem& jobSystem, std::size_t memoryBudget, float loadDistance, bool mergeTiles)
+{
+	source = &mazeSource;
+	vertices = &cubeVertices;
+	indices = &cubeIndices;
+	jobs = &jobSystem;
+	budget = memoryBudget;
+	distanceLimit = loadDistance;
+	merge = mergeTiles;
+	residentBytes = 0;
+	averageChunkBytes = 0;
+	buildingCount = 0;
+}
+
+/// <summary>
+/// Starts building the chunks the camera needs, uploads the chunks that finished building,
+/// and evicts the chunks that are too far away or over the budget.
+/// </summary>
+/// <param name="cameraPosition">World-space position of the camera</param>
+void WorldStreamer::Update(const glm::vec3& cameraPosition)
+{
+	// Without worker threads, nothing builds the chunks unless this thread does, one per frame
+	if (jobs->GetWorkerCount() == 1 && buildingCount > 0)
+	{
+		jobs->RunPendingJob();
+	}
+
+	// Chunks that are not loaded yet are assumed to be as large as the loaded ones
+	std::size_t chunkBytes = averageChunkBytes > 0 ? averageChunkBytes : WorstCaseChunkBytes;
+
+	// Every chunk within reach of the camera, nearest first
+	float chunkSize = ChunkCells * CellGrid::CellSize;
+	int chunkColumns = (source->GetWidth() + ChunkCells - 1) / ChunkCells;
+	int chunkRows = (source->GetDepth() + ChunkCells - 1) / ChunkCells;
+	glm::vec2 cameraCell = source->GetCellCoordinates(cameraPosition);
+	float reach = (distanceLimit + KeepMargin) / chunkSize;
+	int x0 = std::max(static_cast<int>(std::floor(cameraCell.x / ChunkCells - reach)), 0);
+	int z0 = std::max(static_cast<int>(std::floor(cameraCell.y / ChunkCells - reach)), 0);
+	int x1 = std::min(static_cast<int>(std::floor(cameraCell.x / ChunkCells + reach)) + 1, chunkColumns);
+	int z1 = std::min(static_cast<int>(std::floor(cameraCell.y / ChunkCells + reach)) + 1, chunkRows);
+
+	requests.clear();
+	for (int z = z0; z < z1; z++)
+	{
+		for (int x = x0; x < x1; x++)
+		{
+			float distance = GetDistance(x, z, cameraPosition);
+			if (distance <= distanceLimit + KeepMargin)
+			{
+				requests.push_back({ distance, x, z });
+			}
+		}
+	}
+
+	std::sort(requests.begin(), requests.end(), [](const ChunkRequest& a, const ChunkRequest& b)
+	{
+		return a.distance < b.distance || (a.distance == b.distance && (a.z < b.z || (a.z == b.z && a.x < b.x)));
+	});
+
+	// Only request the nearest chunks that fit in the budget together, so that chunks are
+	// only built when there will be room for them. The same limit decides what is evicted,
+	// so no chunk is evicted for the budget and then requested again on the next frame.
+	std::size_t requestedBytes = 0;
+	std::size_t fittingCount = 0;
+	for (; fittingCount < requests.size(); fittingCount++)
+	{
+		auto found = chunks.find(GetKey(requests[fittingCount].x, requests[fittingCount].z));
+		std::size_t bytes = found != chunks.end() ? GetChunkBytes(*found->second, chunkBytes) : chunkBytes;
+		if (fittingCount > 0 && requestedBytes + bytes > budget)
+		{
+			break;
+		}
+		requestedBytes += bytes;
+	}
+	requests.resize(fittingCount);
+
+	// Keep the loaded chunks that are still needed, and start building the missing ones that
+	// are within the load distance. A few builds at a time are enough to keep every worker busy.
+	for (auto& entry : chunks)
+	{
+		entry.second->wanted = false;
+	}
+
+	int maxBuilding = static_cast<int>(jobs->GetWorkerCount()) * 2;
+	for (const ChunkRequest& request : requests)
+	{
+		auto found = chunks.find(GetKey(request.x, request.z));
+		if (found != chunks.end())
+		{
+			found->second->wanted = true;
+			found->second->distance = request.distance;
+			continue;
+		}
+
+		if (request.distance > distanceLimit || buildingCount >= maxBuilding)
+		{
+			continue;
+		}
+
+		std::unique_ptr<Chunk> chunk(new Chunk());
+		chunk->x = request.x;
+		chunk->z = request.z;
+		chunk->distance = request.distance;
+		source->GetBounds(request.x * ChunkCells, request.z * ChunkCells, std::min((request.x + 1) * ChunkCells, source->GetWidth()),
+			std::min((request.z + 1) * ChunkCells, source->GetDepth()), chunk->boundsMin, chunk->boundsMax);
+
+		Chunk* building = chunk.get();
+		chunks.emplace(GetKey(request.x, request.z), std::move(chunk));
+		jobs->Run(jobs->CreateJob([this, building]() { Build(*building); }));
+		buildingCount++;
+	}
+
+	// Evict the chunks that are no longer needed. Chunks still being built are left to their
+	// job, and evicted once it is done.
+	evicted.clear();
+	uploads.clear();
+	changedBounds.clear();
+	buildingCount = 0;
+	for (auto& entry : chunks)
+	{
+		Chunk& chunk = *entry.second;
+		int state = chunk.state.load(std::memory_order_acquire);
+		if (state == Building)
+		{
+			buildingCount++;
+		}
+		else if (!chunk.wanted)
+		{
+			evicted.push_back(entry.first);
+		}
+		else if (state == Built)
+		{
+			uploads.push_back(&chunk);
+		}
+	}
+
+	for (std::uint64_t key : evicted)
+	{
+		Evict(key);
+	}
+
+	// Upload the nearest chunks first, a limited number of bytes per frame. A chunk that came
+	// out larger than estimated and no longer fits waits, and is measured by the next request.
+	std::sort(uploads.begin(), uploads.end(), [](const Chunk* a, const Chunk* b) { return a->distance < b->distance; });
+	std::size_t uploadedBytes = 0;
+	for (Chunk* chunk : uploads)
+	{
+		if (uploadedBytes >= UploadBytesPerFrame)
+		{
+			break;
+		}
+		if (residentBytes > 0 && residentBytes + GetChunkBytes(*chunk, chunkBytes) > budget)
+		{
+			continue;
+		}
+
+		chunk->world.Upload(chunk->baked);
+		chunk->baked = BakedWorld();
+		chunk->state.store(Resident, std::memory_order_relaxed);
+		changedBounds.push_back(chunk->boundsMin);
+		changedBounds.push_back(chunk->boundsMax);
+		uploadedBytes += chunk->world.GetGpuBytes();
+		residentBytes += chunk->world.GetGpuBytes();
+	}
+
+	std::size_t residentCount = 0;
+	for (auto& entry : chunks)
+	{
+		if (entry.second->state.load(std::memory_order_relaxed) == Resident)
+		{
+			residentCount++;
+		}
+	}
+	if (residentCount > 0)
+	{
+		averageChunkBytes = residentBytes / residentCount;
+	}
+}
+
+/// <summary>
+/// Finds the cells of the resident chunks that are inside the frustum.
+/// </summary>
+/// <param name="frustum">View frustum</param>
+/// <param name="cameraPosition">World-space position of the camera</param>
+/// <param name="frontToBack">Whether to order the chunks and their cells from the nearest to the farthest</param>
+void WorldStreamer::Cull(const Frustum& frustum, const glm::vec3& cameraPosition, bool frontToBack)
+{
+	visibleChunks.clear();
+	for (auto& entry : chunks)
+	{
+		Chunk& chunk = *entry.second;
+		if (chunk.state.load(std::memory_order_relaxed) != Resident || frustum.TestBox(chunk.boundsMin, chunk.boundsMax) == FrustumTest::Outside)
+		{
+			continue;
+		}
+
+		chunk.grid.CullFrustum(frustum, chunk.visibleCells);
+		if (chunk.visibleCells.empty())
+		{
+			continue;
+		}
+
+		if (frontToBack)
+		{
+			chunk.grid.SortFrontToBack(cameraPosition, chunk.visibleCells);
+		}
+		chunk.distance = GetDistance(chunk.x, chunk.z, cameraPosition);
+		visibleChunks.push_back(&chunk);
+	}
+
+	// The map has no useful order, so sort the chunks even when not drawing front to back,
+	// which keeps the draw order the same from one run to the next
+	if (frontToBack)
+	{
+		std::sort(visibleChunks.begin(), visibleChunks.end(), [](const Chunk* a, const Chunk* b)
+		{
+			return a->distance < b->distance || (a->distance == b->distance && (a->z < b->z || (a->z == b->z && a->x < b->x)));
+		});
+	}
+	else
+	{
+		std::sort(visibleChunks.begin(), visibleChunks.end(), [](const Chunk* a, const Chunk* b)
+		{
+			return a->z < b->z || (a->z == b->z && a->x < b->x);
+		});
+	}
+}
+
+/// <summary>
+/// Draws the cells found by the last call to Cull(), with one draw call per chunk.
+/// The shader program must already be in use.
+/// </summary>
+void WorldStreamer::Draw()
+{
+	drawCount = 0;
+	drawnTriangleCount = 0;
+	for (Chunk* chunk : visibleChunks)
+	{
+		chunk->world.Draw(chunk->visibleCells);
+		drawCount += chunk->world.GetDrawCount();
+		drawnTriangleCount += chunk->world.GetTriangleCount();
+	}
+}
+
+/// <summary>
+/// Waits for the chunks being built and deletes every chunk.
+/// </summary>
+void WorldStreamer::Destroy()
+{
+	for (auto& entry : chunks)
+	{
+		while (entry.second->state.load(std::memory_order_acquire) == Building)
+		{
+			if (!jobs->RunPendingJob())
+			{
+				std::this_thread::yield();
+			}
+		}
+		entry.second->world.Destroy();
+	}
+
+	chunks.clear();
+	visibleChunks.clear();
+	residentBytes = 0;
+	buildingCount = 0;
+}
+
+/// <summary>
+/// Checks whether the last call to Update() uploaded or evicted a chunk within a region,
+/// for views of the scene that are only drawn again when their geometry changes.
+/// </summary>
+/// <param name="region">Region of the scene, such as the range of a light</param>
+/// <returns>True if a chunk that touches the region was uploaded or evicted</returns>
+bool WorldStreamer::HasChangedWithin(const Frustum& region) const
+{
+	for (std::size_t i = 0; i + 1 < changedBounds.size(); i += 2)
+	{
+		if (region.TestBox(changedBounds[i], changedBounds[i + 1]) != FrustumTest::Outside)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/// <summary>
+/// Formats the state of the streamer.
+/// </summary>
+/// <returns>One line of text, such as "24 chunks, 12.3/64.0 MB, 2 loading"</returns>
+std::string WorldStreamer::FormatReadout() const
+{
+	int residentCount = 0;
+	for (const auto& entry : chunks)
+	{
+		if (entry.second->state.load(std::memory_order_relaxed) == Resident)
+		{
+			residentCount++;
+		}
+	}
+
+	char text[128];
+	std::snprintf(text, sizeof(text), "%d chunks, %.1f/%.1f MB, %d loading", residentCount,
+		residentBytes / (1024.0 * 1024.0), budget / (1024.0 * 1024.0), buildingCount);
+	return text;
+}
+
+/// <summary>
+/// Gathers and bakes the tiles of a chunk. Runs on a worker thread.
+/// </summary>
+/// <param name="chunk">Chunk to build</param>
+void WorldStreamer::Build(Chunk& chunk) const
+{
+	std::vector<Tile> tiles;
+	source->GatherTiles(chunk.x * ChunkCells, chunk.z * ChunkCells, std::min((chunk.x + 1) * ChunkCells, source->GetWidth()),
+		std::min((chunk.z + 1) * ChunkCells, source->GetDepth()), tiles);
+
+	chunk.grid.Build(tiles);
+	StaticWorld::Bake(chunk.grid, *vertices, *indices, chunk.baked, merge);
+	chunk.state.store(Built, std::memory_order_release);
+}
+
+/// <summary>
+/// Deletes the buffers of a chunk and removes it from the map.
+/// </summary>
+/// <param name="key">Key of the chunk</param>
+void WorldStreamer::Evict(std::uint64_t key)
+{
+	auto found = chunks.find(key);
+	if (found->second->state.load(std::memory_order_relaxed) == Resident)
+	{
+		residentBytes -= found->second->world.GetGpuBytes();
+		changedBounds.push_back(found->second->boundsMin);
+		changedBounds.push_back(found->second->boundsMax);
+	}
+	found->second->world.Destroy();
+	chunks.erase(found);
+}
+
+/// <summary>
+/// Finds how many bytes of vertex and index buffers a chunk takes, or will take once uploaded.
+/// </summary>
+/// <param name="chunk">Chunk to measure</param>
+/// <param name="estimate">Size assumed for a chunk that is still building</param>
+/// <returns>Size of the buffers of the chunk, in bytes</returns>
+std::size_t WorldStreamer::GetChunkBytes(const Chunk& chunk, std::size_t estimate) const
+{
+	int state = chunk.state.load(std::memory_order_acquire);
+	if (state == Resident)
+	{
+		return chunk.world.GetGpuBytes();
+	}
+	if (state == Built)
+	{
+		// Upload() picks 16-bit indices whenever the vertices allow it
+		std::size_t indexSize = chunk.baked.vertices.size() > 65536 ? sizeof(GLuint) : sizeof(GLushort);
+		return chunk.baked.vertices.size() * sizeof(WorldVertex) + chunk.baked.indices.size() * indexSize;
+	}
+
+	return estimate;
+}
+
+/// <summary>
+/// Measures the distance between the camera and the closest point of a chunk, in the plane of the maze.
+/// </summary>
+/// <param name="x">Column of the chunk</param>
+/// <param name="z">Row of the chunk</param>
+/// <param name="cameraPosition">World-space position of the camera</param>
+/// <returns>Distance in world units, 0 inside the chunk</returns>
+float WorldStreamer::GetDistance(int x, int z, const glm::vec3& cameraPosition) const
+{
+	glm::vec3 boxMin, boxMax;
+	source->GetBounds(x * ChunkCells, z * ChunkCells, (x + 1) * ChunkCells, (z + 1) * ChunkCells, boxMin, boxMax);
+	glm::vec2 camera(cameraPosition.x, cameraPosition.z);
+	glm::vec2 closest = glm::clamp(camera, glm::vec2(boxMin.x, boxMin.z), glm::vec2(boxMax.x, boxMax.z));
+	return glm::length(camera - closest);
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CellGrid.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "MazeSource.h"
+#include "StaticWorld.h"
+
+/// <summary>
+/// Keeps the part of a large maze around the camera on the GPU. The maze is split into square
+/// chunks of cells, each baked into its own StaticWorld. Chunks near the camera are gathered
+/// and baked by the job system and uploaded a few per frame. Only the nearest chunks whose
+/// GPU memory fits in the budget together are kept, and the others are evicted. The work
+/// done per frame only depends on the load distance and the budget, never on the size of
+/// the maze.
+/// </summary>
+class WorldStreamer
+{
+public:
+	/// <summary>
+	/// Number of cells along each side of a chunk
+	/// </summary>
+	static const int ChunkCells = 16;
+
+	/// <summary>
+	/// Prepares to stream a maze. Nothing is loaded until the first call to Update().
+	/// </summary>
+	/// <param name="mazeSource">Maze to stream, which must outlive the streamer</param>
+	/// <param name="cubeVertices">Vertices of the cube, 4 per face</param>
+	/// <param name="cubeIndices">Indices of the cube, 6 per face</param>
+	/// <param name="jobSystem">Job system the chunks are built on</param>
+	/// <param name="memoryBudget">Largest number of bytes of vertex and index buffers to keep on the GPU</param>
+	/// <param name="loadDistance">Distance from the camera within which chunks are loaded</param>
+	/// <param name="mergeTiles">Whether to merge the tiles of each chunk into larger quads</param>
+	void Create(const MazeSource& mazeSource, const std::vector<MeshVertex>& cubeVertices, const std::vector<GLuint>& cubeIndices,
+		JobSystem& jobSystem, std::size_t memoryBudget, float loadDistance, bool mergeTiles);
+
+	/// <summary>
+	/// Starts building the chunks the camera needs, uploads the chunks that finished building,
+	/// and evicts the chunks that are too far away or over the budget.
+	/// </summary>
+	/// <param name="cameraPosition">World-space position of the camera</param>
+	void Update(const glm::vec3& cameraPosition);
+
+	/// <summary>
+	/// Finds the cells of the resident chunks that are inside the frustum.
+	/// </summary>
+	/// <param name="frustum">View frustum</param>
+	/// <param name="cameraPosition">World-space position of the camera</param>
+	/// <param name="frontToBack">Whether to order the chunks and their cells from the nearest to the farthest</param>
+	void Cull(const Frustum& frustum, const glm::vec3& cameraPosition, bool frontToBack);
+
+	/// <summary>
+	/// Checks whether the last call to Update() uploaded or evicted a chunk within a region,
+	/// for views of the scene that are only drawn again when their geometry changes.
+	/// </summary>
+	/// <param name="region">Region of the scene, such as the range of a light</param>
+	/// <returns>True if a chunk that touches the region was uploaded or evicted</returns>
+	bool HasChangedWithin(const Frustum& region) const;
+
+	/// <summary>
+	/// Draws the cells found by the last call to Cull(), with one draw call per chunk.
+	/// The shader program must already be in use.
+	/// </summary>
+	void Draw();
+
+	/// <summary>
+	/// Waits for the chunks being built and deletes every chunk.
+	/// </summary>
+	void Destroy();
+
+	/// <summary>
+	/// Formats the state of the streamer.
+	/// </summary>
+	/// <returns>One line of text, such as "24 chunks, 12.3/64.0 MB, 2 loading"</returns>
+	std::string FormatReadout() const;
+
+	/// <summary>
+	/// Number of draw calls issued by the last call to Draw()
+	/// </summary>
+	int GetDrawCount() const { return drawCount; }
+
+	/// <summary>
+	/// Number of triangles drawn by the last call to Draw()
+	/// </summary>
+	long long GetTriangleCount() const { return drawnTriangleCount; }
+
+	/// <summary>
+	/// Bytes of vertex and index buffers used by the resident chunks
+	/// </summary>
+	std::size_t GetResidentBytes() const { return residentBytes; }
+
+private:
+	/// <summary>
+	/// Progress of a chunk. Only the building state is left by a worker thread.
+	/// </summary>
+	enum ChunkState
+	{
+		Building,	// A job is gathering and baking the tiles
+		Built,		// Baked on the CPU, waiting to be uploaded
+		Resident,	// Uploaded to the GPU
+	};
+
+	/// <summary>
+	/// A square of cells with its own buffers
+	/// </summary>
+	struct Chunk
+	{
+		int x = 0, z = 0;					// Chunk coordinates
+		std::atomic<int> state{ Building };
+		bool wanted = true;					// Cleared when the camera moved away while the chunk was building
+		float distance = 0.0f;				// Distance from the camera at the last update
+		glm::vec3 boundsMin, boundsMax;
+		CellGrid grid;						// Tiles of the chunk, sorted by cell
+		BakedWorld baked;					// Released once uploaded
+		StaticWorld world;
+		std::vector<int> visibleCells;		// Cells found by the last Cull()
+	};
+
+	/// <summary>
+	/// Chunk that the camera needs, whether it exists yet or not
+	/// </summary>
+	struct ChunkRequest
+	{
+		float distance;
+		int x, z;
+	};
+
+	/// <summary>
+	/// Gathers and bakes the tiles of a chunk. Runs on a worker thread.
+	/// </summary>
+	/// <param name="chunk">Chunk to build</param>
+	void Build(Chunk& chunk) const;
+
+	/// <summary>
+	/// Deletes the buffers of a chunk and removes it from the map.
+	/// </summary>
+	/// <param name="key">Key of the chunk</param>
+	void Evict(std::uint64_t key);
+
+	/// <summary>
+	/// Finds how many bytes of vertex and index buffers a chunk takes, or will take once uploaded.
+	/// </summary>
+	/// <param name="chunk">Chunk to measure</param>
+	/// <param name="estimate">Size assumed for a chunk that is still building</param>
+	/// <returns>Size of the buffers of the chunk, in bytes</returns>
+	std::size_t GetChunkBytes(const Chunk& chunk, std::size_t estimate) const;
+
+	/// <summary>
+	/// Measures the distance between the camera and the closest point of a chunk, in the plane of the maze.
+	/// </summary>
+	/// <param name="x">Column of the chunk</param>
+	/// <param name="z">Row of the chunk</param>
+	/// <param name="cameraPosition">World-space position of the camera</param>
+	/// <returns>Distance in world units, 0 inside the chunk</returns>
+	float GetDistance(int x, int z, const glm::vec3& cameraPosition) const;
+
+	/// <summary>
+	/// Combines the coordinates of a chunk into a map key.
+	/// </summary>
+	static std::uint64_t GetKey(int x, int z) { return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(z)) << 32) | static_cast<std::uint32_t>(x); }
+
+	const MazeSource* source = nullptr;
+	const std::vector<MeshVertex>* vertices = nullptr;
+	const std::vector<GLuint>* indices = nullptr;
+	JobSystem* jobs = nullptr;
+	std::size_t budget = 0;
+	float distanceLimit = 0.0f;
+	bool merge = false;
+
+	std::unordered_map<std::uint64_t, std::unique_ptr<Chunk>> chunks;
+	std::size_t residentBytes = 0;
+	std::size_t averageChunkBytes = 0;	// Measured size of a chunk, assumed for the chunks that are not loaded yet
+	int buildingCount = 0;
+
+	// Lists gathered by Update() and Cull(), kept around to avoid reallocating them every frame
+	std::vector<ChunkRequest> requests;
+	std::vector<Chunk*> uploads;
+	std::vector<std::uint64_t> evicted;
+	std::vector<Chunk*> visibleChunks;
+	std::vector<glm::vec3> changedBounds;	// Minimum and maximum corners of the chunks uploaded or evicted by Update()
+
+	int drawCount = 0;
+	long long drawnTriangleCount = 0;
+};
@@ -0,0 +1,53 @@
+// Clustered point lights (see ClusteredLights.h), shared by the forward and deferred shading.
+// CLUSTER_COLUMNS, CLUSTER_ROWS and CLUSTER_SLICES are defined by ClusteredLights::GetShaderDefines().
+// Uses camLoc, so frame.glsl must be included first.
+
+// Two texels per light: position and radius, then color
+uniform samplerBuffer lightData;
+
+// First index and number of lights of every cluster, slice by slice, row by row
+uniform usamplerBuffer clusterRanges;
+
+// Lists of the light indices of the clusters
+uniform usamplerBuffer lightIndices;
+
+// Size of a tile of clusters in pixels, and the near and far planes the slices span
+uniform vec2 clusterSize;
+uniform vec2 clusterDepthRange;
+
+// Adds up the diffuse light of the point lights whose spheres touch the cluster of a pixel.
+// The cluster is found from the pixel and the depth, sliced like on the CPU.
+vec3 ShadeClusteredLights(vec3 worldPosition, vec3 worldNormal, float windowDepth)
+{
+	float near = clusterDepthRange.x;
+	float far = clusterDepthRange.y;
+	float ndcDepth = windowDepth * 2.0 - 1.0;
+	float depth = 2.0 * near * far / (far + near - ndcDepth * (far - near));
+
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterSize), ivec2(0), ivec2(CLUSTER_COLUMNS - 1, CLUSTER_ROWS - 1));
+	int slice = clamp(int(log(depth / near) * (float(CLUSTER_SLICES) / log(far / near))), 0, CLUSTER_SLICES - 1);
+	uvec2 range = texelFetch(clusterRanges, (slice * CLUSTER_ROWS + tile.y) * CLUSTER_COLUMNS + tile.x).xy;
+
+	// Walls are single quads seen from both sides, so the normal is turned towards the camera
+	vec3 normal = normalize(worldNormal);
+	if (dot(normal, camLoc - worldPosition) < 0.0)
+	{
+		normal = -normal;
+	}
+
+	vec3 light = vec3(0.0);
+	for (uint i = 0u; i < range.y; i++)
+	{
+		int index = int(texelFetch(lightIndices, int(range.x + i)).x);
+		vec4 positionRadius = texelFetch(lightData, index * 2);
+		vec3 color = texelFetch(lightData, index * 2 + 1).rgb;
+
+		// Smooth falloff that reaches zero at the radius, so lights can be cut off at their cluster
+		vec3 toLight = positionRadius.xyz - worldPosition;
+		float distance = length(toLight);
+		float falloff = clamp(1.0 - distance / positionRadius.w, 0.0, 1.0);
+		float lambert = max(dot(normal, toLight / max(distance, 0.0001)), 0.0);
+		light += color * (lambert * falloff * falloff);
+	}
+	return light;
+}
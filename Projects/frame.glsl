@@ -0,0 +1,24 @@
+// Values shared by every shader program, uploaded once per frame (see FrameUniforms.h).
+// Uses the std140 layout, so each vec3 is padded to 16 bytes by the float after it.
+layout(std140) uniform FrameUniforms
+{
+	mat4 viewProjection;
+
+	vec3 ambientLightColor;
+	float shiny;
+
+	vec3 diffuseLightColor;
+	float time;
+
+	vec3 specularLightColor;
+	float framePadding0;
+
+	vec3 objectSpecularColor;
+	float framePadding1;
+
+	vec3 lightLoc;
+	float framePadding2;
+
+	vec3 camLoc;
+	float framePadding3;
+};
@@ -0,0 +1,28 @@
+// Values shared by the passes of the deferred renderer (see DeferredRenderer.h)
+
+// Range of the light of lightLoc stored in the alpha channel of the albedo
+#define GBUFFER_LIGHT_RANGE 2.0
+
+// Octahedral encoding of unit vectors (Cigolle et al., "A Survey of Efficient Representations
+// for Independent Unit Vectors"): the vector is projected onto an octahedron, whose lower half
+// is folded over the upper half, giving a square. Mapped to [0, 1] so unsigned formats store it.
+
+vec2 EncodeOctahedral(vec3 normal)
+{
+	vec2 square = normal.xz / (abs(normal.x) + abs(normal.y) + abs(normal.z));
+	if (normal.y < 0.0)
+	{
+		square = (1.0 - abs(square.yx)) * vec2(square.x >= 0.0 ? 1.0 : -1.0, square.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return square * 0.5 + 0.5;
+}
+
+vec3 DecodeOctahedral(vec2 encoded)
+{
+	vec2 square = encoded * 2.0 - 1.0;
+	vec3 normal = vec3(square.x, 1.0 - abs(square.x) - abs(square.y), square.y);
+	float fold = clamp(-normal.y, 0.0, 1.0);
+	normal.x += normal.x >= 0.0 ? -fold : fold;
+	normal.z += normal.z >= 0.0 ? -fold : fold;
+	return normalize(normal);
+}
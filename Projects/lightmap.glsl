@@ -0,0 +1,61 @@
+// Baked static lighting (see Lightmap.h). Each cell has five surfaces, one per layer: the
+// floor, then the sides of its walls at -x, +x, -z and +z that face into the cell. Within a
+// layer, every cell covers a square of texels at its place in the grid. Uses camLoc, so
+// frame.glsl must be included first.
+
+// Gray level of the light baked on every texel
+uniform sampler2DArray lightmap;
+
+// Minimum corner of the grid at the floor, number of cells, and size of a cell and height of the walls
+uniform vec3 lightmapOrigin;
+uniform vec2 lightmapCellCount;
+uniform vec2 lightmapCellSize;
+
+// Texels along each side of a surface
+uniform float lightmapTexelsPerSide;
+
+// Looks up the baked light of a point of the maze, from its world-space position and normal
+float SampleLightmap(vec3 worldPosition, vec3 worldNormal)
+{
+	// Walls are single quads seen from both sides, so the side facing the camera is looked up
+	vec3 normal = worldNormal;
+	if (dot(normal, camLoc - worldPosition) < 0.0)
+	{
+		normal = -normal;
+	}
+
+	vec3 local = worldPosition - lightmapOrigin;
+	vec2 cellCoordinates = local.xz / lightmapCellSize.x;
+	float height = local.y / lightmapCellSize.y;
+
+	// The cell the surface faces, and where the point is on the surface
+	vec2 cell;
+	vec2 surfaceCoordinates;
+	float layer;
+	if (abs(normal.y) > 0.5)
+	{
+		cell = floor(cellCoordinates);
+		surfaceCoordinates = cellCoordinates - cell;
+		layer = 0.0;
+	}
+	else if (abs(normal.x) > abs(normal.z))
+	{
+		float edge = floor(cellCoordinates.x + 0.5);
+		cell = vec2(normal.x > 0.0 ? edge : edge - 1.0, floor(cellCoordinates.y));
+		surfaceCoordinates = vec2(cellCoordinates.y - cell.y, height);
+		layer = normal.x > 0.0 ? 1.0 : 2.0;
+	}
+	else
+	{
+		float edge = floor(cellCoordinates.y + 0.5);
+		cell = vec2(floor(cellCoordinates.x), normal.z > 0.0 ? edge : edge - 1.0);
+		surfaceCoordinates = vec2(cellCoordinates.x - cell.x, height);
+		layer = normal.z > 0.0 ? 3.0 : 4.0;
+	}
+
+	// Keep the filtering within the texels of the surface, since its neighbours in the
+	// texture belong to other surfaces
+	float halfTexel = 0.5 / lightmapTexelsPerSide;
+	surfaceCoordinates = clamp(surfaceCoordinates, halfTexel, 1.0 - halfTexel);
+	return texture(lightmap, vec3((cell + surfaceCoordinates) / lightmapCellCount, layer)).r;
+}
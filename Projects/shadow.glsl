@@ -0,0 +1,48 @@
+// Omnidirectional shadow of the light at lightLoc (see ShadowMap.h). Each face of the cube
+// map holds the depth seen through a 90 degree perspective projection from the light, so the
+// depth a point is compared with comes from its distance along the major axis. Uses lightLoc,
+// so frame.glsl must be included first.
+
+// Depth of the scene around the light, compared by the sampler
+uniform samplerCubeShadow shadowMap;
+
+// Near and far planes of the projection of the faces, and the number of texels along each side of a face
+uniform vec3 shadowParameters;
+
+// Offsets of the filter taps, towards the corners of a cube around the point
+const vec3 ShadowTapOffsets[8] = vec3[](
+	vec3(1.0, 1.0, 1.0), vec3(-1.0, 1.0, 1.0), vec3(1.0, -1.0, 1.0), vec3(-1.0, -1.0, 1.0),
+	vec3(1.0, 1.0, -1.0), vec3(-1.0, 1.0, -1.0), vec3(1.0, -1.0, -1.0), vec3(-1.0, -1.0, -1.0));
+
+// Looks up how much of the light of lightLoc reaches a point, from 0 in full shadow to 1
+float SampleShadow(vec3 worldPosition, vec3 worldNormal)
+{
+	vec3 toPoint = worldPosition - lightLoc;
+	float distance = length(toPoint);
+	if (distance >= shadowParameters.y)
+	{
+		return 1.0;
+	}
+
+	// Tiles are seen from both sides, so the side facing the light is pushed off the surface
+	// by a texel and a half, which keeps it from shadowing itself
+	float texelSize = 2.0 * distance / shadowParameters.z;
+	vec3 normal = dot(worldNormal, toPoint) > 0.0 ? -worldNormal : worldNormal;
+	toPoint += normal * 1.5 * texelSize;
+
+	// Window-space depth of the point in the face it falls on
+	vec3 axisDistances = abs(toPoint);
+	float majorDistance = max(axisDistances.x, max(axisDistances.y, axisDistances.z));
+	float near = shadowParameters.x;
+	float far = shadowParameters.y;
+	float depth = 0.5 * ((far + near) / (far - near) - 2.0 * far * near / ((far - near) * majorDistance)) + 0.5;
+
+	// Percentage-closer filtering: each tap already blends the four depth tests of its texels,
+	// and the taps spread around the point soften the edges further
+	float lit = 0.0;
+	for (int i = 0; i < 8; i++)
+	{
+		lit += texture(shadowMap, vec4(toPoint + ShadowTapOffsets[i] * texelSize, depth));
+	}
+	return lit / 8.0;
+}
@@ -0,0 +1,106 @@
+// Checks that jobs which are still pending are never reused by the job system.
+// Build and run from the repository root:
+//   g++ -std=c++17 -pthread -IProjects Tests/JobSystemTest.cpp Projects/JobSystem.cpp -o Tests/JobSystemTest && Tests/JobSystemTest
+
+#include <atomic>
+#include <iostream>
+
+#include "JobSystem.h"
+
+namespace
+{
+	int failureCount = 0;
+
+	/// <summary>
+	/// Reports a failed check.
+	/// </summary>
+	/// <param name="condition">Result of the check</param>
+	/// <param name="description">What was checked</param>
+	void Check(bool condition, const char* description)
+	{
+		if (!condition)
+		{
+			std::cerr << "FAILED: " << description << std::endl;
+			failureCount++;
+		}
+	}
+
+	/// <summary>
+	/// Keeps one job pending while more than a full ring of other jobs is created and run,
+	/// then checks that the pending job still holds its own function and parent.
+	/// </summary>
+	/// <param name="workerCount">Number of workers of the job system</param>
+	void TestPendingJobSurvivesRing(unsigned workerCount)
+	{
+		JobSystem jobs;
+		jobs.Create(workerCount);
+
+		std::atomic<bool> pendingRan{ false };
+		Job* parent = jobs.CreateJob(nullptr);
+		Job* pending = jobs.CreateJob([&pendingRan]() { pendingRan = true; }, parent);
+
+		std::atomic<int> otherCount{ 0 };
+		const int createdCount = static_cast<int>(JobSystem::MaxJobsPerThread) * 2 + 100;
+		for (int i = 0; i < createdCount; i++)
+		{
+			Job* other = jobs.CreateJob([&otherCount]() { otherCount++; });
+			Check(other != pending && other != parent, "a pending job was handed out again");
+			jobs.Run(other);
+			jobs.Wait(other);
+		}
+		Check(otherCount == createdCount, "every other job ran");
+		Check(pending->parent == parent, "the pending job kept its parent");
+		Check(pending->unfinishedJobs == 1, "the pending job is still unfinished");
+		Check(parent->unfinishedJobs == 2, "the parent still counts the pending job");
+
+		jobs.Run(pending);
+		jobs.Run(parent);
+		jobs.Wait(parent);
+		Check(pendingRan, "the pending job ran its own function");
+
+		jobs.Destroy();
+	}
+
+	/// <summary>
+	/// Queues a full ring of jobs without waiting for any, then creates one more, which has
+	/// to run queued jobs to free a slot rather than overwrite one.
+	/// </summary>
+	void TestFullRing()
+	{
+		JobSystem jobs;
+		jobs.Create(1);
+
+		std::atomic<int> ranCount{ 0 };
+		for (std::size_t i = 0; i < JobSystem::MaxJobsPerThread; i++)
+		{
+			jobs.Run(jobs.CreateJob([&ranCount]() { ranCount++; }));
+		}
+		Check(ranCount == 0, "queued jobs do not run before a thread helps");
+
+		Job* last = jobs.CreateJob([&ranCount]() { ranCount++; });
+		Check(ranCount >= 1, "creating a job in a full ring runs a queued job");
+		jobs.Run(last);
+		while (jobs.RunPendingJob())
+		{
+		}
+		Check(ranCount == static_cast<int>(JobSystem::MaxJobsPerThread) + 1, "every job ran once");
+
+		jobs.Destroy();
+	}
+}
+
+int main()
+{
+	TestPendingJobSurvivesRing(1);
+	TestPendingJobSurvivesRing(4);
+	TestFullRing();
+
+	if (failureCount > 0)
+	{
+		std::cerr << failureCount << " checks failed" << std::endl;
+		return 1;
+	}
+
+	std::cout << "All job system checks passed" << std::endl;
+	return 0;
+}